@@ -18,6 +18,7 @@
  * limitations under the License.
  */
 
+#include <stdint.h>
 #include <unistd.h>
 
 #include <common/gfal_cancel.h>
@@ -31,29 +32,53 @@
 //
 
 
+// Must be called with mux_cancel held
+static void gfal_cancel_fd_set(gfal2_context_t context, gboolean readable)
+{
+    if (context->cancel_fd < 0)
+        return;
+    uint64_t value = 1;
+    if (readable)
+        (void) write(context->cancel_fd, &value, sizeof(value));
+    else
+        (void) read(context->cancel_fd, &value, sizeof(value));
+}
+
+
 int gfal2_cancel(gfal2_context_t context)
 {
     if (!context)
         return -1;
-    else if (context->cancel == TRUE) // avoid recursive calls
+    else if (g_atomic_int_get(&context->cancel)) // avoid recursive calls
         return 0;
 
     g_mutex_lock(context->mux_cancel);
     const int n_cancel = g_atomic_int_get(&(context->running_ops));
-    context->cancel = TRUE;
+    g_atomic_int_set(&context->cancel, TRUE);
     g_hook_list_invoke(&context->cancel_hooks, TRUE);
-    g_mutex_unlock(context->mux_cancel);
+    gfal_cancel_fd_set(context, TRUE);
+    // gfal2_end_scope_cancel signals when the last operation leaves
     while ((g_atomic_int_get(&(context->running_ops))) > 0) {
-        usleep(50);
+        g_cond_wait(context->cond_cancel, context->mux_cancel);
     }
-    context->cancel = FALSE;
+    gfal_cancel_fd_set(context, FALSE);
+    g_atomic_int_set(&context->cancel, FALSE);
+    g_mutex_unlock(context->mux_cancel);
     return n_cancel;
 }
 
 
 gboolean gfal2_is_canceled(gfal2_context_t context)
 {
-    return context->cancel;
+    return g_atomic_int_get(&context->cancel);
+}
+
+
+// Created with the context, so this does not need mux_cancel and is safe from a cancel hook
+int gfal2_cancel_get_fd(gfal2_context_t context)
+{
+    g_assert(context);
+    return context->cancel_fd;
 }
 
 
@@ -61,7 +86,7 @@ gboolean gfal2_is_canceled(gfal2_context_t context)
 // Return negative value if task is canceled
 int gfal2_start_scope_cancel(gfal2_context_t context, GError** err)
 {
-    if (context && context->cancel) {
+    if (context && g_atomic_int_get(&context->cancel)) {
         g_set_error(err, gfal_cancel_quark(), ECANCELED,
                 "[gfal2_cancel] operation canceled by user");
         return -1;
@@ -71,10 +96,15 @@ int gfal2_start_scope_cancel(gfal2_context_t context, GError** err)
 }
 
 
+// The cancel flag is set before gfal2_cancel reads running_ops, so either
+// gfal2_cancel sees no operation running, or the last one sees the flag and wakes it up
 int gfal2_end_scope_cancel(gfal2_context_t context)
 {
-    if (context)
-        (void) g_atomic_int_dec_and_test(&(context->running_ops));
+    if (context && g_atomic_int_dec_and_test(&(context->running_ops)) && g_atomic_int_get(&context->cancel)) {
+        g_mutex_lock(context->mux_cancel);
+        g_cond_broadcast(context->cond_cancel);
+        g_mutex_unlock(context->mux_cancel);
+    }
     return 0;
 }
 
@@ -59,6 +59,15 @@ int gfal2_cancel(gfal2_context_t context);
  */
 gboolean gfal2_is_canceled(gfal2_context_t context);
 
+/**
+ * File descriptor that is readable while a cancellation is in progress
+ * Plugins can poll it together with their own sockets instead of polling \ref gfal2_is_canceled.
+ * It belongs to the context, so it must not be closed nor read.
+ * Thread safe, and can be called from a cancel hook
+ * @return the file descriptor, or -1 if it could not be created
+ */
+int gfal2_cancel_get_fd(gfal2_context_t context);
+
 /**
  * Register a cancel hook, called in each cancellation
  * Thread-safe
@@ -23,9 +23,12 @@
 #include <logger/gfal_logger.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include <common/gfal_plugin.h>
 #include <gfal_api.h>
 #include "gfal_file_handler_container.h"
+#include "gfal_metrics_internal.h"
 #include "uri/gfal2_parsing.h"
 
 // initialization
@@ -163,8 +166,11 @@ gfal2_context_t gfal2_context_new(GError **err)
     }
     context->client_info = g_ptr_array_new();
     context->mux_cancel = g_mutex_new();
+    context->cond_cancel = g_cond_new();
+    context->cancel_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
     g_hook_list_init(&context->cancel_hooks, sizeof(GHook));
     context->fdescs = gfal_file_descriptor_handle_create(NULL);
+    context->metrics_serial = -1;
 
     G_RETURN_ERR(context, tmp_err, err);
 }
@@ -177,17 +183,26 @@ void gfal2_context_free(gfal2_context_t context)
         return;
     }
 
+    // Let the pending asynchronous operations finish before tearing down the plugins
+    if (context->async_pool)
+        g_thread_pool_free(context->async_pool, FALSE, TRUE);
+    if (context->fanout_pool)
+        g_thread_pool_free(context->fanout_pool, FALSE, TRUE);
     gfal_plugins_delete(context, NULL);
     gfal_file_descriptor_handle_destroy(context->fdescs);
     g_key_file_free(context->config);
     g_list_free(context->plugin_opt.sorted_plugin);
     g_mutex_free(context->mux_cancel);
+    g_cond_free(context->cond_cancel);
+    if (context->cancel_fd >= 0)
+        close(context->cancel_fd);
     g_hook_list_clear(&context->cancel_hooks);
     g_free(context->agent_name);
     g_free(context->agent_version);
     g_ptr_array_foreach(context->client_info, gfal_free_keyvalue, NULL);
     g_ptr_array_free(context->client_info, FALSE);
     gfal2_cred_clean(context, NULL);
+    gfal_metrics_free(context->metrics);
     g_free(context);
 }
 
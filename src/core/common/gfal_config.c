@@ -201,6 +201,7 @@ gint gfal2_set_opt_string(gfal2_context_t context, const gchar *group_name,
 {
     g_assert(context != NULL);
     g_key_file_set_string(context->config, group_name, key, value);
+    g_atomic_int_inc(&context->settings_serial);
     return 0;
 }
 
@@ -235,6 +236,7 @@ gint gfal2_set_opt_integer(gfal2_context_t context, const gchar *group_name,
 {
     g_assert(context != NULL);
     g_key_file_set_integer(context->config, group_name, key, value);
+    g_atomic_int_inc(&context->settings_serial);
     return 0;
 }
 
@@ -270,6 +272,7 @@ gint gfal2_set_opt_boolean(gfal2_context_t context, const gchar *group_name,
 {
     g_assert(context != NULL);
     g_key_file_set_boolean(context->config, group_name, key, value);
+    g_atomic_int_inc(&context->settings_serial);
     return 0;
 }
 
@@ -289,6 +292,7 @@ gint gfal2_set_opt_string_list(gfal2_context_t context, const gchar *group_name,
 {
     g_assert(context != NULL);
     g_key_file_set_string_list(context->config, group_name, key, list, length);
+    g_atomic_int_inc(&context->settings_serial);
     return 0;
 }
 
@@ -319,7 +323,9 @@ gchar **gfal2_get_opt_string_list_with_default(gfal2_context_t context,
 gint gfal2_load_opts_from_file(gfal2_context_t context, const char *path,
     GError **error)
 {
-    return gfal_load_configuration_to_conf_manager(context->config, path, error);
+    gint ret = gfal_load_configuration_to_conf_manager(context->config, path, error);
+    g_atomic_int_inc(&context->settings_serial);
+    return ret;
 }
 
 
@@ -332,7 +338,15 @@ gchar **gfal2_get_opt_keys(gfal2_context_t context, const gchar *group_name, gsi
 gboolean gfal2_remove_opt(gfal2_context_t context, const gchar *group_name,
     const gchar *key, GError **error)
 {
-    return g_key_file_remove_key(context->config, group_name, key, error);
+    gboolean ret = g_key_file_remove_key(context->config, group_name, key, error);
+    g_atomic_int_inc(&context->settings_serial);
+    return ret;
+}
+
+
+guint gfal2_get_opt_serial(gfal2_context_t context)
+{
+    return (guint)g_atomic_int_get(&context->settings_serial);
 }
 
 
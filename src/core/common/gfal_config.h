@@ -259,6 +259,13 @@ gchar **gfal2_get_opt_keys(gfal2_context_t context, const gchar *group_name, gsi
 gboolean gfal2_remove_opt(gfal2_context_t context, const gchar *group_name,
     const gchar *key, GError **error);
 
+/**
+ * Return a counter increased every time the configuration or the credentials of the context
+ * change. Plugins can compare it to know when something derived from them must be recomputed.
+ * @version 2.24.0
+ */
+guint gfal2_get_opt_serial(gfal2_context_t context);
+
 /**
  * Set the user agent for those protocols that support this
  */
@@ -102,10 +102,12 @@ int gfal2_cred_set(gfal2_context_t handle, const char *url_prefix, const gfal2_c
     // If cred is NULL, done
     if (cred == NULL) {
         node_free(node);
+        g_atomic_int_inc(&handle->settings_serial);
         return 0;
     }
 
     handle->cred_mapping = g_list_insert_sorted(handle->cred_mapping, node, node_compare);
+    g_atomic_int_inc(&handle->settings_serial);
     return 0;
 }
 
@@ -156,6 +158,7 @@ int gfal2_cred_del(gfal2_context_t handle, const char *type, const char *url, GE
             (strcmp(node->url_prefix, url) == 0)) {
             node_free(node);
             handle->cred_mapping = g_list_delete_link(handle->cred_mapping, item);
+            g_atomic_int_inc(&handle->settings_serial);
             return 0;
         }
     }
@@ -167,6 +170,7 @@ int gfal2_cred_clean(gfal2_context_t handle, GError **error)
 {
     g_list_free_full(handle->cred_mapping, node_free);
     handle->cred_mapping = NULL;
+    g_atomic_int_inc(&handle->settings_serial);
     return 0;
 }
 
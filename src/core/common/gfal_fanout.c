@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <glib.h>
+
+#include <logger/gfal_logger.h>
+#include "gfal_handle.h"
+#include "gfal_cancel.h"
+#include "gfal_config.h"
+#include "gfal_error.h"
+#include "gfal_metrics_internal.h"
+
+//
+// Concurrent execution of list operations.
+// Entries are grouped per host, and picked in a round robin fashion between
+// the hosts that are below their concurrency limit.
+//
+
+#define GFAL_FANOUT_DEFAULT_THREADS  16
+#define GFAL_FANOUT_DEFAULT_PER_HOST 4
+
+
+typedef struct {
+    int* indexes;
+    int total;
+    int next;
+    int active;
+} gfal_fanout_host_t;
+
+
+typedef struct {
+    gint ref_count;
+    gfal2_context_t handle;
+    const char* const* uris;
+    GError** errors;
+    gfal_plugin_fanout_func func;
+    gpointer user_data;
+    int nbfiles;
+    int per_host;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    GPtrArray* hosts;
+    guint round_robin;
+    int pending;
+    int completed;
+    int failures;
+} gfal_fanout_batch_t;
+
+
+static void gfal_fanout_host_free(gpointer data, gpointer user_data)
+{
+    gfal_fanout_host_t* host = (gfal_fanout_host_t*)data;
+    g_free(host->indexes);
+    g_free(host);
+}
+
+
+static void gfal_fanout_batch_unref(gfal_fanout_batch_t* batch)
+{
+    if (g_atomic_int_dec_and_test(&batch->ref_count)) {
+        g_ptr_array_foreach(batch->hosts, gfal_fanout_host_free, NULL);
+        g_ptr_array_free(batch->hosts, TRUE);
+        pthread_mutex_destroy(&batch->lock);
+        pthread_cond_destroy(&batch->cond);
+        g_free(batch);
+    }
+}
+
+
+// Group the entries per host
+static void gfal_fanout_batch_split(gfal_fanout_batch_t* batch)
+{
+    GHashTable* by_host = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    gfal_fanout_host_t** host_of = g_new0(gfal_fanout_host_t*, batch->nbfiles);
+    char host_name[256];
+    int i;
+
+    batch->hosts = g_ptr_array_new();
+
+    for (i = 0; i < batch->nbfiles; ++i) {
+        gfal_metrics_host_from_url(batch->uris[i], host_name, sizeof(host_name));
+        gfal_fanout_host_t* host = g_hash_table_lookup(by_host, host_name);
+        if (host == NULL) {
+            host = g_new0(gfal_fanout_host_t, 1);
+            g_hash_table_insert(by_host, g_strdup(host_name), host);
+            g_ptr_array_add(batch->hosts, host);
+        }
+        host->total++;
+        host_of[i] = host;
+    }
+
+    for (i = 0; i < batch->nbfiles; ++i) {
+        gfal_fanout_host_t* host = host_of[i];
+        if (host->indexes == NULL)
+            host->indexes = g_new(int, host->total);
+        host->indexes[host->next++] = i;
+    }
+    for (i = 0; i < (int)batch->hosts->len; ++i) {
+        ((gfal_fanout_host_t*)g_ptr_array_index(batch->hosts, i))->next = 0;
+    }
+
+    g_free(host_of);
+    g_hash_table_destroy(by_host);
+}
+
+
+// Pick the next entry to run, -1 if all hosts are at their limit
+// Must be called with the lock held
+static int gfal_fanout_pick(gfal_fanout_batch_t* batch, gfal_fanout_host_t** picked)
+{
+    const guint nhosts = batch->hosts->len;
+    guint i;
+    for (i = 0; i < nhosts; ++i) {
+        guint host_index = (batch->round_robin + i) % nhosts;
+        gfal_fanout_host_t* host = g_ptr_array_index(batch->hosts, host_index);
+        if (host->next < host->total && host->active < batch->per_host) {
+            batch->round_robin = host_index + 1;
+            batch->pending--;
+            host->active++;
+            *picked = host;
+            return host->indexes[host->next++];
+        }
+    }
+    return -1;
+}
+
+
+static void gfal_fanout_process(gfal_fanout_batch_t* batch)
+{
+    pthread_mutex_lock(&batch->lock);
+    while (batch->pending > 0) {
+        gfal_fanout_host_t* host = NULL;
+        int index = gfal_fanout_pick(batch, &host);
+        if (index < 0) {
+            pthread_cond_wait(&batch->cond, &batch->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&batch->lock);
+
+        GError** error = &batch->errors[index];
+        if (gfal2_is_canceled(batch->handle)) {
+            gfal2_set_error(error, gfal_cancel_quark(), ECANCELED, __func__, "Operation canceled");
+        }
+        else {
+            batch->func(batch->handle, batch->uris[index], index, batch->user_data, error);
+        }
+
+        pthread_mutex_lock(&batch->lock);
+        host->active--;
+        batch->completed++;
+        if (*error)
+            batch->failures++;
+        pthread_cond_broadcast(&batch->cond);
+    }
+    pthread_mutex_unlock(&batch->lock);
+}
+
+
+static void gfal_fanout_worker(gpointer data, gpointer user_data)
+{
+    gfal_fanout_batch_t* batch = (gfal_fanout_batch_t*)data;
+    gfal_fanout_process(batch);
+    gfal_fanout_batch_unref(batch);
+}
+
+
+// The pool is created on first use, so FANOUT_THREADS can be changed
+// after the creation of the context
+static GThreadPool* gfal_fanout_get_pool(gfal2_context_t handle, gint max_threads)
+{
+    GThreadPool* pool = g_atomic_pointer_get(&handle->fanout_pool);
+    if (pool)
+        return pool;
+
+    GError* tmp_err = NULL;
+    pool = g_thread_pool_new(gfal_fanout_worker, NULL, max_threads, FALSE, &tmp_err);
+    if (pool == NULL) {
+        gfal2_log(G_LOG_LEVEL_WARNING, "Could not create the worker pool, running serially: %s",
+            tmp_err->message);
+        g_error_free(tmp_err);
+        return NULL;
+    }
+
+    if (!g_atomic_pointer_compare_and_exchange(&handle->fanout_pool, NULL, pool)) {
+        g_thread_pool_free(pool, TRUE, FALSE);
+        pool = g_atomic_pointer_get(&handle->fanout_pool);
+    }
+    return pool;
+}
+
+
+int gfal_plugin_fanout(gfal2_context_t handle, int nbfiles, const char* const* uris,
+        gfal_plugin_fanout_func func, gpointer user_data, GError** errors)
+{
+    if (nbfiles <= 0)
+        return 0;
+
+    gint max_threads = gfal2_get_opt_integer_with_default(handle, "CORE", "FANOUT_THREADS",
+        GFAL_FANOUT_DEFAULT_THREADS);
+    gint per_host = gfal2_get_opt_integer_with_default(handle, "CORE", "FANOUT_PER_HOST",
+        GFAL_FANOUT_DEFAULT_PER_HOST);
+    if (max_threads <= 0)
+        max_threads = 1;
+    if (per_host <= 0)
+        per_host = 1;
+
+    gfal_fanout_batch_t* batch = g_new0(gfal_fanout_batch_t, 1);
+    batch->ref_count = 1;
+    batch->handle = handle;
+    batch->uris = uris;
+    batch->errors = errors;
+    batch->func = func;
+    batch->user_data = user_data;
+    batch->nbfiles = nbfiles;
+    batch->per_host = per_host;
+    batch->pending = nbfiles;
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_cond_init(&batch->cond, NULL);
+    gfal_fanout_batch_split(batch);
+
+    // The calling thread is one of the workers, so there is always progress
+    // even if the pool is saturated (i.e. nested list operations)
+    int helpers = MIN(max_threads, nbfiles) - 1;
+    GThreadPool* pool = helpers > 0 ? gfal_fanout_get_pool(handle, max_threads) : NULL;
+    int i;
+    for (i = 0; pool && i < helpers; ++i) {
+        GError* push_error = NULL;
+        g_atomic_int_inc(&batch->ref_count);
+        g_thread_pool_push(pool, batch, &push_error);
+        if (push_error) {
+            gfal2_log(G_LOG_LEVEL_WARNING, "Could not start a fan-out helper: %s", push_error->message);
+            g_error_free(push_error);
+            gfal_fanout_batch_unref(batch);
+            break;
+        }
+    }
+
+    gfal2_log(G_LOG_LEVEL_DEBUG, "Running %d entries over %u hosts, with %d helpers",
+        nbfiles, batch->hosts->len, pool ? helpers : 0);
+
+    gfal_fanout_process(batch);
+
+    pthread_mutex_lock(&batch->lock);
+    while (batch->completed < batch->nbfiles)
+        pthread_cond_wait(&batch->cond, &batch->lock);
+    int failures = batch->failures;
+    pthread_mutex_unlock(&batch->lock);
+
+    gfal_fanout_batch_unref(batch);
+    return failures;
+}
@@ -54,15 +54,31 @@ struct gfal_handle_ {
     volatile gint running_ops;
     gboolean cancel;
     GMutex* mux_cancel;
+    GCond* cond_cancel;
+    int cancel_fd;
     GHookList cancel_hooks;
 
 	// Credential mapping
     GList *cred_mapping;
 
+    // increased on every change of the configuration or the credentials
+    volatile gint settings_serial;
+
     // client information
     char* agent_name;
     char* agent_version;
     GPtrArray* client_info;
+
+    // operation metrics, created the first time CORE:METRICS is found enabled
+    struct _gfal_metrics* metrics;
+    // value of CORE:METRICS, and the settings_serial it was read at
+    volatile gint metrics_enabled;
+    volatile gint metrics_serial;
+
+    // executor for the asynchronous API, created on first use
+    GThreadPool* async_pool;
+    // worker pool for the list operations fallbacks
+    GThreadPool* fanout_pool;
 };
 
 
@@ -0,0 +1,498 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "gfal_handle.h"
+#include "gfal_config.h"
+#include "gfal_error.h"
+#include "gfal_metrics_internal.h"
+
+//
+// Metrics are spread over several shards, each with its own lock.
+// A thread always records into the same shard, so in the common case the lock
+// is uncontended, and only the readers pay for merging.
+//
+
+#define GFAL_METRICS_SHARDS 16
+
+
+typedef struct {
+    guint64 count;
+    guint64 errors;
+    guint64 bytes;
+    guint64 sum_usec;
+    guint64 min_usec;
+    guint64 max_usec;
+    guint64 buckets[GFAL_METRICS_BUCKETS];
+} gfal_metrics_series_t;
+
+
+typedef struct {
+    pthread_mutex_t lock;
+    // "plugin\noperation\nhost" => gfal_metrics_series_t
+    GHashTable* series;
+} gfal_metrics_shard_t;
+
+
+struct _gfal_metrics {
+    gfal_metrics_shard_t shards[GFAL_METRICS_SHARDS];
+};
+
+
+static __thread int gfal_metrics_thread_shard = -1;
+static gint gfal_metrics_shard_counter = 0;
+
+
+guint gfal_metrics_bucket_index(guint64 value)
+{
+    if (value < GFAL_METRICS_SUB_COUNT)
+        return (guint)value;
+    if (value >> GFAL_METRICS_MAX_BITS)
+        return GFAL_METRICS_BUCKETS - 1;
+
+    guint msb = 63 - __builtin_clzll(value);
+    guint shift = msb - GFAL_METRICS_SUB_BITS;
+    return (shift + 1) * GFAL_METRICS_SUB_COUNT + (guint)((value >> shift) - GFAL_METRICS_SUB_COUNT);
+}
+
+
+guint64 gfal_metrics_bucket_upper(guint index)
+{
+    if (index < GFAL_METRICS_SUB_COUNT)
+        return index;
+    guint shift = index / GFAL_METRICS_SUB_COUNT - 1;
+    guint64 sub = (index % GFAL_METRICS_SUB_COUNT) + GFAL_METRICS_SUB_COUNT;
+    return ((sub + 1) << shift) - 1;
+}
+
+
+void gfal_metrics_host_from_url(const char* url, char* buffer, size_t s_buffer)
+{
+    buffer[0] = '\0';
+    if (url == NULL)
+        return;
+
+    const char* host = strstr(url, "://");
+    if (host == NULL)
+        return;
+    host += 3;
+
+    // Skip user info
+    const char* end = host + strcspn(host, "/?#");
+    const char* at = memchr(host, '@', end - host);
+    if (at)
+        host = at + 1;
+
+    // IPv6 literal
+    if (*host == '[') {
+        const char* close = memchr(host, ']', end - host);
+        if (close)
+            end = close + 1;
+    }
+    else {
+        const char* colon = memchr(host, ':', end - host);
+        if (colon)
+            end = colon;
+    }
+
+    size_t len = end - host;
+    if (len >= s_buffer)
+        len = s_buffer - 1;
+    memcpy(buffer, host, len);
+    buffer[len] = '\0';
+}
+
+
+gfal_metrics_t* gfal_metrics_new(void)
+{
+    gfal_metrics_t* metrics = g_new0(gfal_metrics_t, 1);
+    int i;
+    for (i = 0; i < GFAL_METRICS_SHARDS; ++i) {
+        pthread_mutex_init(&metrics->shards[i].lock, NULL);
+        metrics->shards[i].series = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    }
+    return metrics;
+}
+
+
+void gfal_metrics_free(gfal_metrics_t* metrics)
+{
+    if (metrics == NULL)
+        return;
+    int i;
+    for (i = 0; i < GFAL_METRICS_SHARDS; ++i) {
+        g_hash_table_destroy(metrics->shards[i].series);
+        pthread_mutex_destroy(&metrics->shards[i].lock);
+    }
+    g_free(metrics);
+}
+
+
+// The option is only read again when the configuration changes, so this is cheap enough
+// to be called around each plugin call
+gfal_metrics_t* gfal_metrics_get(gfal2_context_t context)
+{
+    const gint serial = g_atomic_int_get(&context->settings_serial);
+    if (serial != g_atomic_int_get(&context->metrics_serial)) {
+        const gboolean enabled = gfal2_get_opt_boolean_with_default(context, "CORE", "METRICS", FALSE);
+        if (enabled && g_atomic_pointer_get(&context->metrics) == NULL) {
+            gfal_metrics_t* metrics = gfal_metrics_new();
+            if (!g_atomic_pointer_compare_and_exchange((gpointer*)&context->metrics, NULL, metrics))
+                gfal_metrics_free(metrics);
+        }
+        g_atomic_int_set(&context->metrics_enabled, enabled);
+        g_atomic_int_set(&context->metrics_serial, serial);
+    }
+    return g_atomic_int_get(&context->metrics_enabled) ? context->metrics : NULL;
+}
+
+
+static gfal_metrics_shard_t* gfal_metrics_get_shard(gfal_metrics_t* metrics)
+{
+    if (gfal_metrics_thread_shard < 0) {
+        // Two threads racing here may end in the same shard, which is harmless
+        g_atomic_int_inc(&gfal_metrics_shard_counter);
+        gfal_metrics_thread_shard = g_atomic_int_get(&gfal_metrics_shard_counter) % GFAL_METRICS_SHARDS;
+    }
+    return &metrics->shards[gfal_metrics_thread_shard];
+}
+
+
+static void gfal_metrics_series_add(gfal_metrics_series_t* dst, const gfal_metrics_series_t* src)
+{
+    if (dst->count == 0 || src->min_usec < dst->min_usec)
+        dst->min_usec = src->min_usec;
+    if (src->max_usec > dst->max_usec)
+        dst->max_usec = src->max_usec;
+    dst->count += src->count;
+    dst->errors += src->errors;
+    dst->bytes += src->bytes;
+    dst->sum_usec += src->sum_usec;
+    int i;
+    for (i = 0; i < GFAL_METRICS_BUCKETS; ++i)
+        dst->buckets[i] += src->buckets[i];
+}
+
+
+void gfal_metrics_record(gfal_metrics_t* metrics, const char* plugin, const char* operation,
+    const char* url, gint64 elapsed_usec, gint64 bytes, gboolean failed)
+{
+    if (metrics == NULL)
+        return;
+
+    char host[256];
+    char key[512];
+    gfal_metrics_host_from_url(url, host, sizeof(host));
+    g_snprintf(key, sizeof(key), "%s\n%s\n%s", plugin ? plugin : "", operation, host);
+
+    const guint64 usec = elapsed_usec > 0 ? (guint64)elapsed_usec : 0;
+    gfal_metrics_shard_t* shard = gfal_metrics_get_shard(metrics);
+
+    pthread_mutex_lock(&shard->lock);
+
+    gfal_metrics_series_t* series = g_hash_table_lookup(shard->series, key);
+    if (series == NULL) {
+        series = g_new0(gfal_metrics_series_t, 1);
+        series->min_usec = usec;
+        g_hash_table_insert(shard->series, g_strdup(key), series);
+    }
+
+    series->count++;
+    if (failed)
+        series->errors++;
+    if (bytes > 0)
+        series->bytes += bytes;
+    series->sum_usec += usec;
+    if (usec < series->min_usec)
+        series->min_usec = usec;
+    if (usec > series->max_usec)
+        series->max_usec = usec;
+    series->buckets[gfal_metrics_bucket_index(usec)]++;
+
+    pthread_mutex_unlock(&shard->lock);
+}
+
+
+// Merge all the shards into a single table
+static GHashTable* gfal_metrics_merge(gfal_metrics_t* metrics)
+{
+    GHashTable* merged = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    int i;
+    for (i = 0; i < GFAL_METRICS_SHARDS; ++i) {
+        gfal_metrics_shard_t* shard = &metrics->shards[i];
+        GHashTableIter iter;
+        gpointer key, value;
+
+        pthread_mutex_lock(&shard->lock);
+        g_hash_table_iter_init(&iter, shard->series);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            gfal_metrics_series_t* series = g_hash_table_lookup(merged, key);
+            if (series == NULL) {
+                series = g_new0(gfal_metrics_series_t, 1);
+                g_hash_table_insert(merged, g_strdup(key), series);
+            }
+            gfal_metrics_series_add(series, value);
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return merged;
+}
+
+
+static guint64 gfal_metrics_percentile(const gfal_metrics_series_t* series, double percentile)
+{
+    guint64 rank = (guint64)(series->count * percentile + 0.5);
+    if (rank == 0)
+        rank = 1;
+    guint64 seen = 0;
+    int i;
+    for (i = 0; i < GFAL_METRICS_BUCKETS; ++i) {
+        seen += series->buckets[i];
+        if (seen >= rank)
+            return MIN(gfal_metrics_bucket_upper(i), series->max_usec);
+    }
+    return series->max_usec;
+}
+
+
+static void gfal_metrics_append_json_escaped(GString* out, const char* str)
+{
+    for (; *str; ++str) {
+        switch (*str) {
+            case '"':
+                g_string_append(out, "\\\"");
+                break;
+            case '\\':
+                g_string_append(out, "\\\\");
+                break;
+            case '\n':
+                g_string_append(out, "\\n");
+                break;
+            default:
+                if ((unsigned char)*str < 0x20)
+                    g_string_append_printf(out, "\\u%04x", (unsigned char)*str);
+                else
+                    g_string_append_c(out, *str);
+        }
+    }
+}
+
+
+// The Prometheus text format only escapes these three, anything else goes as is
+static void gfal_metrics_append_label_escaped(GString* out, const char* str)
+{
+    for (; *str; ++str) {
+        switch (*str) {
+            case '"':
+                g_string_append(out, "\\\"");
+                break;
+            case '\\':
+                g_string_append(out, "\\\\");
+                break;
+            case '\n':
+                g_string_append(out, "\\n");
+                break;
+            default:
+                g_string_append_c(out, *str);
+        }
+    }
+}
+
+
+static void gfal_metrics_append_labels(GString* out, char** labels)
+{
+    g_string_append(out, "plugin=\"");
+    gfal_metrics_append_label_escaped(out, labels[0]);
+    g_string_append(out, "\",operation=\"");
+    gfal_metrics_append_label_escaped(out, labels[1]);
+    g_string_append(out, "\",host=\"");
+    gfal_metrics_append_label_escaped(out, labels[2]);
+    g_string_append_c(out, '"');
+}
+
+
+static void gfal_metrics_render_json(GString* out, GList* keys, GHashTable* merged)
+{
+    GList* i;
+    g_string_append(out, "{\"operations\":[");
+    for (i = keys; i != NULL; i = i->next) {
+        const gfal_metrics_series_t* series = g_hash_table_lookup(merged, i->data);
+        char** labels = g_strsplit(i->data, "\n", 3);
+
+        if (i != keys)
+            g_string_append_c(out, ',');
+        g_string_append(out, "{\"plugin\":\"");
+        gfal_metrics_append_json_escaped(out, labels[0]);
+        g_string_append(out, "\",\"operation\":\"");
+        gfal_metrics_append_json_escaped(out, labels[1]);
+        g_string_append(out, "\",\"host\":\"");
+        gfal_metrics_append_json_escaped(out, labels[2]);
+        g_string_append_printf(out,
+            "\",\"count\":%" G_GUINT64_FORMAT ",\"errors\":%" G_GUINT64_FORMAT
+            ",\"bytes\":%" G_GUINT64_FORMAT,
+            series->count, series->errors, series->bytes);
+        g_string_append_printf(out,
+            ",\"latency_us\":{\"sum\":%" G_GUINT64_FORMAT ",\"min\":%" G_GUINT64_FORMAT
+            ",\"max\":%" G_GUINT64_FORMAT ",\"p50\":%" G_GUINT64_FORMAT
+            ",\"p90\":%" G_GUINT64_FORMAT ",\"p99\":%" G_GUINT64_FORMAT "}",
+            series->sum_usec, series->min_usec, series->max_usec,
+            gfal_metrics_percentile(series, 0.50),
+            gfal_metrics_percentile(series, 0.90),
+            gfal_metrics_percentile(series, 0.99));
+
+        // Only non empty buckets, as [upper bound in us, count]
+        g_string_append(out, ",\"histogram\":[");
+        gboolean first = TRUE;
+        int b;
+        for (b = 0; b < GFAL_METRICS_BUCKETS; ++b) {
+            if (series->buckets[b] == 0)
+                continue;
+            g_string_append_printf(out, "%s[%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT "]",
+                first ? "" : ",", gfal_metrics_bucket_upper(b), series->buckets[b]);
+            first = FALSE;
+        }
+        g_string_append(out, "]}");
+
+        g_strfreev(labels);
+    }
+    g_string_append(out, "]}\n");
+}
+
+
+static void gfal_metrics_render_prometheus(GString* out, GList* keys, GHashTable* merged)
+{
+    GList* i;
+
+    g_string_append(out,
+        "# HELP gfal2_operation_duration_seconds Latency of the plugin operations\n"
+        "# TYPE gfal2_operation_duration_seconds histogram\n");
+    for (i = keys; i != NULL; i = i->next) {
+        const gfal_metrics_series_t* series = g_hash_table_lookup(merged, i->data);
+        char** labels = g_strsplit(i->data, "\n", 3);
+        guint64 cumulative = 0;
+        int b;
+
+        for (b = 0; b < GFAL_METRICS_BUCKETS; ++b) {
+            if (series->buckets[b] == 0)
+                continue;
+            cumulative += series->buckets[b];
+            g_string_append(out, "gfal2_operation_duration_seconds_bucket{");
+            gfal_metrics_append_labels(out, labels);
+            g_string_append_printf(out, ",le=\"%.6f\"} %" G_GUINT64_FORMAT "\n",
+                gfal_metrics_bucket_upper(b) / 1e6, cumulative);
+        }
+        g_string_append(out, "gfal2_operation_duration_seconds_bucket{");
+        gfal_metrics_append_labels(out, labels);
+        g_string_append_printf(out, ",le=\"+Inf\"} %" G_GUINT64_FORMAT "\n", series->count);
+
+        g_string_append(out, "gfal2_operation_duration_seconds_sum{");
+        gfal_metrics_append_labels(out, labels);
+        g_string_append_printf(out, "} %.6f\n", series->sum_usec / 1e6);
+
+        g_string_append(out, "gfal2_operation_duration_seconds_count{");
+        gfal_metrics_append_labels(out, labels);
+        g_string_append_printf(out, "} %" G_GUINT64_FORMAT "\n", series->count);
+
+        g_strfreev(labels);
+    }
+
+    g_string_append(out,
+        "# HELP gfal2_operation_errors_total Number of failed plugin operations\n"
+        "# TYPE gfal2_operation_errors_total counter\n");
+    for (i = keys; i != NULL; i = i->next) {
+        const gfal_metrics_series_t* series = g_hash_table_lookup(merged, i->data);
+        char** labels = g_strsplit(i->data, "\n", 3);
+        g_string_append(out, "gfal2_operation_errors_total{");
+        gfal_metrics_append_labels(out, labels);
+        g_string_append_printf(out, "} %" G_GUINT64_FORMAT "\n", series->errors);
+        g_strfreev(labels);
+    }
+
+    g_string_append(out,
+        "# HELP gfal2_operation_bytes_total Number of bytes read or written by plugin operations\n"
+        "# TYPE gfal2_operation_bytes_total counter\n");
+    for (i = keys; i != NULL; i = i->next) {
+        const gfal_metrics_series_t* series = g_hash_table_lookup(merged, i->data);
+        char** labels = g_strsplit(i->data, "\n", 3);
+        g_string_append(out, "gfal2_operation_bytes_total{");
+        gfal_metrics_append_labels(out, labels);
+        g_string_append_printf(out, "} %" G_GUINT64_FORMAT "\n", series->bytes);
+        g_strfreev(labels);
+    }
+}
+
+
+static gint gfal_metrics_key_cmp(gconstpointer a, gconstpointer b)
+{
+    return strcmp((const char*)a, (const char*)b);
+}
+
+
+char* gfal2_get_metrics(gfal2_context_t context, gfal2_metrics_format_t format, GError** err)
+{
+    g_return_val_err_if_fail(context != NULL, NULL, err, "[gfal2_get_metrics] Invalid context");
+
+    gfal_metrics_t* metrics = gfal_metrics_get(context);
+    if (metrics == NULL) {
+        gfal2_set_error(err, gfal2_get_core_quark(), ENOTSUP, __func__,
+            "Metrics are disabled for this context");
+        return NULL;
+    }
+    if (format != GFAL2_METRICS_JSON && format != GFAL2_METRICS_PROMETHEUS) {
+        gfal2_set_error(err, gfal2_get_core_quark(), EINVAL, __func__,
+            "Unknown metrics format %d", format);
+        return NULL;
+    }
+
+    GHashTable* merged = gfal_metrics_merge(metrics);
+    GList* keys = g_list_sort(g_hash_table_get_keys(merged), gfal_metrics_key_cmp);
+    GString* out = g_string_new(NULL);
+
+    if (format == GFAL2_METRICS_JSON)
+        gfal_metrics_render_json(out, keys, merged);
+    else
+        gfal_metrics_render_prometheus(out, keys, merged);
+
+    g_list_free(keys);
+    g_hash_table_destroy(merged);
+    return g_string_free(out, FALSE);
+}
+
+
+int gfal2_reset_metrics(gfal2_context_t context, GError** err)
+{
+    g_return_val_err_if_fail(context != NULL, -1, err, "[gfal2_reset_metrics] Invalid context");
+
+    if (context->metrics) {
+        int i;
+        for (i = 0; i < GFAL_METRICS_SHARDS; ++i) {
+            gfal_metrics_shard_t* shard = &context->metrics->shards[i];
+            pthread_mutex_lock(&shard->lock);
+            g_hash_table_remove_all(shard->series);
+            pthread_mutex_unlock(&shard->lock);
+        }
+    }
+    return 0;
+}
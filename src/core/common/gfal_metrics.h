@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef GFAL_METRICS_H_
+#define GFAL_METRICS_H_
+
+#if !defined(__GFAL2_H_INSIDE__) && !defined(__GFAL2_BUILD__)
+#   warning "Direct inclusion of gfal2 headers is deprecated. Please, include only gfal_api.h or gfal_plugins_api.h"
+#endif
+
+#include <glib.h>
+#include "gfal_common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @defgroup metrics_group Operation metrics
+ *
+ * The core keeps, per plugin, operation and endpoint host, a latency histogram
+ * together with the number of calls, errors and bytes moved.
+ * Latencies are recorded in microseconds into log-linear buckets, so any
+ * reported value is within 12.5% of the real one.
+ *
+ * Collection is disabled by default, and enabled with CORE:METRICS=true,
+ * either in the configuration or with \ref gfal2_set_opt_boolean.
+ * @{
+ */
+
+/**
+ * Output format for \ref gfal2_get_metrics
+ */
+typedef enum {
+    GFAL2_METRICS_JSON = 0,
+    GFAL2_METRICS_PROMETHEUS
+} gfal2_metrics_format_t;
+
+/**
+ * @brief Dump the metrics collected by the context
+ * @param context : gfal2 context
+ * @param format : output format
+ * @param err : GError error report
+ * @return a string that must be freed with g_free, NULL on error
+ * @version 2.24.0
+ */
+char* gfal2_get_metrics(gfal2_context_t context, gfal2_metrics_format_t format, GError** err);
+
+/**
+ * @brief Reset all the metrics collected by the context
+ * @version 2.24.0
+ */
+int gfal2_reset_metrics(gfal2_context_t context, GError** err);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GFAL_METRICS_H_ */
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef GFAL_METRICS_INTERNAL_H_
+#define GFAL_METRICS_INTERNAL_H_
+
+#include <glib.h>
+#include "gfal_metrics.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Latencies below 2^GFAL_METRICS_SUB_BITS us are exact, above they are
+// bucketed with GFAL_METRICS_SUB_BITS bits of precision
+#define GFAL_METRICS_SUB_BITS    3
+#define GFAL_METRICS_SUB_COUNT   (1 << GFAL_METRICS_SUB_BITS)
+// Anything above 2^40 us (~12 days) goes into the last bucket
+#define GFAL_METRICS_MAX_BITS    40
+#define GFAL_METRICS_BUCKETS     ((GFAL_METRICS_MAX_BITS - GFAL_METRICS_SUB_BITS + 1) * GFAL_METRICS_SUB_COUNT)
+
+typedef struct _gfal_metrics gfal_metrics_t;
+
+// create or delete a metrics registry, internal
+gfal_metrics_t* gfal_metrics_new(void);
+
+void gfal_metrics_free(gfal_metrics_t* metrics);
+
+// registry of the context, or NULL if CORE:METRICS is disabled
+gfal_metrics_t* gfal_metrics_get(gfal2_context_t context);
+
+// record one operation. url may be NULL
+void gfal_metrics_record(gfal_metrics_t* metrics, const char* plugin, const char* operation,
+    const char* url, gint64 elapsed_usec, gint64 bytes, gboolean failed);
+
+// histogram helpers
+guint gfal_metrics_bucket_index(guint64 value);
+
+guint64 gfal_metrics_bucket_upper(guint index);
+
+// extract the host part of url into buffer, empty if there is none
+void gfal_metrics_host_from_url(const char* url, char* buffer, size_t s_buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GFAL_METRICS_INTERNAL_H_ */
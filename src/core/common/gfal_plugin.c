@@ -31,6 +31,7 @@
 #include "gfal_constants.h"
 #include "gfal_error.h"
 #include "gfal_file_handler_container.h"
+#include "gfal_metrics_internal.h"
 #include <future/glib.h>
 
 #ifndef GFAL_PLUGIN_DIR_DEFAULT
@@ -58,6 +59,25 @@ plugin_handle gfal_get_plugin_handle(gfal_plugin_interface* cata_list)
 }
 
 
+// Start timing a plugin call, if metrics are enabled
+static gint64 gfal_plugin_metrics_begin(gfal2_context_t handle)
+{
+    return gfal_metrics_get(handle) ? g_get_monotonic_time() : 0;
+}
+
+
+// Account a finished plugin call, unless it was not timed
+static void gfal_plugin_metrics_end(gfal2_context_t handle, gfal_plugin_interface* p,
+    const char* operation, const char* url, gint64 start, gint64 bytes, GError* tmp_err)
+{
+    gfal_metrics_t* metrics = gfal_metrics_get(handle);
+    if (metrics == NULL || start == 0)
+        return;
+    gfal_metrics_record(metrics, p->getName(), operation, url,
+        g_get_monotonic_time() - start, bytes, tmp_err != NULL);
+}
+
+
 gboolean gfal_feature_is_supported(void *ptr, GQuark scope, const char *func_name, const char *surl, GError **err)
 {
     if (ptr == NULL) {
@@ -457,8 +477,11 @@ int gfal_plugins_accessG(gfal2_context_t handle, const char* path, int mode,
     gfal_plugin_interface* p = gfal_find_plugin(handle, path,
             GFAL_PLUGIN_ACCESS, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         res = p->accessG(gfal_get_plugin_handle(p), path, mode, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "access", path, start, 0, tmp_err);
+    }
 
     G_RETURN_ERR(res, tmp_err, err);
 }
@@ -473,8 +496,11 @@ int gfal_plugin_statG(gfal2_context_t handle, const char* path, struct stat* st,
     gfal_plugin_interface* p = gfal_find_plugin(handle, path, GFAL_PLUGIN_STAT,
             &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         res = p->statG(gfal_get_plugin_handle(p), path, st, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "stat", path, start, 0, tmp_err);
+    }
 
     G_RETURN_ERR(res, tmp_err, err);
 }
@@ -490,8 +516,11 @@ int gfal_plugin_lstatG(gfal2_context_t handle, const char* path, struct stat* st
     gfal_plugin_interface* p = gfal_find_plugin(handle, path, GFAL_PLUGIN_LSTAT,
             &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         res = p->lstatG(gfal_get_plugin_handle(p), path, st, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "lstat", path, start, 0, tmp_err);
+    }
 
     G_RETURN_ERR(res, tmp_err, err);
 }
@@ -508,9 +537,12 @@ ssize_t gfal_plugin_readlinkG(gfal2_context_t handle, const char* path, char* bu
     gfal_plugin_interface* p = gfal_find_plugin(handle, path,
             GFAL_PLUGIN_READLINK, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         resu = p->readlinkG(gfal_get_plugin_handle(p), path, buff, buffsiz,
                 &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "readlink", path, start, 0, tmp_err);
+    }
 
     G_RETURN_ERR(resu, tmp_err, err);
 }
@@ -526,8 +558,11 @@ int gfal_plugin_chmodG(gfal2_context_t handle, const char* path, mode_t mode, GE
 
     gfal_plugin_interface* p = gfal_find_plugin(handle, path, GFAL_PLUGIN_CHMOD, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         res = p->chmodG(gfal_get_plugin_handle(p), path, mode, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "chmod", path, start, 0, tmp_err);
+    }
 
     G_RETURN_ERR(res, tmp_err, err);
 }
@@ -544,8 +579,11 @@ int gfal_plugin_renameG(gfal2_context_t handle, const char* oldpath, const char*
     src_p = gfal_find_plugin(handle, oldpath, GFAL_PLUGIN_RENAME, &tmp_err);
     if (src_p) {
         dst_p = gfal_find_plugin(handle, newpath, GFAL_PLUGIN_RENAME, &tmp_err);
-        if (src_p == dst_p)
+        if (src_p == dst_p) {
+            const gint64 start = gfal_plugin_metrics_begin(handle);
             res = dst_p->renameG(gfal_get_plugin_handle(dst_p), oldpath, newpath, &tmp_err);
+            gfal_plugin_metrics_end(handle, dst_p, "rename", oldpath, start, 0, tmp_err);
+        }
     }
 
     G_RETURN_ERR(res, tmp_err, err);
@@ -578,8 +616,11 @@ int gfal_plugin_mkdirp(gfal2_context_t handle, const char* path, mode_t mode, gb
 
     gfal_plugin_interface* p = gfal_find_plugin(handle, path, GFAL_PLUGIN_MKDIR, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         res = p->mkdirpG(gfal_get_plugin_handle(p), path, mode, pflag, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "mkdir", path, start, 0, tmp_err);
+    }
 
     if (pflag && res < 0 && tmp_err->code == EEXIST) {
         g_error_free(tmp_err);
@@ -598,8 +639,11 @@ int gfal_plugin_rmdirG(gfal2_context_t handle, const char* path, GError** err)
     int res = -1;
     gfal_plugin_interface* p = gfal_find_plugin(handle, path, GFAL_PLUGIN_RMDIR, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         res = p->rmdirG(gfal_get_plugin_handle(p), path, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "rmdir", path, start, 0, tmp_err);
+    }
 
     G_RETURN_ERR(res, tmp_err, err);
 }
@@ -613,8 +657,11 @@ gfal_file_handle gfal_plugin_opendirG(gfal2_context_t handle, const char* name,
 
     gfal_plugin_interface* p = gfal_find_plugin(handle, name, GFAL_PLUGIN_OPENDIR, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         resu = p->opendirG(gfal_get_plugin_handle(p), name, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "opendir", name, start, 0, tmp_err);
+    }
 
     G_RETURN_ERR(resu, tmp_err, err);
 }
@@ -640,8 +687,11 @@ gfal_file_handle gfal_plugin_openG(gfal2_context_t handle, const char * path, in
 
     gfal_plugin_interface* p = gfal_find_plugin(handle, path, GFAL_PLUGIN_OPEN, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         resu = p->openG(gfal_get_plugin_handle(p), path, flag, mode, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "open", path, start, 0, tmp_err);
+    }
 
     G_RETURN_ERR(resu, tmp_err, err);
 }
@@ -701,8 +751,11 @@ ssize_t gfal_plugin_getxattrG(gfal2_context_t handle, const char* path, const ch
 
     gfal_plugin_interface* p = gfal_find_plugin(handle, path, GFAL_PLUGIN_GETXATTR, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         resu = p->getxattrG(gfal_get_plugin_handle(p), path, name, buff, s_buff, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "getxattr", path, start, 0, tmp_err);
+    }
 
     // If asking for checksum, and got an error, try ourselves
     if (resu < 0 && tmp_err) {
@@ -730,8 +783,11 @@ ssize_t gfal_plugin_listxattrG(gfal2_context_t handle, const char* path, char* l
 
     gfal_plugin_interface* p = gfal_find_plugin(handle, path, GFAL_PLUGIN_LISTXATTR, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         resu = p->listxattrG(gfal_get_plugin_handle(p), path, list, s_list, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "listxattr", path, start, 0, tmp_err);
+    }
 
     G_RETURN_ERR(resu, tmp_err, err);
 }
@@ -744,8 +800,11 @@ int gfal_plugin_setxattrG(gfal2_context_t handle, const char* path, const char*
 
     gfal_plugin_interface* p = gfal_find_plugin(handle, path, GFAL_PLUGIN_SETXATTR, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         resu = p->setxattrG(gfal_get_plugin_handle(p), path, name, value, size, flags, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "setxattr", path, start, 0, tmp_err);
+    }
     G_RETURN_ERR(resu, tmp_err, err);
 }
 
@@ -756,8 +815,11 @@ int gfal_plugin_readG(gfal2_context_t handle, gfal_file_handle fh, void* buff, s
     GError* tmp_err = NULL;
     int res = -1;
     gfal_plugin_interface* if_cata = gfal_plugin_map_file_handle(handle, fh, &tmp_err);
-    if (!tmp_err)
+    if (!tmp_err) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         res = if_cata->readG(if_cata->plugin_data, fh, buff, s_buff, &tmp_err);
+        gfal_plugin_metrics_end(handle, if_cata, "read", fh->path, start, res, tmp_err);
+    }
     G_RETURN_ERR(res, tmp_err, err);
 }
 
@@ -791,11 +853,13 @@ ssize_t gfal_plugin_preadG(gfal2_context_t handle, gfal_file_handle fh, void* bu
     ssize_t res = -1;
     gfal_plugin_interface* if_cata = gfal_plugin_map_file_handle(handle, fh, &tmp_err);
     if (!tmp_err) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         if (if_cata->preadG)
             res = if_cata->preadG(if_cata->plugin_data, fh, buff, s_buff, offset, &tmp_err);
         else {
             res = gfal_plugin_simulate_preadG(handle, if_cata, fh, buff, s_buff, offset, &tmp_err);
         }
+        gfal_plugin_metrics_end(handle, if_cata, "pread", fh->path, start, res, tmp_err);
     }
     G_RETURN_ERR(res, tmp_err, err);
 }
@@ -830,11 +894,69 @@ ssize_t gfal_plugin_pwriteG(gfal2_context_t handle, gfal_file_handle fh, void* b
     ssize_t res = -1;
     gfal_plugin_interface* if_cata = gfal_plugin_map_file_handle(handle, fh, &tmp_err);
     if (!tmp_err) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         if (if_cata->pwriteG)
             res = if_cata->pwriteG(if_cata->plugin_data, fh, buff, s_buff, offset, &tmp_err);
         else {
             res = gfal_plugin_simulate_pwriteG(handle, if_cata, fh, buff, s_buff, offset, &tmp_err);
         }
+        gfal_plugin_metrics_end(handle, if_cata, "pwrite", fh->path, start, res, tmp_err);
+    }
+    G_RETURN_ERR(res, tmp_err, err);
+}
+
+// Fallback for plugins without vectored read support: one pread per chunk
+static ssize_t gfal_plugin_simulate_vector_readG(gfal2_context_t handle, gfal_plugin_interface* if_cata,
+        gfal_file_handle fh, const gfal2_read_chunk_t* chunks, int nchunks, GError** err)
+{
+    GError* tmp_err = NULL;
+    ssize_t total = 0;
+    int i;
+
+    for (i = 0; i < nchunks && !tmp_err; ++i) {
+        size_t done = 0;
+        while (done < chunks[i].size) {
+            char* buff = (char*)chunks[i].buffer + done;
+            size_t s_buff = chunks[i].size - done;
+            off_t offset = chunks[i].offset + done;
+            ssize_t r;
+            if (if_cata->preadG)
+                r = if_cata->preadG(if_cata->plugin_data, fh, buff, s_buff, offset, &tmp_err);
+            else
+                r = gfal_plugin_simulate_preadG(handle, if_cata, fh, buff, s_buff, offset, &tmp_err);
+            if (r < 0)
+                break;
+            if (r == 0) {
+                g_set_error(&tmp_err, gfal2_get_plugins_quark(), EINVAL,
+                        "Chunk %d (offset %lld, size %zu) goes beyond the end of the file",
+                        i, (long long)chunks[i].offset, chunks[i].size);
+                break;
+            }
+            done += r;
+        }
+        total += done;
+    }
+
+    G_RETURN_ERR(tmp_err ? -1 : total, tmp_err, err);
+}
+
+// Execute a vectored read on the appropriate plugin
+ssize_t gfal_plugin_vector_readG(gfal2_context_t handle, gfal_file_handle fh, const gfal2_read_chunk_t* chunks,
+        int nchunks, GError** err)
+{
+    g_return_val_err_if_fail(handle && fh && (chunks || nchunks == 0) && nchunks >= 0, -1, err,
+            "[gfal_plugin_vector_readG] Invalid args ");
+    GError* tmp_err = NULL;
+    ssize_t res = -1;
+    gfal_plugin_interface* if_cata = gfal_plugin_map_file_handle(handle, fh, &tmp_err);
+    if (!tmp_err) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
+        if (if_cata->vector_readG)
+            res = if_cata->vector_readG(if_cata->plugin_data, fh, chunks, nchunks, &tmp_err);
+        else {
+            res = gfal_plugin_simulate_vector_readG(handle, if_cata, fh, chunks, nchunks, &tmp_err);
+        }
+        gfal_plugin_metrics_end(handle, if_cata, "vector_read", fh->path, start, res, tmp_err);
     }
     G_RETURN_ERR(res, tmp_err, err);
 }
@@ -859,8 +981,11 @@ int gfal_plugin_writeG(gfal2_context_t handle, gfal_file_handle fh, void* buff,
     GError* tmp_err = NULL;
     int res = -1;
     gfal_plugin_interface* if_cata = gfal_plugin_map_file_handle(handle, fh, &tmp_err);
-    if (!tmp_err)
+    if (!tmp_err) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         res = if_cata->writeG(if_cata->plugin_data, fh, buff, s_buff, &tmp_err);
+        gfal_plugin_metrics_end(handle, if_cata, "write", fh->path, start, res, tmp_err);
+    }
     G_RETURN_ERR(res, tmp_err, err);
 }
 
@@ -871,8 +996,11 @@ int gfal_plugin_unlinkG(gfal2_context_t handle, const char* path, GError** err)
     int resu = -1;
     gfal_plugin_interface* p = gfal_find_plugin(handle, path, GFAL_PLUGIN_UNLINK, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         resu = p->unlinkG(gfal_get_plugin_handle(p), path, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "unlink", path, start, 0, tmp_err);
+    }
     G_RETURN_ERR(resu, tmp_err, err);
 
 }
@@ -885,9 +1013,12 @@ int gfal_plugin_bring_onlineG(gfal2_context_t handle, const char* uri, time_t pi
     int resu = -1;
     gfal_plugin_interface* p = gfal_find_plugin(handle, uri, GFAL_PLUGIN_BRING_ONLINE, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         resu = p->bring_online(gfal_get_plugin_handle(p), uri, pintime, timeout, token, tsize,
                 async, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "bring_online", uri, start, 0, tmp_err);
+    }
     G_RETURN_ERR(resu, tmp_err, err);
 }
 
@@ -899,9 +1030,12 @@ int gfal_plugin_bring_online_v2G(gfal2_context_t handle, const char* uri, const
     int resu = -1;
     gfal_plugin_interface* p = gfal_find_plugin(handle, uri, GFAL_PLUGIN_BRING_ONLINE, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         resu = p->bring_online_v2(gfal_get_plugin_handle(p), uri, metadata, pintime, timeout, token, tsize,
                 async, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "bring_online", uri, start, 0, tmp_err);
+    }
     G_RETURN_ERR(resu, tmp_err, err);
 }
 
@@ -970,8 +1104,11 @@ int gfal_plugin_bring_online_pollG(gfal2_context_t handle, const char* uri, cons
     int resu = -1;
     gfal_plugin_interface* p = gfal_find_plugin(handle, uri, GFAL_PLUGIN_BRING_ONLINE, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         resu = p->bring_online_poll(gfal_get_plugin_handle(p), uri, token, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "bring_online_poll", uri, start, 0, tmp_err);
+    }
     G_RETURN_ERR(resu, tmp_err, err);
 }
 
@@ -983,8 +1120,11 @@ int gfal_plugin_release_fileG(gfal2_context_t handle, const char* uri, const cha
     int resu = -1;
     gfal_plugin_interface* p = gfal_find_plugin(handle, uri, GFAL_PLUGIN_BRING_ONLINE, &tmp_err);
 
-    if (p)
+    if (p) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
         resu = p->release_file(gfal_get_plugin_handle(p), uri, token, &tmp_err);
+        gfal_plugin_metrics_end(handle, p, "release_file", uri, start, 0, tmp_err);
+    }
     G_RETURN_ERR(resu, tmp_err, err);
 }
 
@@ -1041,6 +1181,50 @@ int gfal_plugin_bring_online_list_v2G(gfal2_context_t handle, int nbfiles, const
 }
 
 
+// Fan out callbacks for plugins that do not implement the bulk operations
+
+static int gfal_plugin_bring_online_poll_one(gfal2_context_t handle, const char* url, int index,
+        gpointer user_data, GError** err)
+{
+    int ret = gfal_plugin_bring_online_pollG(handle, url, (const char*)user_data, err);
+    if (ret == 0 && *err == NULL) {
+        gfal2_set_error(err, gfal2_get_plugins_quark(), EAGAIN, __func__, "File still queued");
+    }
+    return ret;
+}
+
+
+static int gfal_plugin_release_file_one(gfal2_context_t handle, const char* url, int index,
+        gpointer user_data, GError** err)
+{
+    return gfal_plugin_release_fileG(handle, url, (const char*)user_data, err);
+}
+
+
+static int gfal_plugin_unlink_one(gfal2_context_t handle, const char* url, int index,
+        gpointer user_data, GError** err)
+{
+    return gfal_plugin_unlinkG(handle, url, err);
+}
+
+
+static int gfal_plugin_stat_one(gfal2_context_t handle, const char* url, int index,
+        gpointer user_data, GError** err)
+{
+    struct stat* buffers = (struct stat*)user_data;
+    return gfal_plugin_statG(handle, url, &buffers[index], err);
+}
+
+
+static int gfal_plugin_archive_poll_one(gfal2_context_t handle, const char* url, int index,
+        gpointer user_data, GError** err)
+{
+    int* results = (int*)user_data;
+    results[index] = gfal_plugin_archive_pollG(handle, url, err);
+    return results[index];
+}
+
+
 int gfal_plugin_bring_online_poll_listG(gfal2_context_t handle, int nbfiles, const char* const* uris,
         const char* token, GError ** errors)
 {
@@ -1051,8 +1235,27 @@ int gfal_plugin_bring_online_poll_listG(gfal2_context_t handle, int nbfiles, con
     if (p && p->bring_online_poll_list) {
         resu = p->bring_online_poll_list(gfal_get_plugin_handle(p), nbfiles, uris, token, errors);
     }
+    // Fallback, poll each file
+    else if (p && p->bring_online_poll) {
+        gfal_plugin_fanout(handle, nbfiles, uris, gfal_plugin_bring_online_poll_one,
+            (gpointer)token, errors);
+        int i, nterminal = 0, nfailed = 0;
+        for (i = 0; i < nbfiles; ++i) {
+            if (errors[i] == NULL)
+                ++nterminal;
+            else if (errors[i]->code != EAGAIN) {
+                ++nterminal;
+                ++nfailed;
+            }
+        }
+        // As the native implementations, -1 when nothing made it
+        if (nfailed == nbfiles)
+            resu = -1;
+        else
+            resu = (nterminal == nbfiles);
+    }
     else {
-        if (p && !p->bring_online_poll_list) {
+        if (p) {
             gfal2_set_error(&tmp_err, gfal2_get_plugins_quark(), EPROTONOSUPPORT,
                     __func__, "The plugin does not implement bulk bring online polling");
         }
@@ -1076,8 +1279,14 @@ int gfal_plugin_release_file_listG(gfal2_context_t handle, int nbfiles, const ch
     if (p && p->release_file_list) {
         resu = p->release_file_list(gfal_get_plugin_handle(p), nbfiles, uris, token, errors);
     }
+    // Fallback, release each file
+    else if (p && p->release_file) {
+        int failures = gfal_plugin_fanout(handle, nbfiles, uris, gfal_plugin_release_file_one,
+            (gpointer)token, errors);
+        resu = failures ? -1 : 0;
+    }
     else {
-        if (p && !p->release_file_list) {
+        if (p) {
             gfal2_set_error(&tmp_err, gfal2_get_plugins_quark(), EPROTONOSUPPORT,
                     __func__, "The plugin does not implement bulk releases");
         }
@@ -1098,18 +1307,51 @@ int gfal_plugin_unlink_listG(gfal2_context_t handle, int nbfiles, const char* co
     gfal_plugin_interface* p = gfal_find_plugin(handle, *uris, GFAL_PLUGIN_UNLINK, &tmp_err);
 
     if (p) {
-        plugin_handle handle = gfal_get_plugin_handle(p);
         if (p->unlink_listG) {
-            resu = p->unlink_listG(handle, nbfiles, uris, errors);
+            resu = p->unlink_listG(gfal_get_plugin_handle(p), nbfiles, uris, errors);
         }
         // Fallback
         else {
-            int i;
-            resu = 0;
-            for (i = 0; i < nbfiles; ++i) {
-                resu += p->unlinkG(handle, uris[i], &(errors[i]));
-            }
+            int failures = gfal_plugin_fanout(handle, nbfiles, uris, gfal_plugin_unlink_one,
+                NULL, errors);
+            resu = failures ? -1 : 0;
+        }
+    }
+    else {
+        int i;
+        for (i = 0; i < nbfiles; ++i) {
+            errors[i] = g_error_copy(tmp_err);
         }
+        g_error_free(tmp_err);
+    }
+
+    return resu;
+}
+
+
+int gfal_plugin_stat_listG(gfal2_context_t handle, int nbfiles, const char* const* uris,
+        struct stat* buffers, GError ** errors)
+{
+    GError* tmp_err = NULL;
+    int resu = -1;
+    gfal_plugin_interface* p = gfal_find_plugin(handle, *uris, GFAL_PLUGIN_STAT, &tmp_err);
+
+    if (p && p->stat_listG) {
+        const gint64 start = gfal_plugin_metrics_begin(handle);
+        resu = p->stat_listG(gfal_get_plugin_handle(p), nbfiles, uris, buffers, errors);
+        // A failed call is accounted with the first error it reported
+        GError* first_err = NULL;
+        int i;
+        for (i = 0; resu < 0 && first_err == NULL && i < nbfiles; ++i) {
+            first_err = errors[i];
+        }
+        gfal_plugin_metrics_end(handle, p, "stat_list", *uris, start, 0, first_err);
+    }
+    // Fallback, the plugin is resolved per url
+    else if (p) {
+        int failures = gfal_plugin_fanout(handle, nbfiles, uris, gfal_plugin_stat_one,
+            buffers, errors);
+        resu = failures ? -1 : 0;
     }
     else {
         int i;
@@ -1166,8 +1408,30 @@ int gfal_plugin_archive_poll_listG(gfal2_context_t handle, int nbfiles, const ch
     if (p && p->archive_poll_list) {
         resu = p->archive_poll_list(gfal_get_plugin_handle(p), nbfiles, uris, errors);
     }
+    // Fallback, poll each file
+    else if (p && p->archive_poll) {
+        int* results = g_new0(int, nbfiles);
+        gfal_plugin_fanout(handle, nbfiles, uris, gfal_plugin_archive_poll_one, results, errors);
+        int i, ontape_count = 0, error_count = 0;
+        for (i = 0; i < nbfiles; ++i) {
+            if (errors[i] && errors[i]->code != EAGAIN)
+                ++error_count;
+            else if (results[i] == 1)
+                ++ontape_count;
+        }
+        g_free(results);
+
+        if (ontape_count == nbfiles)
+            resu = 1;
+        else if (error_count == nbfiles)
+            resu = -1;
+        else if (ontape_count + error_count == nbfiles)
+            resu = 2;
+        else
+            resu = 0;
+    }
     else {
-        if (p && !p->archive_poll_list) {
+        if (p) {
             gfal2_set_error(&tmp_err, gfal2_get_plugins_quark(), EPROTONOSUPPORT,
                             __func__, "The plugin does not support bulk archive polling");
         }
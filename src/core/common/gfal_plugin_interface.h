@@ -29,6 +29,7 @@
 #include "gfal_common.h"
 #include "gfal_constants.h"
 #include "gfal_file_handle.h"
+#include <file/gfal_file_api.h>
 #include <transfer/gfal_transfer_plugins.h>
 
 #include <glib.h>
@@ -742,9 +743,37 @@ struct _gfal_plugin_interface {
                             gboolean write_access, unsigned validity, const char* const* activities,
                             char* buff, size_t s_buff, GError** err);
 
+    // BULK NAMESPACE API
+
+  /**
+   * OPTIONAL: Bulk stat. If not implemented, the core issues concurrent statG calls
+   *
+   * @param plugin_data : internal plugin data
+   * @param nbfiles : number of files
+   * @param urls : urls of the files
+   * @param buffers : array of nbfiles stat structures to fill
+   * @param errors : pre-allocated array of nbfiles errors, set for each failed entry
+   * @return 0 if all entries succeeded, -1 otherwise
+   */
+  int (*stat_listG)(plugin_handle plugin_data, int nbfiles, const char* const* urls,
+                    struct stat* buffers, GError** errors);
+
+  /**
+   * OPTIONAL: Vectored read. If not implemented, the core issues one preadG per chunk
+   *
+   * @param plugin_data : internal plugin data
+   * @param fd : file handle
+   * @param chunks : array of nchunks chunks to read
+   * @param nchunks : number of chunks
+   * @param err : GError error support
+   * @return total number of read bytes, -1 if error
+   */
+  ssize_t (*vector_readG)(plugin_handle plugin_data, gfal_file_handle fd, const gfal2_read_chunk_t* chunks,
+                          int nchunks, GError** err);
+
       // reserved for future usage
 	 //! @cond
-     void* future[4];
+     void* future[2];
 	 //! @endcond
 };
 
@@ -755,6 +784,29 @@ struct _gfal_plugin_interface {
 int gfal2_register_plugin(gfal2_context_t handle, const gfal_plugin_interface* ifce,
         GError** error);
 
+/**
+ * Callback for \ref gfal_plugin_fanout
+ * @param handle : gfal2 context
+ * @param url : the url to process
+ * @param index : position of url in the list
+ * @param user_data : as passed to gfal_plugin_fanout
+ * @param err : error for this entry
+ * @return the result of the operation for this entry
+ */
+typedef int (*gfal_plugin_fanout_func)(gfal2_context_t handle, const char* url, int index,
+        gpointer user_data, GError** err);
+
+/**
+ * Call func once for each url, concurrently, over a pool of workers owned by the context
+ * At most CORE:FANOUT_THREADS entries run at the same time, and at most
+ * CORE:FANOUT_PER_HOST for the same host. The calling thread takes part in the processing.
+ * Pending entries are failed with ECANCELED if the context is canceled.
+ * @param errors : pre-allocated array of nbfiles errors, set for each failed entry
+ * @return the number of entries that failed
+ */
+int gfal_plugin_fanout(gfal2_context_t handle, int nbfiles, const char* const* uris,
+        gfal_plugin_fanout_func func, gpointer user_data, GError** errors);
+
 
 // internal API for inter plugin communication
 //! @cond
@@ -785,6 +837,8 @@ int gfal_plugin_readG(gfal2_context_t handle, gfal_file_handle fh, void* buff, s
 
 ssize_t gfal_plugin_preadG(gfal2_context_t handle, gfal_file_handle fh, void* buff, size_t s_buff, off_t offset, GError** err);
 ssize_t gfal_plugin_pwriteG(gfal2_context_t handle, gfal_file_handle fh, void* buff, size_t s_buff, off_t offset, GError** err);
+ssize_t gfal_plugin_vector_readG(gfal2_context_t handle, gfal_file_handle fh, const gfal2_read_chunk_t* chunks,
+        int nchunks, GError** err);
 
 
 int gfal_plugin_unlinkG(gfal2_context_t handle, const char* path, GError** err);
@@ -834,6 +888,9 @@ int gfal_plugin_release_file_listG(gfal2_context_t handle, int nbfiles, const ch
 
 int gfal_plugin_unlink_listG(gfal2_context_t handle, int nbfiles, const char* const* uris, GError ** errors);
 
+int gfal_plugin_stat_listG(gfal2_context_t handle, int nbfiles, const char* const* uris,
+                           struct stat* buffers, GError ** errors);
+
 int gfal_plugin_abort_filesG(gfal2_context_t handle, int nbfiles, const char* const* uris, const char* token, GError ** err);
 
 ssize_t gfal_plugin_qos_check_classes(gfal2_context_t handle, const char* url, const char* type,
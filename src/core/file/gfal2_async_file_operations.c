@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <file/gfal_file_api.h>
+#include <file/gfal_async_api.h>
+
+#include <common/gfal_handle.h>
+#include <common/gfal_error.h>
+#include <common/gfal_config.h>
+#include <logger/gfal_logger.h>
+
+#define GFAL_ASYNC_DEFAULT_THREADS 8
+
+
+typedef ssize_t (*gfal_async_run_t)(gfal2_async_op_t op, GError** err);
+
+
+struct _gfal2_async_op {
+    gint ref_count;
+    gfal2_context_t context;
+    gfal_async_run_t run;
+
+    // arguments
+    char* url;
+    char* url2;
+    char* check_type;
+    int fd;
+    int mode;
+    void* buffer;
+    size_t count;
+    off_t offset;
+    size_t length;
+
+    // completion
+    gfal2_async_callback_t callback;
+    gpointer user_data;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    gboolean done;
+    ssize_t result;
+    GError* error;
+};
+
+
+static void gfal_async_op_unref(gfal2_async_op_t op)
+{
+    if (g_atomic_int_dec_and_test(&op->ref_count)) {
+        pthread_mutex_destroy(&op->lock);
+        pthread_cond_destroy(&op->cond);
+        g_free(op->url);
+        g_free(op->url2);
+        g_free(op->check_type);
+        g_clear_error(&op->error);
+        g_free(op);
+    }
+}
+
+
+static void gfal_async_worker(gpointer data, gpointer user_data)
+{
+    gfal2_async_op_t op = (gfal2_async_op_t)data;
+    GError* tmp_err = NULL;
+
+    ssize_t result = op->run(op, &tmp_err);
+
+    pthread_mutex_lock(&op->lock);
+    op->result = result;
+    op->error = tmp_err;
+    op->done = TRUE;
+    pthread_cond_broadcast(&op->cond);
+    pthread_mutex_unlock(&op->lock);
+
+    if (op->callback)
+        op->callback(op, op->user_data);
+
+    // Release the reference held by the executor
+    gfal_async_op_unref(op);
+}
+
+
+// The executor is created on first use, so ASYNC_THREADS can be changed
+// after the creation of the context
+static GThreadPool* gfal_async_get_executor(gfal2_context_t context, GError** err)
+{
+    GThreadPool* pool = g_atomic_pointer_get(&context->async_pool);
+    if (pool)
+        return pool;
+
+    gint max_threads = gfal2_get_opt_integer_with_default(context, "CORE", "ASYNC_THREADS",
+        GFAL_ASYNC_DEFAULT_THREADS);
+    if (max_threads <= 0)
+        max_threads = GFAL_ASYNC_DEFAULT_THREADS;
+
+    GError* tmp_err = NULL;
+    pool = g_thread_pool_new(gfal_async_worker, NULL, max_threads, FALSE, &tmp_err);
+    if (pool == NULL) {
+        gfal2_propagate_prefixed_error(err, tmp_err, __func__);
+        return NULL;
+    }
+
+    if (!g_atomic_pointer_compare_and_exchange(&context->async_pool, NULL, pool)) {
+        // Someone else was faster
+        g_thread_pool_free(pool, TRUE, FALSE);
+        pool = g_atomic_pointer_get(&context->async_pool);
+    }
+    else {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "Asynchronous executor started with up to %d threads", max_threads);
+    }
+    return pool;
+}
+
+
+static gfal2_async_op_t gfal_async_op_new(gfal2_context_t context, gfal_async_run_t run,
+    gfal2_async_callback_t callback, gpointer user_data)
+{
+    gfal2_async_op_t op = g_new0(struct _gfal2_async_op, 1);
+    op->ref_count = 1;
+    op->context = context;
+    op->run = run;
+    op->fd = -1;
+    op->result = -1;
+    op->callback = callback;
+    op->user_data = user_data;
+    pthread_mutex_init(&op->lock, NULL);
+    pthread_cond_init(&op->cond, NULL);
+    return op;
+}
+
+
+static gfal2_async_op_t gfal_async_submit(gfal2_async_op_t op, GError** err)
+{
+    GError* tmp_err = NULL;
+    GThreadPool* pool = gfal_async_get_executor(op->context, &tmp_err);
+
+    if (pool) {
+        // One reference for the caller, one for the executor
+        g_atomic_int_inc(&op->ref_count);
+        g_thread_pool_push(pool, op, &tmp_err);
+        if (tmp_err) {
+            g_atomic_int_add(&op->ref_count, -1);
+        }
+    }
+
+    if (tmp_err) {
+        gfal_async_op_unref(op);
+        gfal2_propagate_prefixed_error(err, tmp_err, __func__);
+        return NULL;
+    }
+    return op;
+}
+
+
+static ssize_t gfal_async_run_stat(gfal2_async_op_t op, GError** err)
+{
+    return gfal2_stat(op->context, op->url, (struct stat*)op->buffer, err);
+}
+
+
+static ssize_t gfal_async_run_lstat(gfal2_async_op_t op, GError** err)
+{
+    return gfal2_lstat(op->context, op->url, (struct stat*)op->buffer, err);
+}
+
+
+static ssize_t gfal_async_run_access(gfal2_async_op_t op, GError** err)
+{
+    return gfal2_access(op->context, op->url, op->mode, err);
+}
+
+
+static ssize_t gfal_async_run_unlink(gfal2_async_op_t op, GError** err)
+{
+    return gfal2_unlink(op->context, op->url, err);
+}
+
+
+static ssize_t gfal_async_run_mkdir(gfal2_async_op_t op, GError** err)
+{
+    return gfal2_mkdir(op->context, op->url, (mode_t)op->mode, err);
+}
+
+
+static ssize_t gfal_async_run_rmdir(gfal2_async_op_t op, GError** err)
+{
+    return gfal2_rmdir(op->context, op->url, err);
+}
+
+
+static ssize_t gfal_async_run_rename(gfal2_async_op_t op, GError** err)
+{
+    return gfal2_rename(op->context, op->url, op->url2, err);
+}
+
+
+static ssize_t gfal_async_run_checksum(gfal2_async_op_t op, GError** err)
+{
+    return gfal2_checksum(op->context, op->url, op->check_type, op->offset, op->length,
+        (char*)op->buffer, op->count, err);
+}
+
+
+static ssize_t gfal_async_run_pread(gfal2_async_op_t op, GError** err)
+{
+    return gfal2_pread(op->context, op->fd, op->buffer, op->count, op->offset, err);
+}
+
+
+static ssize_t gfal_async_run_pwrite(gfal2_async_op_t op, GError** err)
+{
+    return gfal2_pwrite(op->context, op->fd, op->buffer, op->count, op->offset, err);
+}
+
+
+gfal2_async_op_t gfal2_async_stat(gfal2_context_t context, const char* url, struct stat* buff,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err)
+{
+    g_return_val_err_if_fail(context && url && buff, NULL, err, "[gfal2_async_stat] Invalid arguments");
+    gfal2_async_op_t op = gfal_async_op_new(context, gfal_async_run_stat, callback, user_data);
+    op->url = g_strdup(url);
+    op->buffer = buff;
+    return gfal_async_submit(op, err);
+}
+
+
+gfal2_async_op_t gfal2_async_lstat(gfal2_context_t context, const char* url, struct stat* buff,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err)
+{
+    g_return_val_err_if_fail(context && url && buff, NULL, err, "[gfal2_async_lstat] Invalid arguments");
+    gfal2_async_op_t op = gfal_async_op_new(context, gfal_async_run_lstat, callback, user_data);
+    op->url = g_strdup(url);
+    op->buffer = buff;
+    return gfal_async_submit(op, err);
+}
+
+
+gfal2_async_op_t gfal2_async_access(gfal2_context_t context, const char* url, int amode,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err)
+{
+    g_return_val_err_if_fail(context && url, NULL, err, "[gfal2_async_access] Invalid arguments");
+    gfal2_async_op_t op = gfal_async_op_new(context, gfal_async_run_access, callback, user_data);
+    op->url = g_strdup(url);
+    op->mode = amode;
+    return gfal_async_submit(op, err);
+}
+
+
+gfal2_async_op_t gfal2_async_unlink(gfal2_context_t context, const char* url,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err)
+{
+    g_return_val_err_if_fail(context && url, NULL, err, "[gfal2_async_unlink] Invalid arguments");
+    gfal2_async_op_t op = gfal_async_op_new(context, gfal_async_run_unlink, callback, user_data);
+    op->url = g_strdup(url);
+    return gfal_async_submit(op, err);
+}
+
+
+gfal2_async_op_t gfal2_async_mkdir(gfal2_context_t context, const char* url, mode_t mode,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err)
+{
+    g_return_val_err_if_fail(context && url, NULL, err, "[gfal2_async_mkdir] Invalid arguments");
+    gfal2_async_op_t op = gfal_async_op_new(context, gfal_async_run_mkdir, callback, user_data);
+    op->url = g_strdup(url);
+    op->mode = mode;
+    return gfal_async_submit(op, err);
+}
+
+
+gfal2_async_op_t gfal2_async_rmdir(gfal2_context_t context, const char* url,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err)
+{
+    g_return_val_err_if_fail(context && url, NULL, err, "[gfal2_async_rmdir] Invalid arguments");
+    gfal2_async_op_t op = gfal_async_op_new(context, gfal_async_run_rmdir, callback, user_data);
+    op->url = g_strdup(url);
+    return gfal_async_submit(op, err);
+}
+
+
+gfal2_async_op_t gfal2_async_rename(gfal2_context_t context, const char* oldurl, const char* newurl,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err)
+{
+    g_return_val_err_if_fail(context && oldurl && newurl, NULL, err, "[gfal2_async_rename] Invalid arguments");
+    gfal2_async_op_t op = gfal_async_op_new(context, gfal_async_run_rename, callback, user_data);
+    op->url = g_strdup(oldurl);
+    op->url2 = g_strdup(newurl);
+    return gfal_async_submit(op, err);
+}
+
+
+gfal2_async_op_t gfal2_async_checksum(gfal2_context_t context, const char* url, const char* check_type,
+    off_t start_offset, size_t data_length, char* checksum_buffer, size_t buffer_length,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err)
+{
+    g_return_val_err_if_fail(context && url && check_type && checksum_buffer && buffer_length, NULL, err,
+        "[gfal2_async_checksum] Invalid arguments");
+    gfal2_async_op_t op = gfal_async_op_new(context, gfal_async_run_checksum, callback, user_data);
+    op->url = g_strdup(url);
+    op->check_type = g_strdup(check_type);
+    op->offset = start_offset;
+    op->length = data_length;
+    op->buffer = checksum_buffer;
+    op->count = buffer_length;
+    return gfal_async_submit(op, err);
+}
+
+
+gfal2_async_op_t gfal2_async_pread(gfal2_context_t context, int fd, void* buffer, size_t count, off_t offset,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err)
+{
+    g_return_val_err_if_fail(context && buffer, NULL, err, "[gfal2_async_pread] Invalid arguments");
+    gfal2_async_op_t op = gfal_async_op_new(context, gfal_async_run_pread, callback, user_data);
+    op->fd = fd;
+    op->buffer = buffer;
+    op->count = count;
+    op->offset = offset;
+    return gfal_async_submit(op, err);
+}
+
+
+gfal2_async_op_t gfal2_async_pwrite(gfal2_context_t context, int fd, const void* buffer, size_t count, off_t offset,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err)
+{
+    g_return_val_err_if_fail(context && buffer, NULL, err, "[gfal2_async_pwrite] Invalid arguments");
+    gfal2_async_op_t op = gfal_async_op_new(context, gfal_async_run_pwrite, callback, user_data);
+    op->fd = fd;
+    op->buffer = (void*)buffer;
+    op->count = count;
+    op->offset = offset;
+    return gfal_async_submit(op, err);
+}
+
+
+ssize_t gfal2_async_wait(gfal2_async_op_t op, GError** err)
+{
+    g_return_val_err_if_fail(op, -1, err, "[gfal2_async_wait] Invalid operation handle");
+
+    pthread_mutex_lock(&op->lock);
+    while (!op->done)
+        pthread_cond_wait(&op->cond, &op->lock);
+    pthread_mutex_unlock(&op->lock);
+
+    if (op->error && err)
+        *err = g_error_copy(op->error);
+    return op->result;
+}
+
+
+gboolean gfal2_async_is_done(gfal2_async_op_t op)
+{
+    gboolean done;
+    pthread_mutex_lock(&op->lock);
+    done = op->done;
+    pthread_mutex_unlock(&op->lock);
+    return done;
+}
+
+
+void gfal2_async_free(gfal2_async_op_t op)
+{
+    if (op)
+        gfal_async_op_unref(op);
+}
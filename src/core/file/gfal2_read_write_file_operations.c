@@ -163,6 +163,26 @@ ssize_t gfal2_pread(gfal2_context_t handle, int fd, void *buff, size_t s_buff, o
 }
 
 
+ssize_t gfal2_vector_read(gfal2_context_t handle, int fd, const gfal2_read_chunk_t* chunks, int nchunks, GError **err)
+{
+    GError *tmp_err = NULL;
+    ssize_t res = -1;
+    GFAL2_BEGIN_SCOPE_CANCEL(handle, -1, err);
+    if (fd <= 0 || handle == NULL) {
+        g_set_error(&tmp_err, gfal2_get_core_quark(), EBADF, "Incorrect file descriptor or incorrect handle");
+    }
+    else {
+        const int key = fd;
+        gfal_file_handle fh = gfal_file_handle_bind(handle->fdescs, key, &tmp_err);
+        if (fh != NULL) {
+            res = gfal_plugin_vector_readG(handle, fh, chunks, nchunks, &tmp_err);
+        }
+    }
+    GFAL2_END_SCOPE_CANCEL(handle);
+    G_RETURN_ERR(res, tmp_err, err);
+}
+
+
 ssize_t gfal2_write(gfal2_context_t handle, int fd, const void *buff, size_t s_buff, GError **err)
 {
     GError *tmp_err = NULL;
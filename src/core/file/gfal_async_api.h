@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef GFAL_ASYNC_API_H_
+#define GFAL_ASYNC_API_H_
+
+#if !defined(__GFAL2_H_INSIDE__) && !defined(__GFAL2_BUILD__)
+#   warning "Direct inclusion of gfal2 headers is deprecated. Please, include only gfal_api.h or gfal_plugins_api.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <glib.h>
+
+#include <common/gfal_common.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*!
+    \defgroup async_group GFAL 2.0 asynchronous file API
+
+    Non blocking variants of the \ref file_group operations.
+
+    Operations are queued into an executor owned by the context, and run by a
+    bounded pool of worker threads (CORE:ASYNC_THREADS).
+    Each submission returns a handle that can be waited on, and optionally
+    fires a callback from the worker thread once the operation is done.
+
+    Any buffer passed to an asynchronous operation must remain valid until
+    the operation completes.
+*/
+
+/*!
+    \addtogroup async_group
+    @{
+*/
+
+/**
+ * Handle to a submitted asynchronous operation
+ */
+typedef struct _gfal2_async_op* gfal2_async_op_t;
+
+/**
+ * Completion callback. It is called from a worker thread once the operation
+ * is done, so it can not use \ref gfal2_async_wait to block on other operations
+ * of the same context.
+ * The handle remains valid during the call, even if the submitter already released it.
+ */
+typedef void (*gfal2_async_callback_t)(gfal2_async_op_t op, gpointer user_data);
+
+/**
+ * @brief Asynchronous \ref gfal2_stat
+ * @param context : gfal2 handle, see \ref gfal2_context_new
+ * @param url : url of the file
+ * @param buff : stat structure filled on completion
+ * @param callback : completion callback, can be NULL
+ * @param user_data : passed as is to the callback
+ * @param err : GError error report
+ * @return a handle to be released with \ref gfal2_async_free, NULL if the operation could not be queued
+ * @version 2.24.0
+ */
+gfal2_async_op_t gfal2_async_stat(gfal2_context_t context, const char* url, struct stat* buff,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err);
+
+/**
+ * @brief Asynchronous \ref gfal2_lstat
+ * @version 2.24.0
+ */
+gfal2_async_op_t gfal2_async_lstat(gfal2_context_t context, const char* url, struct stat* buff,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err);
+
+/**
+ * @brief Asynchronous \ref gfal2_access
+ * @version 2.24.0
+ */
+gfal2_async_op_t gfal2_async_access(gfal2_context_t context, const char* url, int amode,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err);
+
+/**
+ * @brief Asynchronous \ref gfal2_unlink
+ * @version 2.24.0
+ */
+gfal2_async_op_t gfal2_async_unlink(gfal2_context_t context, const char* url,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err);
+
+/**
+ * @brief Asynchronous \ref gfal2_mkdir
+ * @version 2.24.0
+ */
+gfal2_async_op_t gfal2_async_mkdir(gfal2_context_t context, const char* url, mode_t mode,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err);
+
+/**
+ * @brief Asynchronous \ref gfal2_rmdir
+ * @version 2.24.0
+ */
+gfal2_async_op_t gfal2_async_rmdir(gfal2_context_t context, const char* url,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err);
+
+/**
+ * @brief Asynchronous \ref gfal2_rename
+ * @version 2.24.0
+ */
+gfal2_async_op_t gfal2_async_rename(gfal2_context_t context, const char* oldurl, const char* newurl,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err);
+
+/**
+ * @brief Asynchronous \ref gfal2_checksum
+ * @version 2.24.0
+ */
+gfal2_async_op_t gfal2_async_checksum(gfal2_context_t context, const char* url, const char* check_type,
+    off_t start_offset, size_t data_length, char* checksum_buffer, size_t buffer_length,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err);
+
+/**
+ * @brief Asynchronous \ref gfal2_pread
+ * @version 2.24.0
+ */
+gfal2_async_op_t gfal2_async_pread(gfal2_context_t context, int fd, void* buffer, size_t count, off_t offset,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err);
+
+/**
+ * @brief Asynchronous \ref gfal2_pwrite
+ * @version 2.24.0
+ */
+gfal2_async_op_t gfal2_async_pwrite(gfal2_context_t context, int fd, const void* buffer, size_t count, off_t offset,
+    gfal2_async_callback_t callback, gpointer user_data, GError** err);
+
+/**
+ * @brief Wait for the completion of an operation
+ * @param op : operation handle
+ * @param err : set to a copy of the operation error, if any
+ * @return the return value of the synchronous equivalent
+ * @version 2.24.0
+ */
+ssize_t gfal2_async_wait(gfal2_async_op_t op, GError** err);
+
+/**
+ * @brief Non blocking check for completion
+ * @return TRUE if the operation is done
+ * @version 2.24.0
+ */
+gboolean gfal2_async_is_done(gfal2_async_op_t op);
+
+/**
+ * @brief Release an operation handle
+ * This does not cancel the operation: a pending operation still runs, and its callback is still called.
+ * @version 2.24.0
+ */
+void gfal2_async_free(gfal2_async_op_t op);
+
+/**
+    @}
+    End of the ASYNC group
+*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GFAL_ASYNC_API_H_ */
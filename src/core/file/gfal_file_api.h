@@ -563,6 +563,24 @@ int gfal2_release_file_list(gfal2_context_t context, int nbfiles, const char* co
  */
 int gfal2_unlink_list(gfal2_context_t context, int nbfiles, const char* const* urls, GError ** errors);
 
+/**
+ * @brief Perform a bulk stat
+ *
+ * @param context : gfal2 handle, see \ref gfal2_context_new
+ * @param nbfiles : number of files
+ * @param urls    : urls of the files
+ * @param buffers : Pre-allocated array of nbfiles stat structures
+ * @param errors  : Pre-allocated array with nbfiles pointers to errors.
+ *                  It is the user's responsability to allocate and free.
+ * @return 0 if all the entries succeeded, -1 otherwise. errors is set for the failed entries
+ * @note The plugin tried will be the one that matches the first url
+ * @note If bulk stat is not supported, gfal2_stat will be called concurrently for each url,
+ *       up to CORE:FANOUT_THREADS at a time, and CORE:FANOUT_PER_HOST per host
+ * @version 2.24.0
+ */
+int gfal2_stat_list(gfal2_context_t context, int nbfiles, const char* const* urls,
+        struct stat* buffers, GError ** errors);
+
 /**
  * @brief abort a list of files
  * @param context : gfal2 handle, see \ref gfal2_context_new
@@ -744,6 +762,34 @@ ssize_t gfal2_pread(gfal2_context_t context, int fd, void * buffer, size_t count
  */
 ssize_t gfal2_pwrite(gfal2_context_t context, int fd, const void * buffer, size_t count, off_t offset, GError ** err);
 
+/**
+ * A single chunk of a vectored read, see \ref gfal2_vector_read
+ */
+typedef struct gfal2_read_chunk {
+    off_t offset;   /**< offset in the file */
+    size_t size;    /**< number of bytes to read */
+    void* buffer;   /**< destination, at least size bytes long */
+} gfal2_read_chunk_t;
+
+/**
+ * @brief read several chunks of a file in one operation
+ *
+ * Protocols able to do so issue all the chunks in a single request. For the others,
+ * the chunks are read one after the other with \ref gfal2_pread.
+ * Each chunk is either fully read, or the call fails; a chunk beyond the end of the file
+ * is an error.
+ *
+ * @param context : gfal2 handle, see \ref gfal2_context_new
+ * @param fd : file descriptor
+ * @param chunks : array of nchunks chunks to read
+ * @param nchunks : number of chunks
+ * @param err : GError error report
+ * @return total number of read bytes, -1 on failure, set err properly in case of error.
+ * @version 2.24.0
+ */
+ssize_t gfal2_vector_read(gfal2_context_t context, int fd, const gfal2_read_chunk_t* chunks, int nchunks,
+        GError ** err);
+
 /**
     @}
     End of the FILE group
@@ -95,6 +95,7 @@ extern GQuark GFAL_EVENT_CLEANUP;         /**< Triggered after a delete to clean
 #define GFAL_TRANSFER_TYPE_STREAMED "streamed"
 #define GFAL_TRANSFER_TYPE_PUSH "3rd push"
 #define GFAL_TRANSFER_TYPE_PULL "3rd pull"
+#define GFAL_TRANSFER_TYPE_LOCAL "local"
 
 /**
  * Enable or disable DNS resolution within the copy function
@@ -131,6 +132,36 @@ typedef struct _gfalt_event* gfalt_event_t;
  */
 typedef void (*gfalt_event_func)(const gfalt_event_t e, gpointer user_data);
 
+/** Maximum number of numeric payload values carried by an event record */
+#define GFALT_EVENT_MAX_VALUES 4
+
+/** Size of the description buffer of an event record */
+#define GFALT_EVENT_DESCRIPTION_SIZE 512
+
+/**
+ * @brief Binary event record, as delivered to event streams.
+ * The description is only formatted if the stream was created with
+ * \ref GFALT_EVENT_STREAM_TEXT, otherwise it is an empty string.
+ */
+typedef struct _gfalt_event_record {
+    gfal_event_side_t side;         /**< Which side triggered the stage change */
+    gint64            timestamp;    /**< Wall-clock timestamp in milliseconds */
+    gint64            monotonic;    /**< Monotonic timestamp in microseconds */
+    GQuark            stage;        /**< Stage. You can check the predefined ones. */
+    GQuark            domain;       /**< Domain/protocol of this stage. i.e. SRM*/
+    guint             n_values;     /**< Number of valid entries in values */
+    gint64            values[GFALT_EVENT_MAX_VALUES]; /**< Numeric payload, meaning depends on the stage */
+    char              description[GFALT_EVENT_DESCRIPTION_SIZE]; /**< Additional description */
+} gfalt_event_record_t;
+
+/**
+ * Event stream: a bounded single-consumer ring of event records
+ */
+typedef struct _gfalt_event_stream* gfalt_event_stream_t;
+
+/** Ask for the description of the records to be formatted */
+#define GFALT_EVENT_STREAM_TEXT 0x01
+
 /**
  * Checksum verification mode
  */
@@ -173,6 +204,8 @@ guint64 gfalt_get_timeout(gfalt_params_t handle, GError** err);
 
 /**
  * Define the maximum number of parallels connexion to use for the file transfer
+ * Streamed copies split large files between this many pread/pwrite streams
+ * when both plugins implement them
  */
 gint gfalt_set_nbstreams(gfalt_params_t, guint nbstreams, GError** err);
 
@@ -429,6 +462,51 @@ gint gfalt_add_event_callback(gfalt_params_t params, gfalt_event_func callback,
  */
 gint gfalt_remove_event_callback(gfalt_params_t params, gfalt_event_func callback, GError** err);
 
+/**
+ * @brief Create a new event stream
+ * Records are kept in a ring of the given capacity (rounded up to a power of two).
+ * When the ring is full, new records are dropped and accounted in \ref gfalt_event_stream_dropped
+ * @param capacity : maximum number of records pending to be consumed
+ * @param flags : 0 or GFALT_EVENT_STREAM_TEXT
+ * @version 2.24.0
+ */
+gfalt_event_stream_t gfalt_event_stream_new(guint capacity, int flags, GError** err);
+
+/**
+ * @brief Release an event stream
+ * The stream is effectively freed once it is not attached anymore to any parameter handle
+ */
+void gfalt_event_stream_free(gfalt_event_stream_t stream);
+
+/**
+ * @brief Retrieve the oldest pending record
+ * Only one thread may consume a given stream.
+ * @return TRUE if a record has been copied into record, FALSE if the stream is empty
+ */
+gboolean gfalt_event_stream_pop(gfalt_event_stream_t stream, gfalt_event_record_t* record);
+
+/**
+ * @brief Number of records dropped because the stream was full
+ */
+guint gfalt_event_stream_dropped(gfalt_event_stream_t stream);
+
+/**
+ * @brief Format a record the same way the event log line is formatted
+ * @return the number of characters that would have been written, as snprintf
+ */
+int gfalt_event_record_to_string(const gfalt_event_record_t* record, char* buffer, size_t s_buffer);
+
+/**
+ * @brief Attach an event stream to the parameters
+ * Attaching the same stream twice has no effect
+ */
+gint gfalt_add_event_stream(gfalt_params_t params, gfalt_event_stream_t stream, GError** err);
+
+/**
+ * @brief Detach an event stream from the parameters
+ */
+gint gfalt_remove_event_stream(gfalt_params_t params, gfalt_event_stream_t stream, GError** err);
+
 /**
  *	@brief copy function
  *  start a synchronous copy of the file
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <glib.h>
+
+#include <common/gfal_error.h>
+#include "gfal_transfer_internal.h"
+
+//
+// Event streams
+// Single consumer ring of fixed size records. The consumer side never blocks;
+// producers are serialized with a lock since a transfer may trigger events
+// from the callback threads of the underlying protocol library.
+//
+
+struct _gfalt_event_stream {
+    gint ref_count;
+    int flags;
+    guint capacity;
+    guint mask;
+    // head is only written by producers, tail only by the consumer
+    gint head;
+    gint tail;
+    gint dropped;
+    pthread_mutex_t producer_lock;
+    gfalt_event_record_t* slots;
+};
+
+
+gfalt_event_stream_t gfalt_event_stream_new(guint capacity, int flags, GError** err)
+{
+    g_return_val_err_if_fail(capacity > 0, NULL, err, "[BUG] invalid event stream capacity");
+
+    guint rounded = 1;
+    while (rounded < capacity)
+        rounded <<= 1;
+
+    gfalt_event_stream_t stream = g_new0(struct _gfalt_event_stream, 1);
+    stream->ref_count = 1;
+    stream->flags = flags;
+    stream->capacity = rounded;
+    stream->mask = rounded - 1;
+    stream->slots = g_new0(gfalt_event_record_t, rounded);
+    pthread_mutex_init(&stream->producer_lock, NULL);
+    return stream;
+}
+
+
+gfalt_event_stream_t gfalt_event_stream_ref(gfalt_event_stream_t stream)
+{
+    g_atomic_int_inc(&stream->ref_count);
+    return stream;
+}
+
+
+void gfalt_event_stream_free(gfalt_event_stream_t stream)
+{
+    if (stream && g_atomic_int_dec_and_test(&stream->ref_count)) {
+        pthread_mutex_destroy(&stream->producer_lock);
+        g_free(stream->slots);
+        g_free(stream);
+    }
+}
+
+
+gboolean gfalt_event_stream_wants_text(gfalt_event_stream_t stream)
+{
+    return (stream->flags & GFALT_EVENT_STREAM_TEXT) != 0;
+}
+
+
+void gfalt_event_stream_push(gfalt_event_stream_t stream, const gfalt_event_record_t* record)
+{
+    pthread_mutex_lock(&stream->producer_lock);
+
+    const guint head = (guint)g_atomic_int_get(&stream->head);
+    const guint tail = (guint)g_atomic_int_get(&stream->tail);
+
+    if (head - tail >= stream->capacity) {
+        g_atomic_int_inc(&stream->dropped);
+    }
+    else {
+        gfalt_event_record_t* slot = &stream->slots[head & stream->mask];
+        // Copy only the header, and the description if it was formatted
+        memcpy(slot, record, G_STRUCT_OFFSET(gfalt_event_record_t, description));
+        if (stream->flags & GFALT_EVENT_STREAM_TEXT)
+            g_strlcpy(slot->description, record->description, sizeof(slot->description));
+        else
+            slot->description[0] = '\0';
+        // Publish
+        g_atomic_int_set(&stream->head, (gint)(head + 1));
+    }
+
+    pthread_mutex_unlock(&stream->producer_lock);
+}
+
+
+gboolean gfalt_event_stream_pop(gfalt_event_stream_t stream, gfalt_event_record_t* record)
+{
+    const guint tail = (guint)g_atomic_int_get(&stream->tail);
+    const guint head = (guint)g_atomic_int_get(&stream->head);
+
+    if (tail == head)
+        return FALSE;
+
+    const gfalt_event_record_t* slot = &stream->slots[tail & stream->mask];
+    memcpy(record, slot, G_STRUCT_OFFSET(gfalt_event_record_t, description));
+    g_strlcpy(record->description, slot->description, sizeof(record->description));
+
+    // Release the slot
+    g_atomic_int_set(&stream->tail, (gint)(tail + 1));
+    return TRUE;
+}
+
+
+guint gfalt_event_stream_dropped(gfalt_event_stream_t stream)
+{
+    return (guint)g_atomic_int_get(&stream->dropped);
+}
+
+
+static const char* gfalt_event_side_str(gfal_event_side_t side)
+{
+    switch (side) {
+        case GFAL_EVENT_SOURCE:
+            return "SOURCE";
+        case GFAL_EVENT_DESTINATION:
+            return "DESTINATION";
+        default:
+            return "BOTH";
+    }
+}
+
+
+int gfalt_event_record_to_string(const gfalt_event_record_t* record, char* buffer, size_t s_buffer)
+{
+    return snprintf(buffer, s_buffer, "%s %s %s %s", gfalt_event_side_str(record->side),
+            g_quark_to_string(record->domain), g_quark_to_string(record->stage),
+            record->description);
+}
@@ -55,6 +55,8 @@ struct _gfalt_params_t {
     // callback lists
     GSList *monitor_callbacks;
     GSList *event_callbacks;
+    // event streams
+    GSList *event_streams;
 };
 
 
@@ -64,6 +66,14 @@ struct _gfalt_callback_entry {
 };
 
 
+// event streams
+gfalt_event_stream_t gfalt_event_stream_ref(gfalt_event_stream_t stream);
+
+gboolean gfalt_event_stream_wants_text(gfalt_event_stream_t stream);
+
+void gfalt_event_stream_push(gfalt_event_stream_t stream, const gfalt_event_record_t* record);
+
+
 int perform_local_copy(gfal2_context_t context, gfalt_params_t params,
     const char *src, const char *dst, GError **error);
 
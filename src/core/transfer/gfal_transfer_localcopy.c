@@ -19,8 +19,10 @@
  */
 
 #include <string.h>
+#include <pthread.h>
 
 #include <gfal_api.h>
+#include <common/gfal_plugin.h>
 #include <common/gfal_plugin_interface.h>
 #include <checksums/checksums.h>
 #include "gfal_transfer_plugins.h"
@@ -151,6 +153,265 @@ static void send_performance_data(gfalt_params_t params, const char* src, const
 }
 
 
+// Shared state of a copy split between several streams
+// Each stream claims the next block of the source, and copies it with pread/pwrite
+typedef struct {
+    gfal2_context_t context;
+    gfal_file_handle f_src, f_dst;
+    size_t alignment, buffersize;
+    off_t size;
+    time_t deadline;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    off_t next;
+    size_t done;
+    int running;
+    gboolean stop;
+    GError* error;
+} parallel_copy_t;
+
+
+// Parallel streams only make sense if both plugins do positional I/O natively,
+// otherwise the simulated pread/pwrite would serialize them anyway
+static gboolean supports_parallel_copy(gfal2_context_t context, gfal_file_handle f_src, gfal_file_handle f_dst)
+{
+    GError* tmp_err = NULL;
+    gfal_plugin_interface* src_plugin = gfal_plugin_map_file_handle(context, f_src, &tmp_err);
+    if (tmp_err == NULL && src_plugin->preadG != NULL) {
+        gfal_plugin_interface* dst_plugin = gfal_plugin_map_file_handle(context, f_dst, &tmp_err);
+        if (tmp_err == NULL && dst_plugin->pwriteG != NULL)
+            return TRUE;
+    }
+    g_clear_error(&tmp_err);
+    return FALSE;
+}
+
+
+// Returns the size of the source if it is worth to copy it with several streams, 0 otherwise
+static off_t get_parallel_copy_size(gfal2_context_t context, gfalt_params_t params, const char* src,
+        gfal_file_handle f_src, gfal_file_handle f_dst, size_t buffersize)
+{
+    if (gfalt_get_nbstreams(params, NULL) <= 1 || !supports_parallel_copy(context, f_src, f_dst))
+        return 0;
+
+    GError* tmp_err = NULL;
+    struct stat st;
+    if (gfal2_stat(context, src, &st, &tmp_err) != 0) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "Could not stat the source, use a single stream: %s", tmp_err->message);
+        g_error_free(tmp_err);
+        return 0;
+    }
+    if (!S_ISREG(st.st_mode) || st.st_size <= (off_t)buffersize)
+        return 0;
+    return st.st_size;
+}
+
+
+// Checked by the streams before each read and write, so they do not wait for the
+// controlling thread to notice a cancellation or an expired timeout
+static int parallel_copy_check(parallel_copy_t* copy, GError** error)
+{
+    pthread_mutex_lock(&copy->lock);
+    const gboolean stop = copy->stop;
+    pthread_mutex_unlock(&copy->lock);
+
+    if (stop || gfal2_is_canceled(copy->context)) {
+        g_set_error(error, local_copy_domain(), ECANCELED, "Transfer canceled");
+        return -1;
+    }
+    if (time(NULL) >= copy->deadline) {
+        g_set_error(error, local_copy_domain(), ETIMEDOUT, "Transfer canceled because the timeout expired");
+        return -1;
+    }
+    return 0;
+}
+
+
+// Stop the streams as soon as gfal2_cancel is called. The plugins abort the
+// pending reads and writes through their own cancel hooks
+static void parallel_copy_cancel(gfal2_context_t context, void* userdata)
+{
+    parallel_copy_t* copy = (parallel_copy_t*)userdata;
+    pthread_mutex_lock(&copy->lock);
+    if (!copy->stop) {
+        g_set_error(&copy->error, local_copy_domain(), ECANCELED, "Transfer canceled");
+        copy->stop = TRUE;
+    }
+    pthread_cond_signal(&copy->cond);
+    pthread_mutex_unlock(&copy->lock);
+}
+
+
+static int parallel_copy_block(parallel_copy_t* copy, char* buffer, off_t offset, size_t length, GError** error)
+{
+    size_t got = 0;
+    while (got < length) {
+        if (parallel_copy_check(copy, error) < 0)
+            return -1;
+        ssize_t ret = gfal_plugin_preadG(copy->context, copy->f_src, buffer + got, length - got, offset + got, error);
+        if (ret < 0)
+            return -1;
+        if (ret == 0) {
+            g_set_error(error, local_copy_domain(), EIO, "Unexpected end of file at %lld on the source",
+                (long long)(offset + got));
+            return -1;
+        }
+        got += ret;
+    }
+
+    size_t written = 0;
+    while (written < length) {
+        if (parallel_copy_check(copy, error) < 0)
+            return -1;
+        ssize_t ret = gfal_plugin_pwriteG(copy->context, copy->f_dst, buffer + written, length - written, offset + written, error);
+        if (ret < 0)
+            return -1;
+        if (ret == 0) {
+            g_set_error(error, local_copy_domain(), EIO, "Could not write at %lld on the destination",
+                (long long)(offset + written));
+            return -1;
+        }
+        written += ret;
+    }
+    return 0;
+}
+
+
+static void parallel_copy_worker(gpointer data, gpointer user_data)
+{
+    parallel_copy_t* copy = (parallel_copy_t*)user_data;
+    GError* tmp_err = NULL;
+    char* buffer = NULL;
+
+    errno = posix_memalign((void**)&buffer, copy->alignment, copy->buffersize);
+    if (errno) {
+        g_set_error(&tmp_err, local_copy_domain(), errno, "Failed to allocate aligned buffer");
+        buffer = NULL;
+    }
+
+    while (tmp_err == NULL) {
+        pthread_mutex_lock(&copy->lock);
+        if (copy->stop || copy->next >= copy->size) {
+            pthread_mutex_unlock(&copy->lock);
+            break;
+        }
+        const off_t offset = copy->next;
+        copy->next += copy->buffersize;
+        pthread_mutex_unlock(&copy->lock);
+
+        const size_t length = MIN((off_t)copy->buffersize, copy->size - offset);
+        if (parallel_copy_block(copy, buffer, offset, length, &tmp_err) == 0) {
+            pthread_mutex_lock(&copy->lock);
+            copy->done += length;
+            pthread_mutex_unlock(&copy->lock);
+        }
+    }
+    free(buffer);
+
+    pthread_mutex_lock(&copy->lock);
+    if (tmp_err) {
+        // Keep the first error, and let the other streams stop
+        if (copy->error == NULL)
+            copy->error = tmp_err;
+        else
+            g_error_free(tmp_err);
+        copy->stop = TRUE;
+    }
+    copy->running--;
+    pthread_cond_signal(&copy->cond);
+    pthread_mutex_unlock(&copy->lock);
+}
+
+
+// Copy size bytes with nbstreams concurrent pread/pwrite loops
+// Progress is reported by the calling thread, cancellation and timeout stop the streams between two reads or writes
+static ssize_t parallel_copy(gfal2_context_t context, gfalt_params_t params,
+        const char* src, const char* dst, gfal_file_handle f_src, gfal_file_handle f_dst,
+        off_t size, guint nbstreams, size_t alignment, size_t buffersize, GError** error)
+{
+    parallel_copy_t copy;
+    memset(&copy, 0, sizeof(copy));
+    copy.context = context;
+    copy.f_src = f_src;
+    copy.f_dst = f_dst;
+    copy.alignment = alignment;
+    copy.buffersize = buffersize;
+    copy.size = size;
+    copy.deadline = time(NULL) + gfalt_get_timeout(params, NULL);
+    pthread_mutex_init(&copy.lock, NULL);
+    pthread_cond_init(&copy.cond, NULL);
+
+    const guint nblocks = (size + buffersize - 1) / buffersize;
+    nbstreams = MIN(nbstreams, nblocks);
+
+    GThreadPool* pool = g_thread_pool_new(parallel_copy_worker, &copy, nbstreams, FALSE, error);
+    if (pool == NULL) {
+        pthread_cond_destroy(&copy.cond);
+        pthread_mutex_destroy(&copy.lock);
+        return -1;
+    }
+
+    gfal2_log(G_LOG_LEVEL_DEBUG, "  begin local transfer %s ->  %s with %u streams and buffer size %zd",
+        src, dst, nbstreams, buffersize);
+
+    gfal_cancel_token_t cancel_token = gfal2_register_cancel_callback(context, parallel_copy_cancel, &copy);
+
+    guint i;
+    copy.running = nbstreams;
+    for (i = 0; i < nbstreams; ++i) {
+        g_thread_pool_push(pool, GUINT_TO_POINTER(i + 1), NULL);
+    }
+
+    struct perf_data_t perf_data;
+    perf_data.start = perf_data.now = perf_data.last_update = time(NULL);
+    perf_data.done = perf_data.done_since_last_update = 0;
+
+    pthread_mutex_lock(&copy.lock);
+    while (copy.running > 0) {
+        struct timespec wakeup;
+        clock_gettime(CLOCK_REALTIME, &wakeup);
+        wakeup.tv_sec += 1;
+        pthread_cond_timedwait(&copy.cond, &copy.lock, &wakeup);
+
+        perf_data.now = time(NULL);
+        perf_data.done_since_last_update += copy.done - perf_data.done;
+        perf_data.done = copy.done;
+
+        if (copy.stop) {
+            continue;
+        }
+        else if (gfal2_is_canceled(context)) {
+            g_set_error(&copy.error, local_copy_domain(), ECANCELED, "Transfer canceled");
+            copy.stop = TRUE;
+        }
+        else if (perf_data.now >= copy.deadline) {
+            g_set_error(&copy.error, local_copy_domain(), ETIMEDOUT, "Transfer canceled because the timeout expired");
+            copy.stop = TRUE;
+        }
+        else if (perf_data.now - perf_data.last_update > 5) {
+            pthread_mutex_unlock(&copy.lock);
+            send_performance_data(params, src, dst, &perf_data);
+            pthread_mutex_lock(&copy.lock);
+            perf_data.done_since_last_update = 0;
+            perf_data.last_update = perf_data.now;
+        }
+    }
+    pthread_mutex_unlock(&copy.lock);
+
+    g_thread_pool_free(pool, FALSE, TRUE);
+    gfal2_remove_cancel_callback(context, cancel_token);
+    pthread_cond_destroy(&copy.cond);
+    pthread_mutex_destroy(&copy.lock);
+
+    if (copy.error) {
+        g_propagate_error(error, copy.error);
+        return -1;
+    }
+    return copy.done;
+}
+
+
 static int streamed_copy(gfal2_context_t context, gfalt_params_t params,
         const char* src, const char* dst, GError** error)
 {
@@ -220,33 +481,43 @@ static int streamed_copy(gfal2_context_t context, gfalt_params_t params,
     const time_t timeout = perf_data.start + gfalt_get_timeout(params, NULL);
     ssize_t s_file = 1;
 
-    gfal2_log(G_LOG_LEVEL_DEBUG, "  begin local transfer %s ->  %s with buffer size %zd", src, dst, buffersize);
+    // Large files are split between several streams, if the plugins allow it
+    const off_t parallel_size = get_parallel_copy_size(context, params, src, f_src, f_dst, buffersize);
+    if (parallel_size > 0) {
+        const ssize_t transferred = parallel_copy(context, params, src, dst, f_src, f_dst, parallel_size,
+            gfalt_get_nbstreams(params, NULL), alignment, buffersize, &nested_error);
+        if (transferred > 0)
+            perf_data.done = transferred;
+    }
+    else {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "  begin local transfer %s ->  %s with buffer size %zd", src, dst, buffersize);
 
-    while (s_file > 0 && !nested_error) {
-        s_file = gfal_plugin_readG(context, f_src, buffer, buffersize, &nested_error);
-        if (s_file > 0) {
-            gfal_plugin_writeG(context, f_dst, buffer, s_file, &nested_error);
-        }
+        while (s_file > 0 && !nested_error) {
+            s_file = gfal_plugin_readG(context, f_src, buffer, buffersize, &nested_error);
+            if (s_file > 0) {
+                gfal_plugin_writeG(context, f_dst, buffer, s_file, &nested_error);
+            }
 
-        perf_data.done += s_file;
-        perf_data.done_since_last_update += s_file;
+            perf_data.done += s_file;
+            perf_data.done_since_last_update += s_file;
 
-        // Make sure we don't have to cancel
-        if (gfal2_is_canceled(context)) {
-            if (nested_error == NULL)
-                g_set_error(&nested_error, local_copy_domain(), ECANCELED, "Transfer canceled");
-        }
-        // Timed-out?
-        else {
-            perf_data.now = time(NULL);
-            if (perf_data.now >= timeout) {
+            // Make sure we don't have to cancel
+            if (gfal2_is_canceled(context)) {
                 if (nested_error == NULL)
-                    g_set_error(&nested_error, local_copy_domain(), ETIMEDOUT, "Transfer canceled because the timeout expired");
+                    g_set_error(&nested_error, local_copy_domain(), ECANCELED, "Transfer canceled");
             }
-            else if (perf_data.now - perf_data.last_update > 5) {
-                send_performance_data(params, src, dst, &perf_data);
-                perf_data.done_since_last_update = 0;
-                perf_data.last_update = perf_data.now;
+            // Timed-out?
+            else {
+                perf_data.now = time(NULL);
+                if (perf_data.now >= timeout) {
+                    if (nested_error == NULL)
+                        g_set_error(&nested_error, local_copy_domain(), ETIMEDOUT, "Transfer canceled because the timeout expired");
+                }
+                else if (perf_data.now - perf_data.last_update > 5) {
+                    send_performance_data(params, src, dst, &perf_data);
+                    perf_data.done_since_last_update = 0;
+                    perf_data.last_update = perf_data.now;
+                }
             }
         }
     }
@@ -260,8 +531,9 @@ static int streamed_copy(gfal2_context_t context, gfalt_params_t params,
         return -1;
     }
     else {
-        plugin_trigger_event(params, local_copy_domain(), GFAL_EVENT_NONE,
-                GFAL_EVENT_TRANSFER_EXIT, "%s => %s", src, dst);
+        const gint64 transferred = perf_data.done;
+        plugin_trigger_event_values(params, local_copy_domain(), GFAL_EVENT_NONE,
+                GFAL_EVENT_TRANSFER_EXIT, &transferred, 1, "%s => %s", src, dst);
         return 0;
     }
 }
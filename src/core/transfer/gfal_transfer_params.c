@@ -44,6 +44,7 @@ static void gfalt_params_handle_init(gfalt_params_t p, GError ** err)
         .evict             = FALSE,
         .monitor_callbacks = NULL,
         .event_callbacks   = NULL,
+        .event_streams     = NULL,
     };
 }
 
@@ -63,6 +64,18 @@ static GSList* gfalt_params_copy_callbacks(const GSList* original)
 }
 
 
+static GSList* gfalt_params_copy_streams(const GSList* original)
+{
+    GSList* copy = NULL;
+    const GSList* p = original;
+    while (p) {
+        copy = g_slist_append(copy, gfalt_event_stream_ref((gfalt_event_stream_t)p->data));
+        p = g_slist_next(p);
+    }
+    return copy;
+}
+
+
 gfalt_params_t gfalt_params_handle_copy(gfalt_params_t params, GError ** err)
 {
     gfalt_params_t p = g_new0(struct _gfalt_params_t, 1);
@@ -77,6 +90,7 @@ gfalt_params_t gfalt_params_handle_copy(gfalt_params_t params, GError ** err)
 
     p->monitor_callbacks = gfalt_params_copy_callbacks(params->monitor_callbacks);
     p->event_callbacks = gfalt_params_copy_callbacks(params->event_callbacks);
+    p->event_streams = gfalt_params_copy_streams(params->event_streams);
 
     return p;
 }
@@ -100,6 +114,12 @@ static void gfalt_params_free_callback(gpointer data, gpointer user_data)
 }
 
 
+static void gfalt_params_free_stream(gpointer data, gpointer user_data)
+{
+    gfalt_event_stream_free((gfalt_event_stream_t)data);
+}
+
+
 void gfalt_params_handle_delete(gfalt_params_t params, GError ** err)
 {
     if (params) {
@@ -115,6 +135,8 @@ void gfalt_params_handle_delete(gfalt_params_t params, GError ** err)
         g_slist_free(params->monitor_callbacks);
         g_slist_foreach(params->event_callbacks, gfalt_params_free_callback , NULL);
         g_slist_free(params->event_callbacks);
+        g_slist_foreach(params->event_streams, gfalt_params_free_stream, NULL);
+        g_slist_free(params->event_streams);
 
         g_free(params);
     }
@@ -307,6 +329,33 @@ gint gfalt_remove_event_callback(gfalt_params_t params, gfalt_event_func callbac
 }
 
 
+gint gfalt_add_event_stream(gfalt_params_t params, gfalt_event_stream_t stream, GError** err)
+{
+    g_return_val_err_if_fail(params != NULL && stream != NULL, -1, err, "[BUG] invalid params handle or stream");
+
+    if (g_slist_find(params->event_streams, stream) == NULL) {
+        params->event_streams = g_slist_append(params->event_streams, gfalt_event_stream_ref(stream));
+    }
+    return 0;
+}
+
+
+gint gfalt_remove_event_stream(gfalt_params_t params, gfalt_event_stream_t stream, GError** err)
+{
+    g_return_val_err_if_fail(params != NULL, -1, err, "[BUG] invalid params handle");
+
+    GSList* i = g_slist_find(params->event_streams, stream);
+    if (i) {
+        params->event_streams = g_slist_delete_link(params->event_streams, i);
+        gfalt_event_stream_free(stream);
+        return 0;
+    }
+
+    gfal2_set_error(err, gfal2_get_core_quark(), ENOENT, __func__, "Could not find the event stream");
+    return -1;
+}
+
+
 guint gfalt_get_nbstreams(gfalt_params_t params, GError** err)
 {
     g_return_val_err_if_fail(params != NULL, -1, err, "[BUG] invalid parameter handle");
@@ -54,6 +54,16 @@ int plugin_trigger_event(gfalt_params_t params, GQuark domain,
                          gfal_event_side_t side, GQuark stage,
                          const char* fmt, ...);
 
+/**
+ * Same as plugin_trigger_event, but attaches a numeric payload to the event
+ * @param values   Array of n_values numeric values. Only the first GFALT_EVENT_MAX_VALUES are kept.
+ * @param n_values Number of values
+ */
+int plugin_trigger_event_values(gfalt_params_t params, GQuark domain,
+                                gfal_event_side_t side, GQuark stage,
+                                const gint64* values, guint n_values,
+                                const char* fmt, ...);
+
 /**
  * Convenience method for monitoring callbacks
  * @param params The transfer parameters.
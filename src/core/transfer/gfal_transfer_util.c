@@ -19,6 +19,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <glib.h>
 #include <time.h>
 
@@ -83,45 +84,92 @@ static void plugin_trigger_event_callback(gpointer data, gpointer user_data)
 }
 
 
+static void plugin_trigger_event_stream(gpointer data, gpointer user_data)
+{
+    gfalt_event_stream_push((gfalt_event_stream_t)data, (const gfalt_event_record_t*)user_data);
+}
+
+
+static gboolean plugin_event_needs_text(gfalt_params_t params)
+{
+    if (params->event_callbacks != NULL || G_LOG_LEVEL_MESSAGE <= gfal2_log_get_level())
+        return TRUE;
+
+    GSList* i;
+    for (i = params->event_streams; i != NULL; i = g_slist_next(i)) {
+        if (gfalt_event_stream_wants_text((gfalt_event_stream_t)i->data))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+
+static int plugin_trigger_event_va(gfalt_params_t params, GQuark domain, gfal_event_side_t side,
+        GQuark stage, const gint64* values, guint n_values, const char* fmt, va_list msg_args)
+{
+    // Nobody listening
+    if (params->event_callbacks == NULL && params->event_streams == NULL &&
+        G_LOG_LEVEL_MESSAGE > gfal2_log_get_level()) {
+        return 0;
+    }
+
+    gfalt_event_record_t record;
+    record.domain = domain;
+    record.side = side;
+    record.stage = stage;
+    record.timestamp = g_get_real_time() / 1000;
+    record.monotonic = g_get_monotonic_time();
+    record.n_values = MIN(n_values, GFALT_EVENT_MAX_VALUES);
+    if (record.n_values > 0)
+        memcpy(record.values, values, record.n_values * sizeof(gint64));
+    record.description[0] = '\0';
+
+    // Only format when someone is going to read it
+    if (fmt && plugin_event_needs_text(params)) {
+        vsnprintf(record.description, sizeof(record.description), fmt, msg_args);
+    }
+
+    if (params->event_callbacks) {
+        struct _gfalt_event event;
+        event.domain = record.domain;
+        event.side = record.side;
+        event.stage = record.stage;
+        event.timestamp = record.timestamp;
+        event.description = record.description;
+
+        g_slist_foreach(params->event_callbacks, plugin_trigger_event_callback, &event);
+    }
+
+    g_slist_foreach(params->event_streams, plugin_trigger_event_stream, &record);
+
+    if (G_LOG_LEVEL_MESSAGE <= gfal2_log_get_level()) {
+        char line[GFALT_EVENT_DESCRIPTION_SIZE + 128];
+        gfalt_event_record_to_string(&record, line, sizeof(line));
+        gfal2_log(G_LOG_LEVEL_MESSAGE, "Event triggered: %s", line);
+    }
+    return 0;
+}
+
+
 int plugin_trigger_event(gfalt_params_t params, GQuark domain, gfal_event_side_t side,
         GQuark stage, const char* fmt, ...)
 {
-    char buffer[512] = { 0 };
     va_list msg_args;
     va_start(msg_args, fmt);
-    if (fmt) {
-        vsnprintf(buffer, sizeof(buffer), fmt, msg_args);
-    }
+    int ret = plugin_trigger_event_va(params, domain, side, stage, NULL, 0, fmt, msg_args);
     va_end(msg_args);
+    return ret;
+}
 
-    struct _gfalt_event event;
-    GTimeVal tmst;
-
-    g_get_current_time(&tmst);
-
-    event.domain = domain;
-    event.side = side;
-    event.stage = stage;
-    event.timestamp = tmst.tv_sec * 1000 + tmst.tv_usec / 1000;
-    event.description = buffer;
-
-    g_slist_foreach(params->event_callbacks, plugin_trigger_event_callback, &event);
-
-    const char* side_str;
-    switch (side) {
-        case GFAL_EVENT_SOURCE:
-            side_str = "SOURCE";
-            break;
-        case GFAL_EVENT_DESTINATION:
-            side_str = "DESTINATION";
-            break;
-        default:
-            side_str = "BOTH";
-    }
 
-    gfal2_log(G_LOG_LEVEL_MESSAGE, "Event triggered: %s %s %s %s", side_str,
-            g_quark_to_string(domain), g_quark_to_string(stage), buffer);
-    return 0;
+int plugin_trigger_event_values(gfalt_params_t params, GQuark domain, gfal_event_side_t side,
+        GQuark stage, const gint64* values, guint n_values, const char* fmt, ...)
+{
+    va_list msg_args;
+    va_start(msg_args, fmt);
+    int ret = plugin_trigger_event_va(params, domain, side, stage, values, n_values, fmt, msg_args);
+    va_end(msg_args);
+    return ret;
 }
 
 
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#if defined __APPLE__
+#include <sys/xattr.h>
+#else
+#if defined __GLIBC_PREREQ && __GLIBC_PREREQ(2,27)
+#include <sys/xattr.h>
+#else
+#include <attr/xattr.h>
+#endif
+#endif
+
+#include "gfal_file_plugin.h"
+
+//
+// Parallel checksums for local files
+// adler32 and crc32 can be combined, so the file is split in chunks hashed
+// independently, and the partial results merged in order.
+//
+
+typedef struct {
+    int fd;
+    gboolean is_adler32;
+    size_t buffer_size;
+} gfal_file_checksum_job_t;
+
+
+typedef struct {
+    gfal_file_checksum_job_t* job;
+    off_t offset;
+    off_t length;
+    uLong value;
+    int errcode;
+} gfal_file_checksum_chunk_t;
+
+
+static void gfal_file_checksum_chunk(gpointer data, gpointer user_data)
+{
+    gfal_file_checksum_chunk_t* chunk = (gfal_file_checksum_chunk_t*)data;
+    gfal_file_checksum_job_t* job = chunk->job;
+    char* buffer = g_malloc(job->buffer_size);
+
+    uLong value = job->is_adler32 ? adler32(0L, Z_NULL, 0) : crc32(0L, Z_NULL, 0);
+    off_t offset = chunk->offset;
+    off_t remaining = chunk->length;
+
+    while (remaining > 0) {
+        ssize_t ret = pread(job->fd, buffer, MIN((off_t)job->buffer_size, remaining), offset);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            chunk->errcode = errno;
+            break;
+        }
+        if (ret == 0) {
+            // The file is shorter than expected
+            chunk->errcode = EIO;
+            break;
+        }
+        if (job->is_adler32)
+            value = adler32(value, (const Bytef*)buffer, (uInt)ret);
+        else
+            value = crc32(value, (const Bytef*)buffer, (uInt)ret);
+        offset += ret;
+        remaining -= ret;
+    }
+
+    chunk->value = value;
+    g_free(buffer);
+}
+
+
+int gfal_file_checksum_parallel(int fd, gboolean is_adler32, off_t offset, off_t length,
+    off_t chunk_size, int nthreads, uLong* result, GError** err)
+{
+    g_return_val_err_if_fail(fd >= 0 && chunk_size > 0 && result != NULL, -1, err,
+        "[gfal_file_checksum_parallel] invalid arguments");
+
+    gfal_file_checksum_job_t job;
+    job.fd = fd;
+    job.is_adler32 = is_adler32;
+    job.buffer_size = MIN(chunk_size, 2 << 20);
+
+    const guint nchunks = (guint)((length + chunk_size - 1) / chunk_size);
+    gfal_file_checksum_chunk_t* chunks = g_new0(gfal_file_checksum_chunk_t, MAX(nchunks, 1));
+    guint i;
+    for (i = 0; i < nchunks; ++i) {
+        chunks[i].job = &job;
+        chunks[i].offset = offset + (off_t)i * chunk_size;
+        chunks[i].length = MIN(chunk_size, length - (off_t)i * chunk_size);
+    }
+
+    GThreadPool* pool = NULL;
+    if (nthreads > 1 && nchunks > 1)
+        pool = g_thread_pool_new(gfal_file_checksum_chunk, NULL, MIN((guint)nthreads, nchunks), FALSE, NULL);
+
+    if (pool) {
+        for (i = 0; i < nchunks; ++i) {
+            g_thread_pool_push(pool, &chunks[i], NULL);
+        }
+        // Wait for all of them
+        g_thread_pool_free(pool, FALSE, TRUE);
+    }
+    else {
+        for (i = 0; i < nchunks; ++i) {
+            gfal_file_checksum_chunk(&chunks[i], NULL);
+        }
+    }
+
+    uLong value = is_adler32 ? adler32(0L, Z_NULL, 0) : crc32(0L, Z_NULL, 0);
+    int errcode = 0;
+    for (i = 0; i < nchunks && !errcode; ++i) {
+        errcode = chunks[i].errcode;
+        if (is_adler32)
+            value = adler32_combine(value, chunks[i].value, chunks[i].length);
+        else
+            value = crc32_combine(value, chunks[i].value, chunks[i].length);
+    }
+    g_free(chunks);
+
+    if (errcode) {
+        gfal2_set_error(err, gfal2_get_plugin_file_quark(), errcode, __func__,
+            "Error during checksum calculation, read: %s", strerror(errcode));
+        return -1;
+    }
+
+    *result = value;
+    return 0;
+}
+
+
+//
+// Checksum cache
+// The value is stored in an extended attribute, together with the state of
+// the file when it was computed: "mtime.nsec:size:inode:checksum"
+//
+
+#define GFAL_FILE_CHECKSUM_XATTR_PREFIX "user.gfal2.checksum."
+
+
+static void gfal_file_checksum_cache_key(const char* algorithm, char* key, size_t s_key)
+{
+    gchar* lower = g_ascii_strdown(algorithm, -1);
+    snprintf(key, s_key, GFAL_FILE_CHECKSUM_XATTR_PREFIX "%s", lower);
+    g_free(lower);
+}
+
+
+static void gfal_file_checksum_cache_stamp(const struct stat* st, char* stamp, size_t s_stamp)
+{
+#ifdef __APPLE__
+    const long nsec = st->st_mtimespec.tv_nsec;
+#else
+    const long nsec = st->st_mtim.tv_nsec;
+#endif
+    snprintf(stamp, s_stamp, "%lld.%09ld:%lld:%llu:", (long long)st->st_mtime, nsec,
+        (long long)st->st_size, (unsigned long long)st->st_ino);
+}
+
+
+int gfal_file_checksum_cache_get(const char* path, const char* algorithm, const struct stat* st,
+    char* checksum, size_t s_checksum)
+{
+    char key[128], stamp[128], value[1024];
+
+    gfal_file_checksum_cache_key(algorithm, key, sizeof(key));
+#ifdef __APPLE__
+    ssize_t len = getxattr(path, key, value, sizeof(value) - 1, 0, 0);
+#else
+    ssize_t len = getxattr(path, key, value, sizeof(value) - 1);
+#endif
+    if (len <= 0)
+        return -1;
+    value[len] = '\0';
+
+    gfal_file_checksum_cache_stamp(st, stamp, sizeof(stamp));
+    const size_t stamp_len = strlen(stamp);
+    if (strncmp(value, stamp, stamp_len) != 0 || value[stamp_len] == '\0') {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "Cached %s checksum of %s is stale", algorithm, path);
+        return -1;
+    }
+    if (g_strlcpy(checksum, value + stamp_len, s_checksum) >= s_checksum)
+        return -1;
+    return 0;
+}
+
+
+int gfal_file_checksum_cache_set(const char* path, const char* algorithm, const struct stat* st,
+    const char* checksum)
+{
+    char key[128], value[1024], stamp_now[128];
+    struct stat st_now;
+
+    // Do not cache if the file changed while being read
+    gfal_file_checksum_cache_stamp(st, value, sizeof(value));
+    if (stat(path, &st_now) < 0)
+        return -1;
+    gfal_file_checksum_cache_stamp(&st_now, stamp_now, sizeof(stamp_now));
+    if (strcmp(value, stamp_now) != 0) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "%s changed while computing its %s checksum, not caching", path, algorithm);
+        return -1;
+    }
+
+    gfal_file_checksum_cache_key(algorithm, key, sizeof(key));
+    g_strlcat(value, checksum, sizeof(value));
+
+#ifdef __APPLE__
+    int ret = setxattr(path, key, value, strlen(value), 0, 0);
+#else
+    int ret = setxattr(path, key, value, strlen(value), 0);
+#endif
+    if (ret < 0) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "Could not cache the %s checksum of %s: %s", algorithm, path,
+            strerror(errno));
+    }
+    return ret;
+}
@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#endif
+
+#include <checksums/checksums.h>
+#include "gfal_file_plugin.h"
+
+//
+// Local to local copies
+// The data is moved inside the kernel whenever the file systems allow it:
+// reflink first, then copy_file_range, then sendfile. The userspace
+// read/write loop is the last resort.
+//
+
+#define FILE_COPY_KERNEL_CHUNK (64 * 1024 * 1024)
+
+
+static const char* gfal_file_copy_method_str(gfal_file_copy_method_t method)
+{
+    switch (method) {
+        case FILE_COPY_CLONE:
+            return "reflink";
+        case FILE_COPY_RANGE:
+            return "copy_file_range";
+        case FILE_COPY_SENDFILE:
+            return "sendfile";
+        default:
+            return "read/write";
+    }
+}
+
+
+int gfal_plugin_file_check_url_transfer(plugin_handle plugin_data, gfal2_context_t context,
+    const char* src, const char* dst, gfal_url2_check check)
+{
+    if (check != GFAL_FILE_COPY || src == NULL || dst == NULL)
+        return FALSE;
+    if (!gfal2_get_opt_boolean_with_default(context, "CORE", "COPY_KERNEL_OFFLOAD", TRUE))
+        return FALSE;
+    // Direct IO is only honored by the streamed copy
+    if (gfal2_get_opt_boolean_with_default(context, "CORE", "COPY_DIRECT_IO", FALSE))
+        return FALSE;
+    return gfal_is_file(src) && gfal_is_file(dst);
+}
+
+
+// Errors that mean the method is not available for this pair of files,
+// and the next one should be tried
+static gboolean gfal_file_copy_can_fallback(int errcode)
+{
+    switch (errcode) {
+        case ENOSYS:
+        case EXDEV:
+        case EINVAL:
+        case EOPNOTSUPP:
+        case ENOTTY:
+        case EBADF:
+        case EPERM:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+
+static int gfal_file_clone(int fd_src, int fd_dst)
+{
+#ifdef FICLONE
+    return ioctl(fd_dst, FICLONE, fd_src);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+
+static ssize_t gfal_file_copy_range(int fd_src, int fd_dst, off_t offset, size_t len)
+{
+#if defined(__linux__) && defined(__NR_copy_file_range)
+    loff_t off_in = offset, off_out = offset;
+    return syscall(__NR_copy_file_range, fd_src, &off_in, fd_dst, &off_out, len, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+
+static ssize_t gfal_file_sendfile(int fd_src, int fd_dst, off_t offset, size_t len)
+{
+#ifdef __linux__
+    // sendfile writes at the current position of the destination
+    if (lseek(fd_dst, offset, SEEK_SET) < 0)
+        return -1;
+    off_t off_in = offset;
+    return sendfile(fd_dst, fd_src, &off_in, len);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+
+const gfal_file_copy_ops_t gfal_file_copy_kernel_ops = {
+    gfal_file_clone,
+    gfal_file_copy_range,
+    gfal_file_sendfile
+};
+
+
+// Copy up to len bytes at offset with the given method
+// Returns the number of bytes copied, 0 if nothing could be copied, -1 on error
+static ssize_t gfal_file_copy_chunk(const gfal_file_copy_ops_t* ops, gfal_file_copy_method_t method,
+    int fd_src, int fd_dst, off_t offset, size_t len, char* buffer, size_t s_buffer)
+{
+    ssize_t ret;
+
+    switch (method) {
+        case FILE_COPY_RANGE:
+            return ops->copy_range(fd_src, fd_dst, offset, len);
+        case FILE_COPY_SENDFILE:
+            return ops->sendfile(fd_src, fd_dst, offset, len);
+        case FILE_COPY_READ_WRITE: {
+            ret = pread(fd_src, buffer, MIN(len, s_buffer), offset);
+            if (ret > 0) {
+                ssize_t written = 0;
+                while (written < ret) {
+                    ssize_t w = pwrite(fd_dst, buffer + written, ret - written, offset + written);
+                    if (w < 0 && errno != EINTR)
+                        return -1;
+                    if (w > 0)
+                        written += w;
+                }
+            }
+            return ret;
+        }
+        default:
+            errno = ENOSYS;
+            return -1;
+    }
+}
+
+
+struct file_copy_perf_t {
+    time_t start, last_update, now;
+    off_t done;
+    off_t done_since_last_update;
+};
+
+
+static void gfal_file_copy_perf_marker(gfalt_params_t params, const char* src, const char* dst,
+    const struct file_copy_perf_t* perf)
+{
+    struct _gfalt_transfer_status status;
+
+    time_t total_time = perf->now - perf->start;
+    time_t inc_time = perf->now - perf->last_update;
+
+    memset(&status, 0, sizeof(status));
+    status.average_baudrate = (size_t)(perf->done / total_time);
+    status.bytes_transfered = (size_t)(perf->done);
+    status.instant_baudrate = (size_t)(perf->done_since_last_update / inc_time);
+    status.transfer_time    = total_time;
+
+    plugin_trigger_monitor(params, &status, src, dst);
+}
+
+
+ssize_t gfal_file_copy_fd(gfal2_context_t context, gfalt_params_t params, const char* src, const char* dst,
+    int fd_src, int fd_dst, off_t size, const gfal_file_copy_ops_t* ops, gfal_file_copy_method_t* method,
+    GError** err)
+{
+    if (ops == NULL)
+        ops = &gfal_file_copy_kernel_ops;
+
+    // Files with an unknown size (i.e. procfs) can only be read
+    *method = (size > 0) ? FILE_COPY_CLONE : FILE_COPY_READ_WRITE;
+
+    size_t buffersize = gfal2_get_opt_integer_with_default(context, "CORE", "COPY_BUFFERSIZE", 4194304);
+    char* buffer = NULL;
+
+    struct file_copy_perf_t perf;
+    perf.start = perf.now = perf.last_update = time(NULL);
+    perf.done = perf.done_since_last_update = 0;
+    const time_t timeout = perf.start + gfalt_get_timeout(params, NULL);
+
+    int errcode = 0;
+    const char* errmsg = NULL;
+
+    if (*method == FILE_COPY_CLONE) {
+        if (ops->clone(fd_src, fd_dst) == 0) {
+            perf.done = size;
+        }
+        else {
+            gfal2_log(G_LOG_LEVEL_DEBUG, "reflink not possible: %s", strerror(errno));
+            *method = FILE_COPY_RANGE;
+        }
+    }
+
+    while (*method != FILE_COPY_CLONE) {
+        if (*method != FILE_COPY_READ_WRITE && perf.done >= size)
+            break;
+
+        if (*method == FILE_COPY_READ_WRITE && buffer == NULL)
+            buffer = g_malloc(buffersize);
+
+        ssize_t ret = gfal_file_copy_chunk(ops, *method, fd_src, fd_dst, perf.done,
+            FILE_COPY_KERNEL_CHUNK, buffer, buffersize);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        // Nothing moved by an offloaded method, try the next one from the same offset
+        if (ret <= 0 && *method != FILE_COPY_READ_WRITE &&
+            (ret == 0 || gfal_file_copy_can_fallback(errno))) {
+            gfal2_log(G_LOG_LEVEL_DEBUG, "%s not possible at offset %lld (%s), falling back",
+                gfal_file_copy_method_str(*method), (long long)perf.done,
+                ret == 0 ? "no data copied" : strerror(errno));
+            ++*method;
+            continue;
+        }
+        if (ret < 0) {
+            errcode = errno;
+            errmsg = strerror(errno);
+            break;
+        }
+        if (ret == 0)
+            break;
+
+        perf.done += ret;
+        perf.done_since_last_update += ret;
+
+        if (gfal2_is_canceled(context)) {
+            errcode = ECANCELED;
+            errmsg = "Transfer canceled";
+            break;
+        }
+        perf.now = time(NULL);
+        if (perf.now >= timeout) {
+            errcode = ETIMEDOUT;
+            errmsg = "Transfer canceled because the timeout expired";
+            break;
+        }
+        if (perf.now - perf.last_update > 5) {
+            gfal_file_copy_perf_marker(params, src, dst, &perf);
+            perf.done_since_last_update = 0;
+            perf.last_update = perf.now;
+        }
+    }
+    g_free(buffer);
+
+    if (errcode) {
+        gfalt_set_error(err, gfal2_get_plugin_file_quark(), errcode, __func__,
+            GFALT_ERROR_TRANSFER, NULL, "%s failed: %s", gfal_file_copy_method_str(*method), errmsg);
+        return -1;
+    }
+    return perf.done;
+}
+
+
+static int gfal_file_copy_data(gfal2_context_t context, gfalt_params_t params,
+    const char* src, const char* dst, GError** err)
+{
+    int fd_src = open(src + FILE_PREFIX_LEN, O_RDONLY);
+    if (fd_src < 0) {
+        gfalt_set_error(err, gfal2_get_plugin_file_quark(), errno, __func__,
+            GFALT_ERROR_SOURCE, GFALT_ERROR_TRANSFER, "Could not open source: %s", strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd_src, &st) < 0) {
+        gfalt_set_error(err, gfal2_get_plugin_file_quark(), errno, __func__,
+            GFALT_ERROR_SOURCE, GFALT_ERROR_TRANSFER, "Could not stat source: %s", strerror(errno));
+        close(fd_src);
+        return -1;
+    }
+
+    int fd_dst = open(dst + FILE_PREFIX_LEN, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+    if (fd_dst < 0) {
+        gfalt_set_error(err, gfal2_get_plugin_file_quark(), errno, __func__,
+            GFALT_ERROR_DESTINATION, GFALT_ERROR_TRANSFER, "Could not open destination: %s", strerror(errno));
+        close(fd_src);
+        return -1;
+    }
+
+    gfal_file_copy_method_t method;
+    const off_t size = S_ISREG(st.st_mode) ? st.st_size : -1;
+    const ssize_t done = gfal_file_copy_fd(context, params, src, dst, fd_src, fd_dst, size, NULL, &method, err);
+
+    if (done >= 0 && close(fd_dst) < 0) {
+        gfalt_set_error(err, gfal2_get_plugin_file_quark(), errno, __func__,
+            GFALT_ERROR_TRANSFER, NULL, "%s failed: %s", gfal_file_copy_method_str(method), strerror(errno));
+        close(fd_src);
+        return -1;
+    }
+    else if (done < 0) {
+        close(fd_dst);
+    }
+    close(fd_src);
+
+    if (done < 0)
+        return -1;
+
+    const gint64 transferred = done;
+    plugin_trigger_event_values(params, gfal2_get_plugin_file_quark(), GFAL_EVENT_NONE,
+        GFAL_EVENT_TRANSFER_EXIT, &transferred, 1, "%s => %s (%s)", src, dst,
+        gfal_file_copy_method_str(method));
+    return 0;
+}
+
+
+static int gfal_file_copy_prepare_destination(gfal2_context_t context, gfalt_params_t params,
+    const char* dst, GError** err)
+{
+    GError* tmp_err = NULL;
+    struct stat st;
+
+    if (stat(dst + FILE_PREFIX_LEN, &st) == 0) {
+        if (!gfalt_get_replace_existing_file(params, NULL)) {
+            gfalt_set_error(err, gfal2_get_plugin_file_quark(), EEXIST, __func__,
+                GFALT_ERROR_DESTINATION, GFALT_ERROR_EXISTS, "The file exists and overwrite is not set");
+            return -1;
+        }
+        // Special files are written into
+        if (S_ISREG(st.st_mode) || S_ISLNK(st.st_mode)) {
+            if (unlink(dst + FILE_PREFIX_LEN) < 0 && errno != ENOENT) {
+                gfalt_set_error(err, gfal2_get_plugin_file_quark(), errno, __func__,
+                    GFALT_ERROR_DESTINATION, GFALT_ERROR_OVERWRITE, "Could not delete the destination: %s",
+                    strerror(errno));
+                return -1;
+            }
+            plugin_trigger_event(params, gfal2_get_plugin_file_quark(),
+                GFAL_EVENT_DESTINATION, GFAL_EVENT_OVERWRITE_DESTINATION, "Deleted %s", dst);
+        }
+    }
+    else if (gfalt_get_create_parent_dir(params, NULL)) {
+        char* parent = g_strdup(dst);
+        char* slash = strrchr(parent, '/');
+        if (slash && slash - parent > FILE_PREFIX_LEN) {
+            *slash = '\0';
+            gfal2_mkdir_rec(context, parent, 0755, &tmp_err);
+        }
+        g_free(parent);
+        if (tmp_err) {
+            gfalt_propagate_prefixed_error(err, tmp_err, __func__, GFALT_ERROR_DESTINATION, GFALT_ERROR_PARENT);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+int gfal_plugin_file_copy(plugin_handle plugin_data, gfal2_context_t context,
+    gfalt_params_t params, const char* src, const char* dst, GError** err)
+{
+    GError* tmp_err = NULL;
+    char checksum_type[1024] = {0};
+    char user_checksum[1024] = {0};
+    char source_checksum[1024] = {0};
+    gboolean is_strict_mode = gfalt_get_strict_copy_mode(params, NULL);
+    gfalt_checksum_mode_t checksum_mode = GFALT_CHECKSUM_NONE;
+
+    if (!is_strict_mode) {
+        checksum_mode = gfalt_get_checksum(params, checksum_type, sizeof(checksum_type),
+            user_checksum, sizeof(user_checksum), NULL);
+    }
+    if (checksum_type[0] == '\0') {
+        g_strlcpy(checksum_type, "ADLER32", sizeof(checksum_type));
+    }
+
+    // Source checksum
+    if (checksum_mode & GFALT_CHECKSUM_SOURCE) {
+        plugin_trigger_event(params, gfal2_get_plugin_file_quark(), GFAL_EVENT_SOURCE, GFAL_EVENT_CHECKSUM_ENTER, "");
+        gfal2_checksum(context, src, checksum_type, 0, 0, source_checksum, sizeof(source_checksum), &tmp_err);
+        if (tmp_err) {
+            gfalt_propagate_prefixed_error(err, tmp_err, __func__, GFALT_ERROR_SOURCE, GFALT_ERROR_CHECKSUM);
+            return -1;
+        }
+        plugin_trigger_event(params, gfal2_get_plugin_file_quark(), GFAL_EVENT_SOURCE, GFAL_EVENT_CHECKSUM_EXIT, "");
+
+        if (user_checksum[0] && gfal_compare_checksums(user_checksum, source_checksum, sizeof(source_checksum)) != 0) {
+            gfalt_set_error(err, gfal2_get_plugin_file_quark(), EIO, __func__,
+                GFALT_ERROR_SOURCE, GFALT_ERROR_CHECKSUM_MISMATCH,
+                "Source checksum and user-specified checksum do not match: %s != %s",
+                source_checksum, user_checksum);
+            return -1;
+        }
+    }
+
+    if (!is_strict_mode && gfal_file_copy_prepare_destination(context, params, dst, err) < 0)
+        return -1;
+
+    plugin_trigger_event(params, gfal2_get_plugin_file_quark(), GFAL_EVENT_NONE,
+        GFAL_EVENT_TRANSFER_ENTER, "%s => %s", src, dst);
+    plugin_trigger_event(params, gfal2_get_plugin_file_quark(), GFAL_EVENT_NONE,
+        GFAL_EVENT_TRANSFER_TYPE, "%s", GFAL_TRANSFER_TYPE_LOCAL);
+
+    if (gfal_file_copy_data(context, params, src, dst, err) < 0) {
+        if (gfalt_get_transfer_cleanup(params, NULL)) {
+            unlink(dst + FILE_PREFIX_LEN);
+        }
+        return -1;
+    }
+
+    // Destination checksum
+    if (checksum_mode & GFALT_CHECKSUM_TARGET) {
+        char destination_checksum[1024];
+        const char* compare_against = user_checksum[0] ? user_checksum : source_checksum;
+        const char* compare_side = user_checksum[0] ? "User defined" : "Source";
+
+        plugin_trigger_event(params, gfal2_get_plugin_file_quark(), GFAL_EVENT_DESTINATION, GFAL_EVENT_CHECKSUM_ENTER, "");
+        gfal2_checksum(context, dst, checksum_type, 0, 0, destination_checksum, sizeof(destination_checksum), &tmp_err);
+        if (tmp_err) {
+            gfalt_propagate_prefixed_error(err, tmp_err, __func__, GFALT_ERROR_DESTINATION, GFALT_ERROR_CHECKSUM);
+            return -1;
+        }
+        plugin_trigger_event(params, gfal2_get_plugin_file_quark(), GFAL_EVENT_DESTINATION, GFAL_EVENT_CHECKSUM_EXIT, "");
+
+        if (compare_against[0] &&
+            gfal_compare_checksums(compare_against, destination_checksum, sizeof(destination_checksum)) != 0) {
+            gfalt_set_error(err, gfal2_get_plugin_file_quark(), EIO, __func__,
+                GFALT_ERROR_DESTINATION, GFALT_ERROR_CHECKSUM_MISMATCH,
+                "%s checksum and destination checksum do not match: %s != %s",
+                compare_side, compare_against, destination_checksum);
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef GFAL_FILE_PLUGIN_H_
+#define GFAL_FILE_PLUGIN_H_
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <gfal_plugins_api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FILE_PREFIX_LEN 7 // file://
+
+GQuark gfal2_get_plugin_file_quark();
+
+void gfal_plugin_file_report_error(const char* funcname, GError** err);
+
+// Return 1 if url is a file url
+int gfal_is_file(const char *url);
+
+// Directory listing
+gfal_file_handle gfal_plugin_file_opendir(plugin_handle plugin_data, const char* path, GError** err);
+
+struct dirent* gfal_plugin_file_readdirpp(plugin_handle plugin_data, gfal_file_handle fh, struct stat* st, GError** err);
+
+int gfal_plugin_file_closedir(plugin_handle plugin_data, gfal_file_handle fh, GError** err);
+
+// Checksum of length bytes starting at offset, hashed in chunks of chunk_size
+// by up to nthreads workers. Only for combinable checksums (adler32 and crc32)
+int gfal_file_checksum_parallel(int fd, gboolean is_adler32, off_t offset, off_t length,
+    off_t chunk_size, int nthreads, unsigned long* result, GError** err);
+
+// Checksum cache in extended attributes, valid while the file state in st does not change
+// get returns 0 on a hit, -1 otherwise
+// set does nothing if the file does not match st anymore
+int gfal_file_checksum_cache_get(const char* path, const char* algorithm, const struct stat* st,
+    char* checksum, size_t s_checksum);
+
+int gfal_file_checksum_cache_set(const char* path, const char* algorithm, const struct stat* st,
+    const char* checksum);
+
+// Sequential reader that keeps depth reads of block_size bytes in flight
+// with io_uring, starting at the current offset of fd.
+// new returns NULL if io_uring is not available
+typedef struct gfal_file_reader gfal_file_reader_t;
+
+// Per handle readahead settings, the reader is created on the first read
+typedef struct {
+    gfal_file_reader_t* reader;
+    unsigned depth;
+    size_t block_size;
+} gfal_file_readahead_t;
+
+gfal_file_reader_t* gfal_file_reader_new(int fd, unsigned depth, size_t block_size);
+
+void gfal_file_reader_free(gfal_file_reader_t* reader);
+
+ssize_t gfal_file_reader_read(gfal_file_reader_t* reader, void* buff, size_t s_buff);
+
+int gfal_file_reader_seek(gfal_file_reader_t* reader, off_t offset);
+
+off_t gfal_file_reader_tell(gfal_file_reader_t* reader);
+
+// Third party copy
+int gfal_plugin_file_check_url_transfer(plugin_handle plugin_data, gfal2_context_t context,
+    const char* src, const char* dst, gfal_url2_check check);
+
+int gfal_plugin_file_copy(plugin_handle plugin_data, gfal2_context_t context,
+    gfalt_params_t params, const char* src, const char* dst, GError** err);
+
+// Ways of moving the data of a local copy, tried in this order
+typedef enum {
+    FILE_COPY_CLONE,
+    FILE_COPY_RANGE,
+    FILE_COPY_SENDFILE,
+    FILE_COPY_READ_WRITE
+} gfal_file_copy_method_t;
+
+// Kernel calls behind the offloaded methods, replaceable by the tests
+// clone returns 0 on success, the others the number of bytes copied at offset. -1 and errno on error
+typedef struct {
+    int (*clone)(int fd_src, int fd_dst);
+    ssize_t (*copy_range)(int fd_src, int fd_dst, off_t offset, size_t len);
+    ssize_t (*sendfile)(int fd_src, int fd_dst, off_t offset, size_t len);
+} gfal_file_copy_ops_t;
+
+extern const gfal_file_copy_ops_t gfal_file_copy_kernel_ops;
+
+// Copy fd_src, of the given size (-1 if unknown), into fd_dst, falling back to the next method
+// when one is not possible for this pair of files. ops is NULL for the kernel calls.
+// Returns the number of bytes copied, with the last method used, or -1 on error
+ssize_t gfal_file_copy_fd(gfal2_context_t context, gfalt_params_t params, const char* src, const char* dst,
+    int fd_src, int fd_dst, off_t size, const gfal_file_copy_ops_t* ops, gfal_file_copy_method_t* method,
+    GError** err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GFAL_FILE_PLUGIN_H_ */
@@ -39,22 +39,23 @@
 
 #include <gfal_plugins_api.h>
 #include <checksums/checksums.h>
+#include <checksums/checksum_kernels.h>
 #include <uri/gfal2_uri.h>
 #include <future/glib.h>
+#include "gfal_file_plugin.h"
 
 typedef struct _chksum_interface{
     // init checksum handle
-    void*  (*init)(void);
+    void*  (*init)(const gfal2_checksum_kernel_t* kernel);
     // compute checksum chunk
     ssize_t (*update)(void* chk_handler, const char* buffer, size_t s_size);
     // return checksum result : > 0 -> success, -1 : buffer to short
     int (*getResult)(void* chk_handler, char* buffer, size_t s_b);
+    // only for checksums implemented by a kernel
+    const gfal2_checksum_kernel_t* kernel;
 } Chksum_interface;
 
 
-static const int FILE_PREFIX_LEN = 7; // file://
-
-
 // File plugin GQuark
 GQuark gfal2_get_plugin_file_quark(){
     return g_quark_from_static_string(GFAL2_QUARK_PLUGINS "::FILE");
@@ -70,7 +71,7 @@ const char* gfal_file_plugin_getName(){
 /*
  * Return 1 if url is a file url
  */
-static int gfal_is_file(const char *url) {
+int gfal_is_file(const char *url) {
     GError *err = NULL;
     gfal2_uri *parsed = gfal2_parse_uri(url, &err);
     if (!parsed) {
@@ -262,16 +263,67 @@ struct dirent *gfal_plugin_file_readdir(plugin_handle plugin_data, gfal_file_han
     return res;
 }
 
+/*
+ * readdir, and stat the entry relative to the directory, so the path is not resolved again for each entry
+ * */
+struct dirent *gfal_plugin_file_readdirpp(plugin_handle plugin_data, gfal_file_handle fh, struct stat *st, GError **err)
+{
+    DIR *dir = gfal_file_handle_get_fdesc(fh);
+    errno = 0;
+    struct dirent *res = readdir(dir);
+    if (res == NULL) {
+        if (errno)
+            gfal_plugin_file_report_error(__func__, err);
+        return NULL;
+    }
+    if (fstatat(dirfd(dir), res->d_name, st, 0) < 0) {
+        gfal_plugin_file_report_error(__func__, err);
+        return NULL;
+    }
+    return res;
+}
+
 gfal_file_handle gfal_plugin_file_open(plugin_handle plugin_data, const char *path, int flag, mode_t mode, GError **err)
 {
+    gfal2_context_t context = (gfal2_context_t) plugin_data;
     errno = 0;
     const int ret = open(path + FILE_PREFIX_LEN, flag, mode);
     if (ret < 0) {
         gfal_plugin_file_report_error(__func__, err);
         return NULL;
-    } else {
-        return gfal_file_handle_new(gfal_file_plugin_getName(), GINT_TO_POINTER(ret));
     }
+
+    // Sequential reads are served from an asynchronous readahead window,
+    // set up on the first read, so handles only used for pread or fstat cost nothing
+    gfal_file_readahead_t* readahead = NULL;
+    if ((flag & O_ACCMODE) == O_RDONLY &&
+        gfal2_get_opt_boolean_with_default(context, "CORE", "FILE_IO_URING", FALSE)) {
+        const gint depth = gfal2_get_opt_integer_with_default(context, "CORE", "FILE_IO_URING_DEPTH", 4);
+        const gint block_size = gfal2_get_opt_integer_with_default(context, "CORE", "FILE_IO_URING_BLOCK_SIZE", 1048576);
+        struct stat st;
+        if (depth > 0 && block_size > 0 && fstat(ret, &st) == 0 && S_ISREG(st.st_mode)) {
+            readahead = g_new0(gfal_file_readahead_t, 1);
+            readahead->depth = depth;
+            readahead->block_size = block_size;
+        }
+    }
+    return gfal_file_handle_new2(gfal_file_plugin_getName(), GINT_TO_POINTER(ret), readahead, path);
+}
+
+
+static gfal_file_reader_t* gfal_plugin_file_get_reader(gfal_file_handle fh, gboolean start)
+{
+    gfal_file_readahead_t* readahead = gfal_file_handle_get_user_data(fh);
+    if (readahead == NULL)
+        return NULL;
+    if (readahead->reader == NULL && start && readahead->depth > 0) {
+        const int fd = GPOINTER_TO_INT(gfal_file_handle_get_fdesc(fh));
+        readahead->reader = gfal_file_reader_new(fd, readahead->depth, readahead->block_size);
+        // Do not try again if io_uring is not there
+        if (readahead->reader == NULL)
+            readahead->depth = 0;
+    }
+    return readahead->reader;
 }
 
 
@@ -282,7 +334,8 @@ ssize_t gfal_plugin_file_read(plugin_handle plugin_data, gfal_file_handle fh, vo
 {
     errno = 0;
     const int fd = GPOINTER_TO_INT(gfal_file_handle_get_fdesc(fh));
-    const int ret = read(fd, buff, s_buff);
+    gfal_file_reader_t* reader = gfal_plugin_file_get_reader(fh, TRUE);
+    const ssize_t ret = reader ? gfal_file_reader_read(reader, buff, s_buff) : read(fd, buff, s_buff);
     if (ret < 0)
         gfal_plugin_file_report_error(__func__, err);
     return ret;
@@ -305,10 +358,45 @@ ssize_t gfal_plugin_file_pread(plugin_handle plugin_data, gfal_file_handle fh, v
 off_t gfal_plugin_file_lseek(plugin_handle plugin_data, gfal_file_handle fh, off_t offset, int whence, GError **err)
 {
     errno = 0;
-    const int ret = lseek(GPOINTER_TO_INT(gfal_file_handle_get_fdesc(fh)), offset, whence);
-    if (ret < 0)
+    const int fd = GPOINTER_TO_INT(gfal_file_handle_get_fdesc(fh));
+    gfal_file_reader_t* reader = gfal_plugin_file_get_reader(fh, FALSE);
+    if (reader == NULL) {
+        const off_t ret = lseek(fd, offset, whence);
+        if (ret < 0)
+            gfal_plugin_file_report_error(__func__, err);
+        return ret;
+    }
+
+    // The file offset is not used by the reader, it keeps its own
+    struct stat st;
+    switch (whence) {
+        case SEEK_SET:
+            break;
+        case SEEK_CUR:
+            offset += gfal_file_reader_tell(reader);
+            break;
+        case SEEK_END:
+            if (fstat(fd, &st) < 0) {
+                gfal_plugin_file_report_error(__func__, err);
+                return -1;
+            }
+            offset += st.st_size;
+            break;
+        default:
+            errno = EINVAL;
+            gfal_plugin_file_report_error(__func__, err);
+            return -1;
+    }
+    if (offset < 0) {
+        errno = EINVAL;
         gfal_plugin_file_report_error(__func__, err);
-    return ret;
+        return -1;
+    }
+    if (gfal_file_reader_seek(reader, offset) < 0) {
+        gfal_plugin_file_report_error(__func__, err);
+        return -1;
+    }
+    return offset;
 }
 
 /*
@@ -344,6 +432,11 @@ int gfal_plugin_file_close(plugin_handle plugin_data, gfal_file_handle fh, GErro
     if (ret != 0) {
         gfal_plugin_file_report_error(__func__, err);
     } else {
+        gfal_file_readahead_t* readahead = gfal_file_handle_get_user_data(fh);
+        if (readahead) {
+            gfal_file_reader_free(readahead->reader);
+            g_free(readahead);
+        }
         gfal_file_handle_delete(fh);
     }
     return ret;
@@ -399,7 +492,7 @@ int gfal_plugin_file_symlink(plugin_handle plugin_data, const char *oldpath, con
 
 // checksum wrapper
 
-static void *adler_init()
+static void *adler_init(const gfal2_checksum_kernel_t* kernel)
 {
     unsigned long *lp = malloc(sizeof(unsigned long));
     *lp = adler32(0L, Z_NULL, 0);
@@ -421,7 +514,7 @@ static int adler32_getResult(void *chk_handler, char *resu, size_t s_b)
     return 0;
 }
 
-static void *crc32_init()
+static void *crc32_init(const gfal2_checksum_kernel_t* kernel)
 {
     unsigned long *lp = malloc(sizeof(unsigned long));
     *lp = crc32(0L, Z_NULL, 0);
@@ -444,30 +537,36 @@ static int crc32_getResult(void *chk_handler, char *resu, size_t s_b)
 }
 
 
-static void *md5_init()
+// Checksums from the kernel registry (md5, sha256, crc32c...)
+
+typedef struct {
+    const gfal2_checksum_kernel_t* kernel;
+    void* ctx;
+} kernel_handle_t;
+
+static void *kernel_init(const gfal2_checksum_kernel_t* kernel)
 {
-    GFAL_MD5_CTX *ctx = (GFAL_MD5_CTX *) malloc(sizeof(GFAL_MD5_CTX));
-    gfal2_md5_init(ctx);
-    return (void *) ctx;
+    kernel_handle_t *h = (kernel_handle_t *) malloc(sizeof(kernel_handle_t));
+    h->kernel = kernel;
+    h->ctx = malloc(kernel->ctx_size);
+    kernel->init(h->ctx);
+    return (void *) h;
 }
 
-static ssize_t md5_update(void *chk_handler, const char *buffer, size_t s)
+static ssize_t kernel_update(void *chk_handler, const char *buffer, size_t s)
 {
-    GFAL_MD5_CTX *ctx = (GFAL_MD5_CTX *) chk_handler;
-    gfal2_md5_update(ctx, buffer, (unsigned long) s);
+    kernel_handle_t *h = (kernel_handle_t *) chk_handler;
+    h->kernel->update(h->ctx, buffer, s);
     return (ssize_t) s;
 }
 
-static int md5_getResult(void *chk_handler, char *resu, size_t s_b)
+static int kernel_getResult(void *chk_handler, char *resu, size_t s_b)
 {
-    GFAL_MD5_CTX *ctx = (GFAL_MD5_CTX *) chk_handler;
-    unsigned char buffer[16];
-    if (s_b < 33) // buffer to short
-        return -1;
-    gfal2_md5_final(buffer, ctx);
-    gfal2_md5_to_hex_string(buffer, resu, sizeof(buffer));
-    free(ctx);
-    return 0;
+    kernel_handle_t *h = (kernel_handle_t *) chk_handler;
+    int ret = h->kernel->final(h->ctx, resu, s_b);
+    free(h->ctx);
+    free(h);
+    return ret;
 }
 
 
@@ -497,7 +596,7 @@ static int gfal_plugin_file_chk_compute(plugin_handle data, const char *url, con
         return -1;
     }
 
-    void *c_handle = i_chk->init();
+    void *c_handle = i_chk->init(i_chk->kernel);
     char *buffer = malloc(chunk_size);
     do {
         ret = gfal2_read(handle, fd, buffer, MIN(chunk_size, remain_bytes),  &tmp_err);
@@ -527,11 +626,64 @@ static int gfal_plugin_file_chk_compute(plugin_handle data, const char *url, con
 }
 
 
-int gfal_plugin_filechecksum_calc(plugin_handle data, const char *url, const char *check_type,
+// adler32 and crc32 of large files are computed by several threads
+// Returns 1 if the file is too small for it to be worth it
+static int gfal_plugin_file_chk_compute_parallel(plugin_handle data, const char *url, gboolean is_adler32,
+    char *checksum_buffer, size_t buffer_length,
+    off_t start_offset, size_t data_length,
+    GError **err)
+{
+    gfal2_context_t handle = (gfal2_context_t) data;
+    const gint nthreads = gfal2_get_opt_integer_with_default(handle, "CORE", "CHECKSUM_THREADS", 4);
+    const gint64 chunk_size = gfal2_get_opt_integer_with_default(handle, "CORE", "CHECKSUM_CHUNK_SIZE", 67108864);
+    if (nthreads <= 1 || chunk_size <= 0)
+        return 1;
+
+    int fd = open(url + FILE_PREFIX_LEN, O_RDONLY);
+    if (fd < 0)
+        return 1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= start_offset) {
+        close(fd);
+        return 1;
+    }
+
+    off_t length = st.st_size - start_offset;
+    if (data_length > 0 && (off_t)data_length < length)
+        length = data_length;
+    if (length < 2 * chunk_size) {
+        close(fd);
+        return 1;
+    }
+
+    unsigned long value = 0;
+    int ret = gfal_file_checksum_parallel(fd, is_adler32, start_offset, length, chunk_size, nthreads, &value, err);
+    close(fd);
+    if (ret < 0)
+        return -1;
+
+    if (is_adler32)
+        snprintf(checksum_buffer, buffer_length, "%08lx", value);
+    else
+        snprintf(checksum_buffer, buffer_length, "%ld", value);
+    return 0;
+}
+
+
+static int gfal_plugin_file_checksum_compute(plugin_handle data, const char *url, const char *check_type,
     char *checksum_buffer, size_t buffer_length,
     off_t start_offset, size_t data_length,
     GError **err)
 {
+    const gboolean is_adler32 = (strcasecmp(check_type, "adler32") == 0);
+    if (is_adler32 || strcasecmp(check_type, "crc32") == 0) {
+        int ret = gfal_plugin_file_chk_compute_parallel(data, url, is_adler32, checksum_buffer,
+            buffer_length, start_offset, data_length, err);
+        if (ret <= 0)
+            return ret;
+    }
+
     if (strcasecmp(check_type, "adler32") == 0) {
         Chksum_interface ie = {.init = &adler_init,
             .update = &adler32_update,
@@ -549,10 +701,15 @@ int gfal_plugin_filechecksum_calc(plugin_handle data, const char *url, const cha
             buffer_length, start_offset, data_length,
             &ie,
             err);
-    } else if (strcasecmp(check_type, "md5") == 0) {
-        Chksum_interface ie = {.init = &md5_init,
-            .update = &md5_update,
-            .getResult = &md5_getResult};
+    }
+
+    const gfal2_checksum_kernel_t *kernel = gfal2_checksum_kernel_find(check_type);
+    if (kernel) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "Using the %s implementation of %s", kernel->implementation, kernel->name);
+        Chksum_interface ie = {.init = &kernel_init,
+            .update = &kernel_update,
+            .getResult = &kernel_getResult,
+            .kernel = kernel};
         return gfal_plugin_file_chk_compute(data, url, check_type, checksum_buffer,
             buffer_length, start_offset, data_length,
             &ie,
@@ -564,6 +721,38 @@ int gfal_plugin_filechecksum_calc(plugin_handle data, const char *url, const cha
 }
 
 
+// Full file checksums may be cached in an extended attribute
+int gfal_plugin_filechecksum_calc(plugin_handle data, const char *url, const char *check_type,
+    char *checksum_buffer, size_t buffer_length,
+    off_t start_offset, size_t data_length,
+    GError **err)
+{
+    gfal2_context_t handle = (gfal2_context_t) data;
+    const char *path = url + FILE_PREFIX_LEN;
+    struct stat st;
+
+    if (start_offset != 0 || data_length != 0 ||
+        !gfal2_get_opt_boolean_with_default(handle, "CORE", "CHECKSUM_XATTR_CACHE", FALSE) ||
+        stat(path, &st) < 0 || !S_ISREG(st.st_mode)) {
+        return gfal_plugin_file_checksum_compute(data, url, check_type, checksum_buffer, buffer_length,
+            start_offset, data_length, err);
+    }
+
+    if (gfal_file_checksum_cache_get(path, check_type, &st, checksum_buffer, buffer_length) == 0) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "Using the cached %s checksum of %s", check_type, url);
+        return 0;
+    }
+
+    int ret = gfal_plugin_file_checksum_compute(data, url, check_type, checksum_buffer, buffer_length,
+        start_offset, data_length, err);
+
+    if (ret == 0) {
+        gfal_file_checksum_cache_set(path, check_type, &st, checksum_buffer);
+    }
+    return ret;
+}
+
+
 /*
  * Init function, called before all
  * */
@@ -585,6 +774,7 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError **err)
     file_plugin.rmdirG = &gfal_plugin_file_rmdir;
     file_plugin.opendirG = &gfal_plugin_file_opendir;
     file_plugin.readdirG = &gfal_plugin_file_readdir;
+    file_plugin.readdirppG = &gfal_plugin_file_readdirpp;
     file_plugin.closedirG = &gfal_plugin_file_closedir;
     file_plugin.readlinkG = &gfal_plugin_file_readlink;
 
@@ -603,5 +793,8 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError **err)
     file_plugin.setxattrG = &gfal_plugin_file_setxattr;
     file_plugin.checksum_calcG = &gfal_plugin_filechecksum_calc;
 
+    file_plugin.check_plugin_url_transfer = &gfal_plugin_file_check_url_transfer;
+    file_plugin.copy_file = &gfal_plugin_file_copy;
+
     return file_plugin;
 }
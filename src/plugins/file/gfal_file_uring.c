@@ -0,0 +1,526 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "gfal_file_plugin.h"
+
+//
+// Sequential reader with readahead over io_uring
+// A fixed set of aligned buffers is kept in flight ahead of the read
+// position, and consumed in offset order. The ring is driven with the raw
+// system calls, so there is no dependency on liburing.
+//
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define GFAL_FILE_HAVE_URING 1
+#endif
+#endif
+#endif
+
+#ifdef GFAL_FILE_HAVE_URING
+
+#define GFAL_FILE_URING_ALIGNMENT 4096
+
+typedef enum {
+    SLOT_IDLE,
+    SLOT_INFLIGHT,
+    SLOT_DONE,      // completed, result not accounted yet
+    SLOT_READY      // filled bytes can be consumed
+} gfal_file_slot_state_t;
+
+
+typedef struct {
+    char* buffer;
+    off_t offset;
+    size_t filled;
+    ssize_t result;
+    gfal_file_slot_state_t state;
+    struct iovec iov;
+} gfal_file_slot_t;
+
+
+struct gfal_file_reader {
+    int fd;
+    int ring_fd;
+    gboolean fixed_buffers;
+
+    // submission ring
+    void* sq_ptr;
+    size_t sq_len;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    struct io_uring_sqe* sqes;
+    size_t sqes_len;
+
+    // completion ring
+    void* cq_ptr;
+    size_t cq_len;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe* cqes;
+
+    // readahead window
+    unsigned depth;
+    size_t block_size;
+    gfal_file_slot_t* slots;
+    unsigned head;           // slot holding the read position
+    off_t position;          // next byte to return
+    off_t next_submit;       // offset of the next block to request
+    off_t size;              // size when opened or last checked, -1 if unknown
+    off_t eof;               // size, or where a read returned 0 bytes
+    unsigned inflight;
+};
+
+
+static int gfal_file_uring_setup(unsigned entries, struct io_uring_params* params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+
+static int gfal_file_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+
+static int gfal_file_uring_register(int ring_fd, unsigned opcode, void* arg, unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+
+static int gfal_file_reader_map_rings(gfal_file_reader_t* reader, struct io_uring_params* params)
+{
+    reader->sq_len = params->sq_off.array + params->sq_entries * sizeof(unsigned);
+    reader->cq_len = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+    if (params->features & IORING_FEAT_SINGLE_MMAP) {
+        if (reader->cq_len > reader->sq_len)
+            reader->sq_len = reader->cq_len;
+        reader->cq_len = reader->sq_len;
+    }
+
+    reader->sq_ptr = mmap(NULL, reader->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        reader->ring_fd, IORING_OFF_SQ_RING);
+    if (reader->sq_ptr == MAP_FAILED) {
+        reader->sq_ptr = NULL;
+        return -1;
+    }
+
+    if (params->features & IORING_FEAT_SINGLE_MMAP) {
+        reader->cq_ptr = reader->sq_ptr;
+    }
+    else {
+        reader->cq_ptr = mmap(NULL, reader->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            reader->ring_fd, IORING_OFF_CQ_RING);
+        if (reader->cq_ptr == MAP_FAILED) {
+            reader->cq_ptr = NULL;
+            return -1;
+        }
+    }
+
+    reader->sqes_len = params->sq_entries * sizeof(struct io_uring_sqe);
+    reader->sqes = mmap(NULL, reader->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        reader->ring_fd, IORING_OFF_SQES);
+    if (reader->sqes == MAP_FAILED) {
+        reader->sqes = NULL;
+        return -1;
+    }
+
+    char* sq = (char*)reader->sq_ptr;
+    reader->sq_head = (unsigned*)(sq + params->sq_off.head);
+    reader->sq_tail = (unsigned*)(sq + params->sq_off.tail);
+    reader->sq_mask = (unsigned*)(sq + params->sq_off.ring_mask);
+    reader->sq_array = (unsigned*)(sq + params->sq_off.array);
+
+    char* cq = (char*)reader->cq_ptr;
+    reader->cq_head = (unsigned*)(cq + params->cq_off.head);
+    reader->cq_tail = (unsigned*)(cq + params->cq_off.tail);
+    reader->cq_mask = (unsigned*)(cq + params->cq_off.ring_mask);
+    reader->cqes = (struct io_uring_cqe*)(cq + params->cq_off.cqes);
+    return 0;
+}
+
+
+// Queue the read of what is missing from the slot, without submitting it
+static void gfal_file_reader_prepare(gfal_file_reader_t* reader, unsigned index)
+{
+    gfal_file_slot_t* slot = &reader->slots[index];
+    const unsigned tail = *reader->sq_tail;
+    const unsigned sq_index = tail & *reader->sq_mask;
+    struct io_uring_sqe* sqe = &reader->sqes[sq_index];
+
+    slot->result = 0;
+    slot->state = SLOT_INFLIGHT;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = reader->fd;
+    sqe->off = slot->offset + slot->filled;
+    sqe->user_data = index;
+    if (reader->fixed_buffers) {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->addr = (unsigned long)(slot->buffer + slot->filled);
+        sqe->len = reader->block_size - slot->filled;
+        sqe->buf_index = index;
+    }
+    else {
+        slot->iov.iov_base = slot->buffer + slot->filled;
+        slot->iov.iov_len = reader->block_size - slot->filled;
+        sqe->opcode = IORING_OP_READV;
+        sqe->addr = (unsigned long)&slot->iov;
+        sqe->len = 1;
+    }
+
+    reader->sq_array[sq_index] = sq_index;
+    __atomic_store_n(reader->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    reader->inflight++;
+}
+
+
+// Queue the read of the next block into the slot
+static void gfal_file_reader_queue(gfal_file_reader_t* reader, unsigned index)
+{
+    gfal_file_slot_t* slot = &reader->slots[index];
+    slot->offset = reader->next_submit;
+    slot->filled = 0;
+    reader->next_submit += reader->block_size;
+    gfal_file_reader_prepare(reader, index);
+}
+
+
+// Submit the queued requests, and wait for at least min_complete
+static int gfal_file_reader_submit(gfal_file_reader_t* reader, unsigned min_complete)
+{
+    unsigned to_submit = *reader->sq_tail - __atomic_load_n(reader->sq_head, __ATOMIC_ACQUIRE);
+    int ret;
+    do {
+        ret = gfal_file_uring_enter(reader->ring_fd, to_submit, min_complete,
+            min_complete ? IORING_ENTER_GETEVENTS : 0);
+    } while (ret < 0 && errno == EINTR);
+    return ret < 0 ? -1 : 0;
+}
+
+
+static void gfal_file_reader_reap(gfal_file_reader_t* reader)
+{
+    unsigned head = *reader->cq_head;
+    const unsigned tail = __atomic_load_n(reader->cq_tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        struct io_uring_cqe* cqe = &reader->cqes[head & *reader->cq_mask];
+        gfal_file_slot_t* slot = &reader->slots[cqe->user_data];
+        slot->result = cqe->res;
+        slot->state = SLOT_DONE;
+        reader->inflight--;
+        ++head;
+    }
+    __atomic_store_n(reader->cq_head, head, __ATOMIC_RELEASE);
+}
+
+
+// Refill all the idle slots, in order, starting at the head
+static int gfal_file_reader_fill(gfal_file_reader_t* reader)
+{
+    unsigned i, queued = 0;
+    for (i = 0; i < reader->depth; ++i) {
+        unsigned index = (reader->head + i) % reader->depth;
+        if (reader->slots[index].state != SLOT_IDLE)
+            continue;
+        if (reader->eof >= 0 && reader->next_submit >= reader->eof)
+            break;
+        gfal_file_reader_queue(reader, index);
+        ++queued;
+    }
+    if (queued)
+        return gfal_file_reader_submit(reader, 0);
+    return 0;
+}
+
+
+// Wait for everything in flight, and forget the buffered data
+static int gfal_file_reader_drain(gfal_file_reader_t* reader)
+{
+    while (reader->inflight > 0) {
+        if (gfal_file_reader_submit(reader, 1) < 0)
+            return -1;
+        gfal_file_reader_reap(reader);
+    }
+    unsigned i;
+    for (i = 0; i < reader->depth; ++i) {
+        reader->slots[i].state = SLOT_IDLE;
+    }
+    return 0;
+}
+
+
+void gfal_file_reader_free(gfal_file_reader_t* reader)
+{
+    if (reader == NULL)
+        return;
+
+    if (reader->ring_fd >= 0) {
+        gfal_file_reader_drain(reader);
+        close(reader->ring_fd);
+    }
+    if (reader->sqes)
+        munmap(reader->sqes, reader->sqes_len);
+    if (reader->cq_ptr && reader->cq_ptr != reader->sq_ptr)
+        munmap(reader->cq_ptr, reader->cq_len);
+    if (reader->sq_ptr)
+        munmap(reader->sq_ptr, reader->sq_len);
+
+    if (reader->slots) {
+        unsigned i;
+        for (i = 0; i < reader->depth; ++i) {
+            free(reader->slots[i].buffer);
+        }
+        g_free(reader->slots);
+    }
+    g_free(reader);
+}
+
+
+gfal_file_reader_t* gfal_file_reader_new(int fd, unsigned depth, size_t block_size)
+{
+    if (depth == 0 || block_size == 0)
+        return NULL;
+    gfal_file_reader_t* reader = g_new0(gfal_file_reader_t, 1);
+    reader->fd = fd;
+    reader->depth = depth;
+    reader->block_size = block_size;
+
+    // Reads start at the current file offset, and stop at the current size,
+    // which is checked again once reached, in case the file grew.
+    // A read returning 0 bytes before that means the file shrank.
+    struct stat st;
+    reader->size = (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) ? st.st_size : -1;
+    reader->eof = reader->size;
+    reader->position = lseek(fd, 0, SEEK_CUR);
+    if (reader->position < 0)
+        reader->position = 0;
+    reader->next_submit = reader->position;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    reader->ring_fd = gfal_file_uring_setup(depth, &params);
+    if (reader->ring_fd < 0) {
+        // i.e. old kernel, or forbidden by seccomp
+        gfal2_log(G_LOG_LEVEL_DEBUG, "io_uring not available: %s", strerror(errno));
+        gfal_file_reader_free(reader);
+        return NULL;
+    }
+    if (gfal_file_reader_map_rings(reader, &params) < 0) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "Could not map the io_uring rings: %s", strerror(errno));
+        gfal_file_reader_free(reader);
+        return NULL;
+    }
+
+    reader->slots = g_new0(gfal_file_slot_t, depth);
+    struct iovec* iovecs = g_new0(struct iovec, depth);
+    unsigned i;
+    for (i = 0; i < depth; ++i) {
+        if (posix_memalign((void**)&reader->slots[i].buffer, GFAL_FILE_URING_ALIGNMENT, block_size) != 0) {
+            g_free(iovecs);
+            gfal_file_reader_free(reader);
+            return NULL;
+        }
+        reader->slots[i].iov.iov_base = reader->slots[i].buffer;
+        reader->slots[i].iov.iov_len = block_size;
+        iovecs[i] = reader->slots[i].iov;
+    }
+
+    // Registered buffers save the page pinning on each request, but count
+    // against RLIMIT_MEMLOCK, so they are optional
+    reader->fixed_buffers = (gfal_file_uring_register(reader->ring_fd, IORING_REGISTER_BUFFERS, iovecs, depth) == 0);
+    g_free(iovecs);
+
+    if (gfal_file_reader_fill(reader) < 0) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "io_uring submission failed: %s", strerror(errno));
+        gfal_file_reader_free(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+
+// Forget the readahead window, and start a new one at offset
+static int gfal_file_reader_restart(gfal_file_reader_t* reader, off_t offset)
+{
+    if (gfal_file_reader_drain(reader) < 0)
+        return -1;
+    reader->position = offset;
+    reader->next_submit = offset;
+    reader->eof = reader->size;
+    reader->head = 0;
+    return gfal_file_reader_fill(reader);
+}
+
+
+int gfal_file_reader_seek(gfal_file_reader_t* reader, off_t offset)
+{
+    if (offset == reader->position)
+        return 0;
+    return gfal_file_reader_restart(reader, offset);
+}
+
+
+// Check if data was appended past the read position since the size was taken
+static gboolean gfal_file_reader_grown(gfal_file_reader_t* reader)
+{
+    struct stat st;
+    if (reader->size < 0 || fstat(reader->fd, &st) != 0 || st.st_size <= reader->position)
+        return FALSE;
+    reader->size = st.st_size;
+    return TRUE;
+}
+
+
+ssize_t gfal_file_reader_read(gfal_file_reader_t* reader, void* buff, size_t s_buff)
+{
+    size_t done = 0;
+    gboolean restated = FALSE;
+
+    while (done < s_buff) {
+        gfal_file_slot_t* slot = &reader->slots[reader->head];
+
+        // Nothing left to request, or the slots hold data past the end
+        if (slot->state == SLOT_IDLE || (reader->eof >= 0 && reader->position >= reader->eof)) {
+            // At the end, look once per call for appended data, as read(2) would return it
+            if (!restated && reader->eof >= 0 && reader->position >= reader->eof) {
+                restated = TRUE;
+                if (gfal_file_reader_grown(reader)) {
+                    if (gfal_file_reader_restart(reader, reader->position) < 0)
+                        return done ? (ssize_t)done : -1;
+                    continue;
+                }
+            }
+            break;
+        }
+        while (slot->state == SLOT_INFLIGHT) {
+            if (gfal_file_reader_submit(reader, 1) < 0)
+                return done ? (ssize_t)done : -1;
+            gfal_file_reader_reap(reader);
+        }
+
+        if (slot->state == SLOT_DONE) {
+            if (slot->result == -EINTR || slot->result == -EAGAIN) {
+                gfal_file_reader_prepare(reader, reader->head);
+                if (gfal_file_reader_submit(reader, 0) < 0)
+                    return done ? (ssize_t)done : -1;
+                continue;
+            }
+            if (slot->result < 0) {
+                // Retry from this position on the next call
+                const int errcode = -slot->result;
+                gfal_file_reader_restart(reader, reader->position);
+                if (done)
+                    return done;
+                errno = errcode;
+                return -1;
+            }
+
+            slot->filled += slot->result;
+            const off_t filled_end = slot->offset + slot->filled;
+            if (slot->result == 0) {
+                if (reader->eof < 0 || filled_end < reader->eof)
+                    reader->eof = filled_end;
+            }
+            else if (slot->filled < reader->block_size && (reader->eof < 0 || filled_end < reader->eof)) {
+                // Short reads are legal (network filesystems, signals...), ask for the rest
+                gfal_file_reader_prepare(reader, reader->head);
+                if (gfal_file_reader_submit(reader, 0) < 0)
+                    return done ? (ssize_t)done : -1;
+                continue;
+            }
+            slot->state = SLOT_READY;
+        }
+
+        const off_t slot_end = slot->offset + slot->filled;
+
+        if (reader->position < slot_end) {
+            const size_t available = slot_end - reader->position;
+            const size_t n = MIN(available, s_buff - done);
+            memcpy((char*)buff + done, slot->buffer + (reader->position - slot->offset), n);
+            done += n;
+            reader->position += n;
+        }
+
+        // Slot consumed, reuse it for the next block
+        if (reader->position >= slot_end) {
+            slot->state = SLOT_IDLE;
+            reader->head = (reader->head + 1) % reader->depth;
+            if (gfal_file_reader_fill(reader) < 0)
+                return done ? (ssize_t)done : -1;
+        }
+    }
+
+    return done;
+}
+
+
+off_t gfal_file_reader_tell(gfal_file_reader_t* reader)
+{
+    return reader->position;
+}
+
+#else
+
+gfal_file_reader_t* gfal_file_reader_new(int fd, unsigned depth, size_t block_size)
+{
+    return NULL;
+}
+
+
+void gfal_file_reader_free(gfal_file_reader_t* reader)
+{
+}
+
+
+int gfal_file_reader_seek(gfal_file_reader_t* reader, off_t offset)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+
+ssize_t gfal_file_reader_read(gfal_file_reader_t* reader, void* buff, size_t s_buff)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+
+off_t gfal_file_reader_tell(gfal_file_reader_t* reader)
+{
+    return -1;
+}
+
+#endif
@@ -18,6 +18,7 @@
  * limitations under the License.
  */
 
+#include <errno.h>
 #include <string>
 #include <sstream>
 
@@ -37,6 +38,69 @@ static const GQuark GFAL_GRIDFTP_SCOPE_CLOSE = g_quark_from_static_string("GridF
 
 const size_t readdir_len = 65000;
 
+// Time given to a fully read partial transfer to deliver its end of file before aborting it
+static const time_t READAHEAD_EOF_GRACE = 1;
+
+// Partial transfer kept open between preads, reading ahead of them
+// while they are sequential
+struct GridFTPReadahead {
+    GridFTPSessionHandler* handler;
+    GridFTPRequestState* request;
+    GridFTPStreamState* stream;
+    off_t end;      // end of the range requested to the server
+    size_t window;  // least size of the next range, grows while preads are sequential
+    globus_mutex_t mutex;
+
+    GridFTPReadahead(): handler(NULL), request(NULL), stream(NULL), end(0), window(0)
+    {
+        globus_mutex_init(&mutex, NULL);
+    }
+
+    ~GridFTPReadahead()
+    {
+        close();
+        globus_mutex_destroy(&mutex);
+    }
+
+    void close()
+    {
+        if (!stream) {
+            return;
+        }
+        // Once the whole range has been read, the end of file is on its way,
+        // so give it a moment instead of aborting a transfer about to complete
+        globus_abstime_t deadline;
+        GlobusTimeAbstimeGetCurrent(deadline);
+        deadline.tv_sec += READAHEAD_EOF_GRACE;
+
+        globus_mutex_lock(&stream->mutex);
+        if (stream->offset >= end) {
+            int wait_ret = 0;
+            while (!stream->eof_received && !stream->error && stream->in_flight > 0 && wait_ret != ETIMEDOUT) {
+                wait_ret = globus_cond_timedwait(&stream->cond, &stream->mutex, &deadline);
+            }
+        }
+        bool complete = stream->eof_received;
+        globus_mutex_unlock(&stream->mutex);
+        if (!request->done && !complete) {
+            globus_ftp_client_abort(handler->get_ftp_client_handle());
+        }
+        try {
+            request->wait(GFAL_GRIDFTP_SCOPE_INTERNAL_PREAD);
+        }
+        catch (const Gfal::CoreException&) {
+            // Aborted, or already failed while reading
+        }
+        delete stream;
+        delete request;
+        delete handler;
+        stream = NULL;
+        request = NULL;
+        handler = NULL;
+    }
+};
+
+
 struct GridFTPFileDesc {
     GridFTPSessionHandler* handler;
     GridFTPRequestState* request;
@@ -45,6 +109,7 @@ struct GridFTPFileDesc {
     off_t current_offset;
     std::string url;
     globus_mutex_t mutex;
+    GridFTPReadahead readahead;
 
     GridFTPFileDesc(GridFTPSessionHandler* h, GridFTPRequestState* r,
             GridFTPStreamState * s, const std::string & _url, int flags) :
@@ -60,6 +125,7 @@ struct GridFTPFileDesc {
     virtual ~GridFTPFileDesc()
     {
         gfal2_log(G_LOG_LEVEL_DEBUG, "destroy descriptor for %s", url.c_str());
+        readahead.close();
         delete stream;
         delete request;
         delete handler;
@@ -110,13 +176,10 @@ inline int gridftp_rw_commit_put(GQuark scope, GridFTPFileDesc* desc)
 }
 
 
-// internal pread, do a read query with offset on a different descriptor, do not change the position of the current one.
-ssize_t gridftp_rw_internal_pread(GridFTPFactory * factory,
+// one-shot pread, do a read query with offset on a different session, do not change the position of the current one.
+static ssize_t gridftp_rw_oneshot_pread(GridFTPFactory * factory,
         GridFTPFileDesc* desc, void* buffer, size_t s_buff, off_t offset)
 {
-    // throw Gfal::CoreException
-    gfal2_log(G_LOG_LEVEL_DEBUG, " -> [GridFTPModule::internal_pread]");
-
     GridFTPSessionHandler handler(factory, desc->url);
     GridFTPRequestState request_state(&handler);
     GridFTPStreamState stream_state(&handler);
@@ -131,9 +194,149 @@ ssize_t gridftp_rw_internal_pread(GridFTPFactory * factory,
     ssize_t r_size = gridftp_read_stream(GFAL_GRIDFTP_SCOPE_INTERNAL_PREAD, &stream_state, buffer, s_buff, true);
 
     request_state.wait(GFAL_GRIDFTP_SCOPE_INTERNAL_PREAD);
-    gfal2_log(G_LOG_LEVEL_DEBUG, "[GridFTPModule::internal_pread] <-");
     return r_size;
+}
+
+
+// Start a new partial transfer at offset, for at least s_buff bytes
+static void gridftp_readahead_start(GridFTPFactory * factory, GridFTPFileDesc* desc,
+        size_t s_buff, off_t offset, size_t max_window)
+{
+    GridFTPReadahead& ra = desc->readahead;
+    gfal2_context_t context = factory->get_gfal2_context();
+
+    // Widen the window while the reads follow each other, drop it on random access
+    bool sequential = (ra.stream != NULL && ra.stream->offset == offset);
+    ra.close();
+    if (sequential) {
+        ra.window = std::min(max_window, std::max(ra.window, s_buff) * 2);
+    }
+    else {
+        ra.window = 0;
+    }
+    size_t length = std::max(s_buff, ra.window);
+
+    gfal2_log(G_LOG_LEVEL_DEBUG, " -> partial transfer from %lld, %zu bytes", (long long)offset, length);
+
+    ra.handler = new GridFTPSessionHandler(factory, desc->url);
+    ra.request = new GridFTPRequestState(ra.handler);
+    ra.stream = new GridFTPStreamState(ra.handler);
+    ra.stream->offset = offset;
+    ra.end = offset + length;
 
+    // The ring keeps collecting until the end of the range, so the transfer
+    // completes on its own once the caller has read everything
+    int nbuffers = gfal2_get_opt_integer_with_default(context, GRIDFTP_CONFIG_GROUP,
+            GRIDFTP_CONFIG_STREAM_BUFFERS, 4);
+    int buffer_size = gfal2_get_opt_integer_with_default(context, GRIDFTP_CONFIG_GROUP,
+            GRIDFTP_CONFIG_STREAM_BUFFER_SIZE, 1048576);
+    ra.stream->enable_ring(std::max(nbuffers, 2), buffer_size > 0 ? buffer_size : 1048576);
+
+    globus_result_t res = globus_ftp_client_partial_get(
+            ra.handler->get_ftp_client_handle(), desc->url.c_str(),
+            ra.handler->get_ftp_client_operationattr(),
+            NULL, offset, ra.end,
+            globus_ftp_client_done_callback, ra.request);
+    if (res != GLOBUS_SUCCESS) {
+        // Nothing was launched, so there is nothing to abort nor to wait for
+        ra.request->done = true;
+        ra.stream->done = true;
+        ra.close();
+    }
+    gfal_globus_check_result(GFAL_GRIDFTP_SCOPE_INTERNAL_PREAD, res);
+}
+
+
+#ifndef ECOMM
+#define ECOMM EIO
+#endif
+
+// Errors of a kept transfer worth a retry with a fresh one
+static bool gridftp_readahead_is_stale(int errcode)
+{
+    switch (errcode) {
+        case ECOMM:
+        case ECONNRESET:
+        case ECONNABORTED:
+        case EPIPE:
+        case ENOTCONN:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+// pread served from the partial transfer kept by the descriptor
+static ssize_t gridftp_rw_readahead_pread(GridFTPFactory * factory,
+        GridFTPFileDesc* desc, void* buffer, size_t s_buff, off_t offset, size_t max_window)
+{
+    GridFTPReadahead& ra = desc->readahead;
+    size_t total = 0;
+
+    while (total < s_buff) {
+        off_t pos = offset + total;
+        size_t wanted = s_buff - total;
+
+        bool fresh = false;
+        if (ra.stream == NULL || ra.stream->offset != pos || pos >= ra.end) {
+            gridftp_readahead_start(factory, desc, wanted, pos, max_window);
+            fresh = true;
+        }
+        else if (ra.stream->eof) {
+            break;
+        }
+
+        ssize_t r_size;
+        try {
+            r_size = gridftp_read_stream(GFAL_GRIDFTP_SCOPE_INTERNAL_PREAD, ra.stream,
+                    (char*)buffer + total, std::min<off_t>(wanted, ra.end - pos), false);
+        }
+        catch (const Gfal::CoreException& e) {
+            ra.close();
+            // The server may have dropped a transfer kept idle for too long, so retry once.
+            // Cancellations and timeouts are not the session going stale.
+            if (fresh || !gridftp_readahead_is_stale(e.code()))
+                throw;
+            gfal2_log(G_LOG_LEVEL_DEBUG, "Kept partial transfer failed, start a new one: %s", e.what());
+            continue;
+        }
+        if (r_size == 0)
+            break;
+        total += r_size;
+    }
+    return total;
+}
+
+
+// internal pread, do a read query with offset on a different session, do not change the position of the current one.
+ssize_t gridftp_rw_internal_pread(GridFTPFactory * factory,
+        GridFTPFileDesc* desc, void* buffer, size_t s_buff, off_t offset)
+{
+    // throw Gfal::CoreException
+    gfal2_log(G_LOG_LEVEL_DEBUG, " -> [GridFTPModule::internal_pread]");
+
+    int max_window = gfal2_get_opt_integer_with_default(factory->get_gfal2_context(),
+            GRIDFTP_CONFIG_GROUP, GRIDFTP_CONFIG_PREAD_READAHEAD, 8388608);
+
+    // Concurrent preads on the same descriptor do not wait for each other
+    ssize_t r_size;
+    if (max_window > 0 && globus_mutex_trylock(&desc->readahead.mutex) == 0) {
+        try {
+            r_size = gridftp_rw_readahead_pread(factory, desc, buffer, s_buff, offset, max_window);
+        }
+        catch (...) {
+            globus_mutex_unlock(&desc->readahead.mutex);
+            throw;
+        }
+        globus_mutex_unlock(&desc->readahead.mutex);
+    }
+    else {
+        r_size = gridftp_rw_oneshot_pread(factory, desc, buffer, s_buff, offset);
+    }
+
+    gfal2_log(G_LOG_LEVEL_DEBUG, "[GridFTPModule::internal_pread] <-");
+    return r_size;
 }
 
 // internal pwrite, do a write query with offset on a different descriptor, do not change the position of the current one.
@@ -212,6 +415,18 @@ gfal_file_handle GridFTPModule::open(const char* url, int flag, mode_t mode)
         desc->reset();
     }
 
+    if (desc->stream) {
+        gfal2_context_t context = get_session_factory()->get_gfal2_context();
+        int nbuffers = gfal2_get_opt_integer_with_default(context, GRIDFTP_CONFIG_GROUP,
+                GRIDFTP_CONFIG_STREAM_BUFFERS, 4);
+        int buffer_size = gfal2_get_opt_integer_with_default(context, GRIDFTP_CONFIG_GROUP,
+                GRIDFTP_CONFIG_STREAM_BUFFER_SIZE, 1048576);
+        if (nbuffers > 1 && buffer_size > 0) {
+            gfal2_log(G_LOG_LEVEL_DEBUG, " -> use %d stream buffers of %d bytes", nbuffers, buffer_size);
+            desc->stream->enable_ring(nbuffers, buffer_size);
+        }
+    }
+
     gfal2_log(G_LOG_LEVEL_DEBUG, " <- [GridFTPModule::open] ");
     return gfal_file_handle_new2(gridftp_plugin_name(), (gpointer) desc.release(), NULL, url);
 }
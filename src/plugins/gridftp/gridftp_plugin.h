@@ -37,6 +37,9 @@
 #define GRIDFTP_CONFIG_BLOCK_SIZE     "BLOCK_SIZE"
 #define GRIDFTP_CONFIG_NB_STREAM      "RD_NB_STREAM"
 #define GRIDFTP_CONFIG_RESOLVE_DNS    "RESOLVE_DNS"
+#define GRIDFTP_CONFIG_STREAM_BUFFERS "STREAM_BUFFERS"
+#define GRIDFTP_CONFIG_STREAM_BUFFER_SIZE "STREAM_BUFFER_SIZE"
+#define GRIDFTP_CONFIG_PREAD_READAHEAD "PREAD_READAHEAD"
 
 #define GRIDFTP_CONFIG_TRANSFER_CHECKSUM       "COPY_CHECKSUM_TYPE"
 #define GRIDFTP_CONFIG_TRANSFER_PERF_TIMEOUT   "PERF_MARKER_TIMEOUT"
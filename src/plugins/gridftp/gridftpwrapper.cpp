@@ -812,13 +812,74 @@ void GridFTPRequestState::cancel(GQuark scope, const std::string& msg, int errco
 
 
 GridFTPStreamState::GridFTPStreamState(GridFTPSessionHandler * s):
-        GridFTPRequestState(s), offset(0), buffer_size(0), eof(false), expect_eof(false)
+        GridFTPRequestState(s), offset(0), buffer_size(0), eof(false), expect_eof(false),
+        ring_size(0), in_flight(0), eof_received(false)
 {
 }
 
 
 GridFTPStreamState::~GridFTPStreamState()
 {
+    // The ring buffers must outlive their callbacks
+    globus_mutex_lock(&mutex);
+    bool pending = (in_flight > 0);
+    globus_mutex_unlock(&mutex);
+
+    if (pending) {
+        globus_ftp_client_abort(handler->get_ftp_client_handle());
+        globus_mutex_lock(&mutex);
+        while (in_flight > 0) {
+            globus_cond_wait(&cond, &mutex);
+        }
+        done = true;
+        globus_mutex_unlock(&mutex);
+    }
+
+    for (std::vector<GridFTPStreamSlot*>::iterator i = slots.begin(); i != slots.end(); ++i) {
+        delete *i;
+    }
+}
+
+
+void GridFTPStreamState::enable_ring(unsigned nbuffers, size_t buffer_size)
+{
+    ring_size = nbuffers;
+    this->buffer_size = buffer_size;
+}
+
+
+GridFTPStreamSlot* GridFTPStreamState::add_slot()
+{
+    GridFTPStreamSlot* slot = new GridFTPStreamSlot;
+    slot->stream = this;
+    slot->data.resize(buffer_size);
+    slot->in_flight = false;
+    slot->parked = false;
+    slots.push_back(slot);
+    return slot;
+}
+
+
+// Allocate the ring on first use, must be called with the stream mutex held
+static
+void gridftp_ring_allocate(GridFTPStreamState* stream)
+{
+    while (stream->slots.size() < stream->ring_size) {
+        stream->add_slot();
+    }
+}
+
+
+static
+void gfal_stream_set_error(GridFTPStreamState* state, globus_object_t *globus_error)
+{
+    char *err_buffer;
+    int err_code = gfal_globus_error_convert(globus_error, &err_buffer);
+    char err_static[2048];
+    g_strlcpy(err_static, err_buffer, sizeof(err_static));
+    g_free(err_buffer);
+    delete state->error;
+    state->error = new Gfal::CoreException(GFAL_GLOBUS_DONE_SCOPE, err_code, err_static);
 }
 
 
@@ -829,12 +890,7 @@ void gfal_stream_done_callback_err_handling(GridFTPStreamState* state,
         globus_bool_t eof)
 {
     if (globus_error != GLOBUS_SUCCESS) {
-        char *err_buffer;
-        int err_code = gfal_globus_error_convert(globus_error, &err_buffer);
-        char err_static[2048];
-        g_strlcpy(err_static, err_buffer, sizeof(err_static));
-        g_free(err_buffer);
-        state->error = new Gfal::CoreException(GFAL_GLOBUS_DONE_SCOPE, err_code, err_static);
+        gfal_stream_set_error(state, globus_error);
     }
 
     state->offset += length;
@@ -894,6 +950,281 @@ void gfal_griftp_stream_write_done_callback(void *user_arg,
 }
 
 
+static
+void gfal_gridftp_ring_read_done_callback(void *user_arg,
+        globus_ftp_client_handle_t *handle, globus_object_t *error,
+        globus_byte_t *buffer, globus_size_t length, globus_off_t offset,
+        globus_bool_t eof);
+
+
+// Register a ring buffer for reading, must be called with the stream mutex held
+static
+globus_result_t gridftp_ring_register_read(GridFTPStreamSlot* slot)
+{
+    GridFTPStreamState* stream = slot->stream;
+    globus_result_t res = globus_ftp_client_register_read(
+            stream->handler->get_ftp_client_handle(),
+            slot->data.data(),
+            slot->data.size(),
+            gfal_gridftp_ring_read_done_callback,
+            slot);
+    if (res == GLOBUS_SUCCESS) {
+        slot->in_flight = true;
+        ++stream->in_flight;
+    }
+    return res;
+}
+
+
+static
+void gfal_gridftp_ring_read_done_callback(void *user_arg,
+        globus_ftp_client_handle_t *handle, globus_object_t *error,
+        globus_byte_t *buffer, globus_size_t length, globus_off_t offset,
+        globus_bool_t eof)
+{
+    GridFTPStreamSlot* slot = static_cast<GridFTPStreamSlot*>(user_arg);
+    GridFTPStreamState* state = slot->stream;
+    globus_mutex_lock(&state->mutex);
+
+    slot->in_flight = false;
+    --state->in_flight;
+
+    if (error != GLOBUS_SUCCESS) {
+        if (!state->error)
+            gfal_stream_set_error(state, error);
+    }
+    else if (length > 0) {
+        // The data stays in the buffer until read, the buffer goes back to globus after
+        GridFTPStreamChunk chunk = {slot, length, 0};
+        state->received[offset] = chunk;
+        slot->parked = true;
+    }
+    if (eof) {
+        state->eof_received = true;
+    }
+
+    // Nothing delivered, keep the buffer posted
+    if (!slot->parked && !state->error && !state->eof_received) {
+        globus_result_t res = gridftp_ring_register_read(slot);
+        if (res != GLOBUS_SUCCESS) {
+            globus_object_t* register_error = globus_error_get(res);
+            gfal_stream_set_error(state, register_error);
+            globus_object_free(register_error);
+        }
+    }
+
+    state->done = true;
+    globus_cond_signal(&state->cond);
+    globus_mutex_unlock(&state->mutex);
+}
+
+
+static
+void gfal_gridftp_ring_write_done_callback(void *user_arg,
+        globus_ftp_client_handle_t *handle, globus_object_t *error,
+        globus_byte_t *buffer, globus_size_t length, globus_off_t offset,
+        globus_bool_t eof)
+{
+    GridFTPStreamSlot* slot = static_cast<GridFTPStreamSlot*>(user_arg);
+    GridFTPStreamState* state = slot->stream;
+    globus_mutex_lock(&state->mutex);
+
+    slot->in_flight = false;
+    --state->in_flight;
+
+    if (error != GLOBUS_SUCCESS && !state->error) {
+        gfal_stream_set_error(state, error);
+    }
+    if (eof) {
+        state->eof = true;
+    }
+
+    state->done = true;
+    globus_cond_signal(&state->cond);
+    globus_mutex_unlock(&state->mutex);
+}
+
+
+// Wait for the next ring callback, must be called with the stream mutex held
+static
+void gridftp_ring_wait(GQuark scope, GridFTPStreamState* stream)
+{
+    if (stream->error) {
+        Gfal::CoreException error(scope, stream->error->code(), stream->error->what());
+        globus_mutex_unlock(&stream->mutex);
+        throw error;
+    }
+    stream->done = false;
+    globus_mutex_unlock(&stream->mutex);
+    stream->wait(scope);
+    globus_mutex_lock(&stream->mutex);
+}
+
+
+// Copy received data into buffer, starting at the stream offset
+static
+size_t gridftp_ring_consume(GridFTPStreamState* stream, globus_byte_t* buffer, size_t s_read)
+{
+    size_t copied = 0;
+    while (copied < s_read && !stream->received.empty()) {
+        std::map<globus_off_t, GridFTPStreamChunk>::iterator i = stream->received.upper_bound(stream->offset);
+        if (i == stream->received.begin()) {
+            break;
+        }
+        --i;
+        GridFTPStreamChunk& chunk = i->second;
+        if (i->first + (globus_off_t)chunk.consumed != stream->offset) {
+            break;
+        }
+
+        size_t n = std::min(s_read - copied, chunk.length - chunk.consumed);
+        memcpy(buffer + copied, chunk.slot->data.data() + chunk.consumed, n);
+        chunk.consumed += n;
+        copied += n;
+        stream->offset += n;
+
+        if (chunk.consumed == chunk.length) {
+            chunk.slot->parked = false;
+            stream->received.erase(i);
+        }
+    }
+    return copied;
+}
+
+
+// Post again the buffers emptied by the reader
+static
+void gridftp_ring_refill(GridFTPStreamState* stream)
+{
+    for (std::vector<GridFTPStreamSlot*>::iterator i = stream->slots.begin(); i != stream->slots.end(); ++i) {
+        if (stream->eof_received || stream->error) {
+            break;
+        }
+        if (!(*i)->in_flight && !(*i)->parked) {
+            globus_result_t res = gridftp_ring_register_read(*i);
+            if (res != GLOBUS_SUCCESS) {
+                // Reported when the reader runs out of data
+                globus_object_free(globus_error_get(res));
+                break;
+            }
+        }
+    }
+}
+
+
+static
+ssize_t gridftp_read_stream_ring(GQuark scope,
+        GridFTPStreamState* stream, void* buffer, size_t s_read)
+{
+    globus_mutex_lock(&stream->mutex);
+    gridftp_ring_allocate(stream);
+
+    size_t copied = 0;
+    while (copied == 0 && s_read > 0) {
+        copied = gridftp_ring_consume(stream, (globus_byte_t*)buffer, s_read);
+        if (copied > 0) {
+            gridftp_ring_refill(stream);
+            break;
+        }
+
+        if (stream->eof_received && stream->in_flight == 0) {
+            if (stream->received.empty()) {
+                stream->eof = true;
+                break;
+            }
+            globus_mutex_unlock(&stream->mutex);
+            throw Gfal::CoreException(scope, EIO, "Data missing from the stream before the end of file");
+        }
+
+        // The next bytes can only come through an idle buffer, so post them all
+        for (std::vector<GridFTPStreamSlot*>::iterator i = stream->slots.begin();
+                i != stream->slots.end() && !stream->eof_received && !stream->error; ++i) {
+            if (!(*i)->in_flight && !(*i)->parked) {
+                globus_result_t res = gridftp_ring_register_read(*i);
+                if (res != GLOBUS_SUCCESS) {
+                    globus_mutex_unlock(&stream->mutex);
+                    gfal_globus_check_result(scope, res);
+                }
+            }
+        }
+        // Every buffer holds data past a gap, which only a new one can fill
+        if (stream->in_flight == 0 && !stream->eof_received && !stream->error) {
+            gfal2_log(G_LOG_LEVEL_DEBUG, "All the stream buffers are ahead of offset %lld, add one",
+                    (long long)stream->offset);
+            globus_result_t res = gridftp_ring_register_read(stream->add_slot());
+            if (res != GLOBUS_SUCCESS) {
+                globus_mutex_unlock(&stream->mutex);
+                gfal_globus_check_result(scope, res);
+            }
+        }
+        gridftp_ring_wait(scope, stream);
+    }
+
+    globus_mutex_unlock(&stream->mutex);
+    return copied;
+}
+
+
+static
+ssize_t gridftp_write_stream_ring(GQuark scope,
+        GridFTPStreamState* stream, const void* buffer, size_t s_write,
+        bool eof)
+{
+    globus_mutex_lock(&stream->mutex);
+    gridftp_ring_allocate(stream);
+
+    // The caller may reuse its buffer as soon as the data is queued.
+    // Large writes are queued in pieces of the size of the ring buffers.
+    size_t queued = 0;
+    do {
+        GridFTPStreamSlot* slot = NULL;
+        while (slot == NULL) {
+            for (std::vector<GridFTPStreamSlot*>::iterator i = stream->slots.begin(); i != stream->slots.end(); ++i) {
+                if (!(*i)->in_flight) {
+                    slot = *i;
+                    break;
+                }
+            }
+            if (slot == NULL || stream->error) {
+                slot = NULL;
+                gridftp_ring_wait(scope, stream);
+            }
+        }
+
+        size_t piece = std::min(s_write - queued, slot->data.size());
+        bool last = (queued + piece == s_write);
+        memcpy(slot->data.data(), (const globus_byte_t*)buffer + queued, piece);
+        globus_result_t res = globus_ftp_client_register_write(
+            stream->handler->get_ftp_client_handle(),
+            slot->data.data(),
+            piece,
+            stream->offset,
+            eof && last,
+            gfal_gridftp_ring_write_done_callback,
+            slot
+        );
+        if (res != GLOBUS_SUCCESS) {
+            globus_mutex_unlock(&stream->mutex);
+            gfal_globus_check_result(scope, res);
+        }
+        slot->in_flight = true;
+        ++stream->in_flight;
+        stream->offset += piece;
+        queued += piece;
+    } while (queued < s_write);
+
+    // Once the end is queued, all the data must have been acknowledged before returning
+    if (eof) {
+        while (stream->in_flight > 0 || stream->error) {
+            gridftp_ring_wait(scope, stream);
+        }
+    }
+
+    globus_mutex_unlock(&stream->mutex);
+    return s_write;
+}
+
+
 ssize_t gridftp_read_stream(GQuark scope,
         GridFTPStreamState* stream, void* buffer, size_t s_read, bool expect_eof)
 {
@@ -903,6 +1234,9 @@ ssize_t gridftp_read_stream(GQuark scope,
 
     if (stream->eof)
         return 0;
+    if (stream->ring_size > 0)
+        return gridftp_read_stream_ring(scope, stream, buffer, s_read);
+
     stream->done = false;
     stream->buffer_size = s_read;
     stream->expect_eof = expect_eof;
@@ -925,6 +1259,9 @@ ssize_t gridftp_write_stream(GQuark scope,
     gfal2_log(G_LOG_LEVEL_DEBUG, "  -> [gridftp_write_stream]");
     off_t initial_offset = stream->offset;
 
+    if (stream->ring_size > 0)
+        return gridftp_write_stream_ring(scope, stream, buffer, s_write, eof);
+
     stream->done = false;
 	globus_result_t res = globus_ftp_client_register_write(
 	    stream->handler->get_ftp_client_handle(),
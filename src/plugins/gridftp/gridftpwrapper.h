@@ -29,6 +29,7 @@
 #include <algorithm>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include <glib.h>
 
@@ -75,6 +76,21 @@ class GridFTPRequestState {
     time_t default_timeout;
 };
 
+// Buffer of a stream ring, registered with globus while in flight
+struct GridFTPStreamSlot {
+    GridFTPStreamState* stream;
+    std::vector<globus_byte_t> data;
+    bool in_flight;
+    bool parked;    // holds received data not read yet
+};
+
+// Ring buffer parked with data received ahead of the stream offset
+struct GridFTPStreamChunk {
+    GridFTPStreamSlot* slot;
+    size_t length;
+    size_t consumed;
+};
+
 class GridFTPStreamState: public GridFTPRequestState {
 public:
     off_t offset;    // file offset in the stream
@@ -82,8 +98,24 @@ public:
 	bool eof;        // end of file reached
 	bool expect_eof; // true for partial reads, false for streamed reads
 
+    // Ring of buffers kept registered with globus, so several data channels
+    // can deliver at once. If ring_size is 0, the caller buffer is registered directly.
+    // The buffers are only allocated by the first streamed read or write.
+    unsigned ring_size;
+    std::vector<GridFTPStreamSlot*> slots;
+    int in_flight;
+    bool eof_received;
+    // Parked buffers, by file offset
+    std::map<globus_off_t, GridFTPStreamChunk> received;
+
 	GridFTPStreamState(GridFTPSessionHandler * s);
     virtual ~GridFTPStreamState();
+
+    // Keep nbuffers buffers of buffer_size bytes registered for sequential reads and writes
+    void enable_ring(unsigned nbuffers, size_t buffer_size);
+
+    // Add a buffer to the ring, must be called with the mutex held
+    GridFTPStreamSlot* add_slot();
 };
 
 
@@ -19,6 +19,7 @@
  */
 
 #include "gfal_mock_plugin.h"
+#include <poll.h>
 #include <string.h>
 
 
@@ -97,9 +98,18 @@ int gfal_plugin_mock_filecopy(plugin_handle plugin_data,
     plugin_trigger_event(params, gfal2_get_plugin_mock_quark(),
         GFAL_EVENT_NONE, GFAL_EVENT_TRANSFER_TYPE, "mock");
 
+    struct pollfd cancel_fd;
+    cancel_fd.fd = gfal2_cancel_get_fd(context);
+    cancel_fd.events = POLLIN;
+
     while (seconds > 0) {
-        sleep(1);
-        --seconds;
+        // Wake up as soon as the transfer is canceled
+        if (cancel_fd.fd >= 0)
+            poll(&cancel_fd, 1, 1000);
+        else
+            sleep(1);
+        if (seconds > 0)
+            --seconds;
 
         // Fail here
         if (transfer_errno) {
@@ -258,6 +258,7 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError **err)
     srm_plugin.abort_files = &gfal_srm2_abort_filesG;
     srm_plugin.renameG = &gfal_srm_renameG;
     srm_plugin.unlink_listG = &gfal_srm_unlink_listG;
+    srm_plugin.stat_listG = &gfal_srm_stat_listG;
     srm_plugin.archive_poll = &gfal_srm_archive_pollG;
     srm_plugin.archive_poll_list = &gfal_srm_archive_poll_listG;
     return srm_plugin;
@@ -77,6 +77,8 @@ int gfal_srm_archive_poll_listG(plugin_handle ch, int nbfiles, const char* const
 
     gfal2_log(G_LOG_LEVEL_DEBUG, " gfal_srm_archive_poll_listG ->");
 
+    // The polls share the srm context, which is locked for the duration of each
+    // request, so running them from several threads would not make them any faster
     for (i = 0; i < nbfiles; i++) {
         if (!surls[i]) {
             gfal2_set_error(&errors[i], gfal2_get_plugin_srm_quark(), EINVAL, __func__, "Invalid surl value");
@@ -30,6 +30,9 @@ struct extended_stat {
 int gfal_statG_srmv2__generic_internal(srm_context_t context, struct stat *buf, TFileLocality *loc,
     const char *surl, GError **err);
 
+int gfal_statG_srmv2__list_internal(srm_context_t context, int nbfiles, const char *const *surls,
+    struct stat *bufs, TFileLocality *locs, GError **errors);
+
 int gfal_srm_cache_stat_add(plugin_handle ch, const char *surl, const struct stat *value, const TFileLocality *loc);
 
 void gfal_srm_cache_stat_remove(plugin_handle ch, const char *surl);
@@ -75,3 +75,74 @@ int gfal_srm_statG(plugin_handle ch, const char *surl, struct stat *buf, GError
 
     return ret;
 }
+
+
+
+// Bulk stat. Entries found in the cache are served from there, the rest go
+// into a single srmLs request
+int gfal_srm_stat_listG(plugin_handle ch, int nbfiles, const char *const *surls,
+    struct stat *buffers, GError **errors)
+{
+    GError *tmp_err = NULL;
+    gfal_srmv2_opt *opts = (gfal_srmv2_opt *) ch;
+    char key_buff[GFAL_URL_MAX_LEN];
+    struct extended_stat xstat;
+    int i, npending = 0, ret = 0;
+
+    char **decoded = g_new0(char *, nbfiles);
+    int *pending_index = g_new0(int, nbfiles);
+    struct stat *pending_buffers = g_new0(struct stat, nbfiles);
+    TFileLocality *pending_locs = g_new0(TFileLocality, nbfiles);
+    GError **pending_errors = g_new0(GError *, nbfiles);
+
+    for (i = 0; i < nbfiles; ++i) {
+        gfal_srm_construct_key(surls[i], GFAL_SRM_LSTAT_PREFIX, key_buff, GFAL_URL_MAX_LEN);
+        if (gsimplecache_take_one_kstr(opts->cache, key_buff, &xstat) == 0) {
+            buffers[i] = xstat.stat;
+        }
+        else {
+            pending_index[npending] = i;
+            pending_errors[npending] = NULL;
+            decoded[npending] = gfal2_srm_get_decoded_path(surls[i]);
+            ++npending;
+        }
+    }
+
+    gfal2_log(G_LOG_LEVEL_DEBUG, "   [gfal_srm_stat_listG] %d entries from the cache, %d to request",
+        nbfiles - npending, npending);
+
+    if (npending == 0)
+        goto out;
+
+    gfal_srm_easy_t easy = gfal_srm_ifce_easy_context(opts, surls[pending_index[0]], &tmp_err);
+    if (easy != NULL) {
+        ret = gfal_statG_srmv2__list_internal(easy->srm_context, npending, (const char *const *) decoded,
+            pending_buffers, pending_locs, pending_errors);
+    }
+    gfal_srm_ifce_easy_context_release(opts, easy);
+
+    for (i = 0; i < npending; ++i) {
+        const int index = pending_index[i];
+        if (tmp_err) {
+            errors[index] = g_error_copy(tmp_err);
+            ret = -1;
+        }
+        else if (pending_errors[i]) {
+            errors[index] = pending_errors[i];
+        }
+        else {
+            buffers[index] = pending_buffers[i];
+            gfal_srm_cache_stat_add(ch, surls[index], &buffers[index], &pending_locs[i]);
+        }
+        g_free(decoded[i]);
+    }
+    g_clear_error(&tmp_err);
+
+out:
+    g_free(decoded);
+    g_free(pending_index);
+    g_free(pending_buffers);
+    g_free(pending_locs);
+    g_free(pending_errors);
+    return ret;
+}
@@ -19,25 +19,45 @@
  */
 
 #include <ctype.h>
+#include <strings.h>
+#include <sys/stat.h>
 #include <gfal_plugins_api.h>
 #include "gfal_xrootd_plugin_interface.h"
 #include "gfal_xrootd_plugin_utils.h"
+#include "gfal_xrootd_plugin_copy_controller.h"
 #include "uri/gfal2_parsing.h"
 
 #undef TRUE
 #undef FALSE
 
+#include <algorithm>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include <XrdCl/XrdClCopyProcess.hh>
 #include <XrdCl/XrdClFileSystem.hh>
 #include <XrdVersion.hh>
 
 
+// A wave of an adaptive bulk copy holds this many jobs per parallel slot.
+// The parallelism of a CopyProcess is fixed once prepared, so each wave is a
+// barrier: a slow file holds the free slots until the wave drains. A few
+// jobs per slot keep that tail short relative to the wave.
+static const size_t WAVE_JOBS_PER_SLOT = 4;
+
+
+static double monotonic_seconds()
+{
+    return g_get_monotonic_time() / 1000000.0;
+}
+
+
 class CopyFeedback: public XrdCl::CopyProgressHandler
 {
 public:
-    CopyFeedback(gfal2_context_t context, gfalt_params_t p, bool isThirdParty) :
-            context(context), params(p), startTime(0), isThirdParty(isThirdParty)
+    CopyFeedback(gfal2_context_t context, gfalt_params_t p, bool isThirdParty, CopyController* controller) :
+            context(context), params(p), startTime(0), isThirdParty(isThirdParty), controller(controller)
     {
         memset(&status, 0x00, sizeof(status));
     }
@@ -103,6 +123,10 @@ public:
         this->status.instant_baudrate = this->status.average_baudrate;
 
         plugin_trigger_monitor(this->params, &this->status, this->source.c_str(), this->destination.c_str());
+
+        if (this->controller) {
+            this->controller->JobProgress(jobNum, bytesProcessed, monotonic_seconds());
+        }
     }
 
     bool ShouldCancel(uint16_t jobNum)
@@ -119,6 +143,7 @@ private:
 
     std::string source, destination;
     bool isThirdParty;
+    CopyController* controller;
 };
 
 
@@ -203,6 +228,188 @@ static int gfal_xrootd_copy_cleanup(plugin_handle plugin_data, const gfalt_param
     return -1;
 }
 
+// What is learned about a transfer before it is handed to CopyProcess,
+// so CopyProcess does not have to ask again
+struct CopyPrecheck
+{
+    XrdCl::URL source, destination;
+    // Source checksum to prefetch, empty if none
+    std::string checksumType;
+    std::string sourceChecksum;
+    bool checkDestination;
+    bool destinationExists;
+
+    CopyPrecheck(): checkDestination(false), destinationExists(false)
+    {
+    }
+};
+
+
+class PrecheckRequests
+{
+public:
+    std::mutex mutex;
+    std::condition_variable cv;
+    int pending;
+
+    PrecheckRequests(): pending(0)
+    {
+    }
+
+    void Add()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++pending;
+    }
+
+    void Done()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --pending;
+        cv.notify_all();
+    }
+
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return pending == 0; });
+    }
+};
+
+
+class PrecheckHandler: public XrdCl::ResponseHandler
+{
+protected:
+    PrecheckRequests& requests;
+    CopyPrecheck& precheck;
+
+    virtual void OnResponse(const XrdCl::XRootDStatus& status, XrdCl::AnyObject* response) = 0;
+
+public:
+    PrecheckHandler(PrecheckRequests& requests, CopyPrecheck& precheck):
+        requests(requests), precheck(precheck)
+    {
+    }
+
+    void HandleResponse(XrdCl::XRootDStatus* status, XrdCl::AnyObject* response)
+    {
+        OnResponse(*status, response);
+        delete status;
+        delete response;
+
+        PrecheckRequests& r = requests;
+        delete this;
+        r.Done();
+    }
+};
+
+
+class PrecheckChecksumHandler: public PrecheckHandler
+{
+protected:
+    void OnResponse(const XrdCl::XRootDStatus& status, XrdCl::AnyObject* response)
+    {
+        XrdCl::Buffer* buffer = NULL;
+        if (status.IsOK() && response)
+            response->Get(buffer);
+        if (!buffer) {
+            gfal2_log(G_LOG_LEVEL_DEBUG, "Could not prefetch the source checksum: %s", status.ToStr().c_str());
+            return;
+        }
+
+        // The answer is "type value"
+        std::string answer(buffer->GetBuffer(), buffer->GetSize());
+        answer.erase(answer.find_last_not_of(std::string("\0\n ", 3)) + 1);
+        size_t space = answer.find(' ');
+        if (space != precheck.checksumType.size() ||
+            strncasecmp(answer.c_str(), precheck.checksumType.c_str(), space) != 0) {
+            gfal2_log(G_LOG_LEVEL_DEBUG, "Unexpected source checksum '%s'", answer.c_str());
+            return;
+        }
+        precheck.sourceChecksum = answer.substr(space + 1);
+        std::transform(precheck.sourceChecksum.begin(), precheck.sourceChecksum.end(),
+            precheck.sourceChecksum.begin(), ::tolower);
+    }
+
+public:
+    PrecheckChecksumHandler(PrecheckRequests& requests, CopyPrecheck& precheck):
+        PrecheckHandler(requests, precheck)
+    {
+    }
+};
+
+
+class PrecheckDestinationHandler: public PrecheckHandler
+{
+protected:
+    void OnResponse(const XrdCl::XRootDStatus& status, XrdCl::AnyObject* response)
+    {
+        precheck.destinationExists = status.IsOK();
+    }
+
+public:
+    PrecheckDestinationHandler(PrecheckRequests& requests, CopyPrecheck& precheck):
+        PrecheckHandler(requests, precheck)
+    {
+    }
+};
+
+
+/// Query concurrently the source checksums that CopyProcess would otherwise ask for one
+/// transfer at a time, and check in the same round whether the destinations exist.
+/// The destination check does not depend on the checksum mode, so an existing destination
+/// without overwrite always fails the same way. Other failures are left for CopyProcess.
+static void gfal_xrootd_3rd_precheck(std::vector<CopyPrecheck>& prechecks)
+{
+    bool needed = false;
+    for (size_t i = 0; i < prechecks.size() && !needed; ++i) {
+        needed = !prechecks[i].checksumType.empty() || prechecks[i].checkDestination;
+    }
+    if (!needed) {
+        return;
+    }
+
+    FileSystemMap filesystems;
+    PrecheckRequests requests;
+
+    for (size_t i = 0; i < prechecks.size(); ++i) {
+        CopyPrecheck& precheck = prechecks[i];
+
+        if (!precheck.checksumType.empty()) {
+            std::string query = precheck.source.GetPathWithParams();
+            query += (query.find('?') == std::string::npos) ? "?" : "&";
+            query += "cks.type=" + precheck.checksumType;
+
+            XrdCl::Buffer arg;
+            arg.FromString(query);
+            requests.Add();
+            PrecheckHandler* handler = new PrecheckChecksumHandler(requests, precheck);
+            XrdCl::FileSystem& fs = get_filesystem(filesystems, precheck.source);
+            if (!fs.Query(XrdCl::QueryCode::Checksum, arg, handler).IsOK()) {
+                delete handler;
+                requests.Done();
+            }
+        }
+
+        if (precheck.checkDestination && precheck.destination.GetProtocol() == "file") {
+            struct stat st;
+            precheck.destinationExists = (::stat(precheck.destination.GetPath().c_str(), &st) == 0);
+        }
+        else if (precheck.checkDestination) {
+            requests.Add();
+            PrecheckHandler* handler = new PrecheckDestinationHandler(requests, precheck);
+            XrdCl::FileSystem& fs = get_filesystem(filesystems, precheck.destination);
+            if (!fs.Stat(precheck.destination.GetPathWithParams(), handler).IsOK()) {
+                delete handler;
+                requests.Done();
+            }
+        }
+    }
+
+    requests.Wait();
+}
+
+
 int gfal_xrootd_3rd_copy_bulk(plugin_handle plugin_data,
         gfal2_context_t context, gfalt_params_t params, size_t nbfiles,
         const char* const * srcs, const char* const * dsts,
@@ -218,7 +425,6 @@ int gfal_xrootd_3rd_copy_bulk(plugin_handle plugin_data,
         _checksumType, sizeof(_checksumType),
         _checksumValue, sizeof(_checksumValue), NULL);
 
-    XrdCl::CopyProcess copy_process;
     std::vector<XrdCl::PropertyList> results;
     for (size_t i = 0; i < nbfiles; ++i) {
         results.push_back(XrdCl::PropertyList());
@@ -226,16 +432,22 @@ int gfal_xrootd_3rd_copy_bulk(plugin_handle plugin_data,
 
     const char* src_spacetoken =  gfalt_get_src_spacetoken(params, NULL);
     const char* dst_spacetoken =  gfalt_get_dst_spacetoken(params, NULL);
+    const gboolean replace = gfalt_get_replace_existing_file(params, NULL);
+
+    std::vector<XrdCl::PropertyList> jobs(nbfiles);
+    std::vector<CopyPrecheck> prechecks(nbfiles);
 
     for (size_t i = 0; i < nbfiles; ++i) {
-        XrdCl::URL source_url, dest_url;
+        XrdCl::URL& source_url = prechecks[i].source;
+        XrdCl::URL& dest_url = prechecks[i].destination;
         gfal_xrootd_3rd_init_url(context, source_url, srcs[i], src_spacetoken);
         gfal_xrootd_3rd_init_url(context, dest_url, dsts[i], dst_spacetoken);
+        prechecks[i].checkDestination = !replace;
 
-        XrdCl::PropertyList job;
+        XrdCl::PropertyList& job = jobs[i];
         job.Set("source", source_url.GetURL());
         job.Set("target", dest_url.GetURL());
-        job.Set("force", gfalt_get_replace_existing_file(params, NULL));
+        job.Set("force", replace);
         job.Set("makeDir", gfalt_get_create_parent_dir(params, NULL));
         job.Set("SubStreamsPerChannel", gfalt_get_nbstreams(params, NULL));
         job.Set("posc", true);
@@ -300,30 +512,86 @@ int gfal_xrootd_3rd_copy_bulk(plugin_handle plugin_data,
             job.Set("checkSumMode", sChecksumMode);
             job.Set("checkSumType", sChecksumType);
             job.Set("checkSumPreset", sChecksumValue);
-        }
 
-        copy_process.AddJob(job, &(results[i]));
+            // Without a user provided value, CopyProcess asks the source for its checksum
+            if (checksumMode == GFALT_CHECKSUM_BOTH && sChecksumValue.empty() && source_url.GetProtocol() != "file") {
+                prechecks[i].checksumType = sChecksumType;
+            }
+        }
     }
 
-    // Configuration job
+    gfal_xrootd_3rd_precheck(prechecks);
+
     int parallel = gfal2_get_opt_integer_with_default(context,
             XROOTD_CONFIG_GROUP, XROOTD_PARALLEL_COPIES,
             20);
+    int minParallel = gfal2_get_opt_integer_with_default(context,
+            XROOTD_CONFIG_GROUP, XROOTD_PARALLEL_COPIES_MIN, parallel);
+    int maxParallel = gfal2_get_opt_integer_with_default(context,
+            XROOTD_CONFIG_GROUP, XROOTD_PARALLEL_COPIES_MAX, parallel);
+    int targetRate = gfal2_get_opt_integer_with_default(context,
+            XROOTD_CONFIG_GROUP, XROOTD_COPY_TARGET_RATE, 0);
+
+    CopyController controller(minParallel, maxParallel, parallel,
+            targetRate > 0 ? (uint64_t)targetRate << 20 : 0);
+    CopyFeedback feedback(context, params, isThirdParty, &controller);
+    XrdCl::XRootDStatus status, prepareStatus;
+
+    // With a fixed parallelism, everything goes in a single wave.
+    // Otherwise, the controller picks the settings of each wave from the previous one.
+    size_t next = 0, waveStart = 0;
+    while (next < nbfiles) {
+        waveStart = next;
+        size_t end = nbfiles;
+        if (controller.IsAdaptive()) {
+            end = std::min(nbfiles, next + WAVE_JOBS_PER_SLOT * controller.GetParallel());
+        }
 
-    XrdCl::PropertyList config_job;
-    config_job.Set("jobType", "configuration");
-    config_job.Set("parallel", parallel);
-    copy_process.AddJob(config_job, NULL);
+        XrdCl::CopyProcess copy_process;
+        for (; next < end; ++next) {
+            // Reported as failed below, without starting the transfer
+            if (prechecks[next].destinationExists) {
+                continue;
+            }
+            if (!prechecks[next].sourceChecksum.empty()) {
+                gfal2_log(G_LOG_LEVEL_DEBUG, "Prefetched source checksum: %s",
+                    prechecks[next].sourceChecksum.c_str());
+                jobs[next].Set("checkSumPreset", prechecks[next].sourceChecksum);
+            }
+            if (controller.IsAdaptive() && !isThirdParty) {
+                jobs[next].Set("chunkSize", (uint32_t)controller.GetChunkSize());
+            }
+            copy_process.AddJob(jobs[next], &(results[next]));
+        }
 
+        // Configuration job
+        gfal2_log(G_LOG_LEVEL_DEBUG, "Copy wave: parallel=%d chunk_size=%llu", controller.GetParallel(),
+                (unsigned long long)controller.GetChunkSize());
 
-    XrdCl::XRootDStatus status = copy_process.Prepare();
-    if (!status.IsOK()) {
-        xrootd2gliberr(op_error, __func__, "Error on XrdCl::CopyProcess::Prepare(): %s", status);
-        return -1;
+        XrdCl::PropertyList config_job;
+        config_job.Set("jobType", "configuration");
+        config_job.Set("parallel", controller.GetParallel());
+        copy_process.AddJob(config_job, NULL);
+
+        // Earlier waves may have copied files already, so this is reported per file below
+        prepareStatus = copy_process.Prepare();
+        if (!prepareStatus.IsOK()) {
+            break;
+        }
+
+        controller.BeginWave(monotonic_seconds());
+        status = copy_process.Run(&feedback);
+        controller.EndWave(monotonic_seconds());
+
+        if (gfal2_is_canceled(context)) {
+            break;
+        }
     }
 
-    CopyFeedback feedback(context, params, isThirdParty);
-    status = copy_process.Run(&feedback);
+    if (nbfiles == 1 && !prepareStatus.IsOK()) {
+        xrootd2gliberr(op_error, __func__, "Error on XrdCl::CopyProcess::Prepare(): %s", prepareStatus);
+        return -1;
+    }
 
     // On bulk operations, even if there is one single failure we will get it
     // here, so ignore!
@@ -345,6 +613,27 @@ int gfal_xrootd_3rd_copy_bulk(plugin_handle plugin_data,
     *file_errors = g_new0(GError*, nbfiles);
     const char* files_to_evict[nbfiles];
     for (size_t i = 0; i < nbfiles; ++i) {
+        // Never started, as a wave could not be prepared
+        if (!prepareStatus.IsOK() && i >= waveStart) {
+            xrootd2gliberr(&((*file_errors)[i]), __func__, "Error on XrdCl::CopyProcess::Prepare(): %s",
+                prepareStatus);
+            ++n_failed;
+            continue;
+        }
+        // Left out by a cancellation between waves
+        if (i >= next) {
+            gfal2_set_error(&((*file_errors)[i]), xrootd_domain, ECANCELED, __func__,
+                "The transfer has been canceled");
+            ++n_failed;
+            continue;
+        }
+        if (prechecks[i].destinationExists) {
+            gfal2_set_error(&((*file_errors)[i]), xrootd_domain, EEXIST, __func__,
+                "The destination file exists and overwrite is not enabled");
+            ++n_failed;
+            continue;
+        }
+
         status = results[i].Get<XrdCl::XRootDStatus>("status");
         if (!status.IsOK()) {
             xrootd2gliberr(&((*file_errors)[i]), __func__, "Error on XrdCl::CopyProcess::Run(): %s", status);
@@ -38,15 +38,10 @@ int gfal_xrootd_archive_poll(plugin_handle plugin_data, const char* url, GError*
 }
 
 
-int gfal_xrootd_archive_poll_list(plugin_handle plugin_data, int nbfiles, const char* const* urls,
-                                  GError** errors)
+// Poll the archiving of files all served by the same endpoint
+static int gfal_xrootd_archive_poll_endpoint(gfal2_context_t context, int nbfiles, const char* const* urls,
+                                             GError** errors)
 {
-    if (nbfiles <= 0) {
-        return 1;
-    }
-
-    gfal2_context_t context = (gfal2_context_t) plugin_data;
-
     XrdCl::URL endpoint(prepare_url(context, urls[0]));
     endpoint.SetPath(std::string());
     XrdCl::FileSystem fs(endpoint);
@@ -219,3 +214,24 @@ int gfal_xrootd_archive_poll_list(plugin_handle plugin_data, int nbfiles, const
     // Archiving in process: return 0
     return 0;
 }
+
+
+int gfal_xrootd_archive_poll_list(plugin_handle plugin_data, int nbfiles, const char* const* urls,
+                                  GError** errors)
+{
+    if (nbfiles <= 0) {
+        return 1;
+    }
+
+    gfal2_context_t context = (gfal2_context_t) plugin_data;
+
+    std::map<std::string, int> results = run_per_endpoint(context, nbfiles, urls, errors,
+        [&](const std::string& endpoint, int n, const char* const* group, GError** group_errors) {
+            return gfal_xrootd_archive_poll_endpoint(context, n, group, group_errors);
+        });
+
+    if (results.size() == 1) {
+        return results.begin()->second;
+    }
+    return poll_result_from_errors(nbfiles, errors);
+}
@@ -18,7 +18,9 @@
 #include "gfal_xrootd_plugin_interface.h"
 #include "gfal_xrootd_plugin_utils.h"
 
+#include <cstring>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <algorithm>
 #include <json.h>
@@ -26,16 +28,10 @@
 #include <XrdSys/XrdSysPthread.hh>
 
 
-int gfal_xrootd_bring_online_list(plugin_handle plugin_data,
-    int nbfiles, const char* const* urls, time_t pintime, time_t timeout, char* token, size_t tsize,
-    int async, GError** err)
+// Staging request for files all served by the same endpoint
+static int gfal_xrootd_bring_online_endpoint(gfal2_context_t context,
+    int nbfiles, const char* const* urls, time_t timeout, std::string& token, GError** err)
 {
-    if (nbfiles <= 0) {
-        return 1;
-    }
-
-    gfal2_context_t context = (gfal2_context_t)plugin_data;
-
     XrdCl::URL endpoint(prepare_url(context, urls[0]));
     endpoint.SetPath(std::string());
     XrdCl::FileSystem fs(endpoint);
@@ -61,9 +57,12 @@ int gfal_xrootd_bring_online_list(plugin_handle plugin_data,
         return -1;
     }
     if (responsePtr && responsePtr->GetBuffer()) {
-        copy_to_cstring(token, tsize, responsePtr->GetBuffer(), responsePtr->GetSize());
+        token.assign(responsePtr->GetBuffer(), strnlen(responsePtr->GetBuffer(), responsePtr->GetSize()));
     } else {
         gfal2_log(G_LOG_LEVEL_DEBUG, "Empty response from the server");
+        for (int i = 0; i < nbfiles; ++i) {
+            gfal2_set_error(&err[i], xrootd_domain, ENOMSG, __func__, "Empty response from the server");
+        }
         delete responsePtr;
         return -1;
     }
@@ -72,6 +71,47 @@ int gfal_xrootd_bring_online_list(plugin_handle plugin_data,
 }
 
 
+int gfal_xrootd_bring_online_list(plugin_handle plugin_data,
+    int nbfiles, const char* const* urls, time_t pintime, time_t timeout, char* token, size_t tsize,
+    int async, GError** err)
+{
+    if (nbfiles <= 0) {
+        return 1;
+    }
+
+    gfal2_context_t context = (gfal2_context_t)plugin_data;
+
+    // The files of an endpoint that refused the request keep failing when polled
+    std::string joined = submit_per_endpoint(context, nbfiles, urls, err,
+        [&](const std::string& endpoint, int n, const char* const* group, GError** errors, std::string& endpointToken) {
+            return gfal_xrootd_bring_online_endpoint(context, n, group, timeout, endpointToken, errors);
+        });
+
+    if (joined.empty()) {
+        return -1;
+    }
+    if (joined.size() >= tsize) {
+        // Without the token the caller can neither poll nor abort, so cancel what was accepted
+        gfal2_log(G_LOG_LEVEL_WARNING, "Aborting the staging requests, their token does not fit: %s",
+            joined.c_str());
+        std::vector<GError*> abortErrors(nbfiles, NULL);
+        gfal_xrootd_abort_files(plugin_data, nbfiles, urls, joined.c_str(), abortErrors.data());
+        for (int i = 0; i < nbfiles; ++i) {
+            g_clear_error(&abortErrors[i]);
+        }
+        for (int i = 0; i < nbfiles; ++i) {
+            if (err[i] == NULL) {
+                gfal2_set_error(&err[i], xrootd_domain, ENOBUFS, __func__,
+                    "The request token does not fit in %zu bytes: %s", tsize, joined.c_str());
+            }
+        }
+        return -1;
+    }
+    g_strlcpy(token, joined.c_str(), tsize);
+    return 0;
+}
+
+
 int gfal_xrootd_bring_online_list_v2(plugin_handle plugin_data,
     int nbfiles, const char* const* urls, const char* const* metadata,
     time_t pintime, time_t timeout, char* token, size_t tsize, int async, GError** err)
@@ -80,14 +120,10 @@ int gfal_xrootd_bring_online_list_v2(plugin_handle plugin_data,
 }
 
 
-int gfal_xrootd_bring_online_poll_list(plugin_handle plugin_data,
+// Poll the staging of files all served by the same endpoint
+static int gfal_xrootd_bring_online_poll_endpoint(gfal2_context_t context,
     int nbfiles, const char* const* urls, const char* token, GError** err)
 {
-    if (nbfiles <= 0) {
-        return 1;
-    }
-    gfal2_context_t context = (gfal2_context_t)plugin_data;
-
     XrdCl::URL endpoint(prepare_url(context, urls[0]));
     endpoint.SetPath(std::string());
     XrdCl::FileSystem fs(endpoint);
@@ -300,11 +336,31 @@ int gfal_xrootd_bring_online_poll_list(plugin_handle plugin_data,
 }
 
 
-int gfal_xrootd_release_file_list(plugin_handle plugin_data,
+int gfal_xrootd_bring_online_poll_list(plugin_handle plugin_data,
     int nbfiles, const char* const* urls, const char* token, GError** err)
 {
+    if (nbfiles <= 0) {
+        return 1;
+    }
     gfal2_context_t context = (gfal2_context_t)plugin_data;
 
+    std::map<std::string, int> results = run_per_endpoint_token(context, nbfiles, urls, token, err,
+        [&](const std::string& endpoint, int n, const char* const* group, GError** errors,
+            const std::string& endpointToken) {
+            return gfal_xrootd_bring_online_poll_endpoint(context, n, group, endpointToken.c_str(), errors);
+        });
+
+    if (results.size() == 1) {
+        return results.begin()->second;
+    }
+    return poll_result_from_errors(nbfiles, err);
+}
+
+
+// Evict files all served by the same endpoint
+static int gfal_xrootd_release_file_endpoint(gfal2_context_t context,
+    int nbfiles, const char* const* urls, GError** err)
+{
     XrdCl::URL endpoint(prepare_url(context, urls[0]));
     endpoint.SetPath(std::string());
     XrdCl::FileSystem fs(endpoint);
@@ -334,6 +390,28 @@ int gfal_xrootd_release_file_list(plugin_handle plugin_data,
 }
 
 
+int gfal_xrootd_release_file_list(plugin_handle plugin_data,
+    int nbfiles, const char* const* urls, const char* token, GError** err)
+{
+    if (nbfiles <= 0) {
+        return 0;
+    }
+    gfal2_context_t context = (gfal2_context_t)plugin_data;
+
+    std::map<std::string, int> results = run_per_endpoint(context, nbfiles, urls, err,
+        [&](const std::string& endpoint, int n, const char* const* group, GError** errors) {
+            return gfal_xrootd_release_file_endpoint(context, n, group, errors);
+        });
+
+    for (std::map<std::string, int>::const_iterator i = results.begin(); i != results.end(); ++i) {
+        if (i->second < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
 int gfal_xrootd_bring_online(plugin_handle plugin_data,
     const char* url, time_t pintime, time_t timeout, char* token, size_t tsize, int async, GError** err)
 {
@@ -379,14 +457,10 @@ int gfal_xrootd_release_file(plugin_handle plugin_data,
     return ret;
 }
 
-int gfal_xrootd_abort_files(plugin_handle plugin_data,
+// Cancel the staging of files all served by the same endpoint
+static int gfal_xrootd_abort_files_endpoint(gfal2_context_t context,
     int nbfiles, const char* const* urls, const char* token, GError** err)
 {
-    if (nbfiles <= 0) {
-        return 1;
-    }
-    gfal2_context_t context = (gfal2_context_t)plugin_data;
-
     XrdCl::URL endpoint(prepare_url(context, urls[0]));
     endpoint.SetPath(std::string());
     XrdCl::FileSystem fs(endpoint);
@@ -415,3 +489,25 @@ int gfal_xrootd_abort_files(plugin_handle plugin_data,
     return 0;
 }
 
+
+int gfal_xrootd_abort_files(plugin_handle plugin_data,
+    int nbfiles, const char* const* urls, const char* token, GError** err)
+{
+    if (nbfiles <= 0) {
+        return 1;
+    }
+    gfal2_context_t context = (gfal2_context_t)plugin_data;
+
+    std::map<std::string, int> results = run_per_endpoint_token(context, nbfiles, urls, token, err,
+        [&](const std::string& endpoint, int n, const char* const* group, GError** errors,
+            const std::string& endpointToken) {
+            return gfal_xrootd_abort_files_endpoint(context, n, group, endpointToken.c_str(), errors);
+        });
+
+    for (std::map<std::string, int>::const_iterator i = results.begin(); i != results.end(); ++i) {
+        if (i->second < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) CERN 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <XrdCl/XrdClFileSystem.hh>
+
+// TRUE and FALSE are defined in Glib and xrootd headers
+#ifdef TRUE
+#undef TRUE
+#endif
+#ifdef FALSE
+#undef FALSE
+#endif
+
+#include <gfal_plugins_api.h>
+#include "gfal_xrootd_plugin_interface.h"
+#include "gfal_xrootd_plugin_utils.h"
+
+
+// Requests of a bulk operation, issued asynchronously with at most
+// window of them in flight per endpoint
+class BulkRequests
+{
+public:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::map<std::string, int> inflight;
+    int failures;
+
+    BulkRequests(): failures(0)
+    {
+    }
+
+    // Block until there is room for a new request towards host
+    void Acquire(const std::string& host, int window)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return inflight[host] < window; });
+        ++inflight[host];
+    }
+
+    void Release(const std::string& host, bool failed)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --inflight[host];
+        if (failed)
+            ++failures;
+        cv.notify_all();
+    }
+
+    // Block until all the requests have been answered
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] {
+            for (std::map<std::string, int>::const_iterator i = inflight.begin(); i != inflight.end(); ++i) {
+                if (i->second > 0)
+                    return false;
+            }
+            return true;
+        });
+    }
+};
+
+
+class BulkHandler: public XrdCl::ResponseHandler
+{
+protected:
+    BulkRequests& requests;
+    std::string host;
+    GError** error;
+
+    virtual void OnSuccess(XrdCl::AnyObject* response)
+    {
+    }
+
+    virtual const char* Description() = 0;
+
+public:
+    BulkHandler(BulkRequests& requests, const std::string& host, GError** error):
+        requests(requests), host(host), error(error)
+    {
+    }
+
+    void HandleResponse(XrdCl::XRootDStatus* status, XrdCl::AnyObject* response)
+    {
+        bool failed = !status->IsOK();
+        if (failed) {
+            gfal2_xrootd_set_error(error, xrootd_status_to_posix_errno(*status), __func__, "%s: %s",
+                Description(), status->ToStr().c_str());
+        }
+        else {
+            OnSuccess(response);
+        }
+        delete status;
+        delete response;
+
+        // Copy what is needed, as requests may be gone once released
+        BulkRequests& r = requests;
+        std::string h = host;
+        delete this;
+        r.Release(h, failed);
+    }
+};
+
+
+class BulkRmHandler: public BulkHandler
+{
+protected:
+    const char* Description()
+    {
+        return "Failed to delete file";
+    }
+
+public:
+    BulkRmHandler(BulkRequests& requests, const std::string& host, GError** error):
+        BulkHandler(requests, host, error)
+    {
+    }
+};
+
+
+class BulkStatHandler: public BulkHandler
+{
+private:
+    struct stat* buffer;
+
+protected:
+    void OnSuccess(XrdCl::AnyObject* response)
+    {
+        XrdCl::StatInfo* info = NULL;
+        if (response)
+            response->Get<XrdCl::StatInfo*>(info);
+        if (info)
+            stat_info_to_stat(*info, *buffer);
+    }
+
+    const char* Description()
+    {
+        return "Failed to stat file";
+    }
+
+public:
+    BulkStatHandler(BulkRequests& requests, const std::string& host, GError** error, struct stat* buffer):
+        BulkHandler(requests, host, error), buffer(buffer)
+    {
+    }
+};
+
+
+static int get_window(gfal2_context_t context)
+{
+    int window = gfal2_get_opt_integer_with_default(context, XROOTD_CONFIG_GROUP, XROOTD_BULK_WINDOW, 64);
+    return window > 0 ? window : 1;
+}
+
+
+int gfal_xrootd_unlink_listG(plugin_handle plugin_data, int nbfiles, const char* const* urls, GError** errors)
+{
+    gfal2_context_t context = (gfal2_context_t)plugin_data;
+    const int window = get_window(context);
+
+    FileSystemMap filesystems;
+    BulkRequests requests;
+
+    for (int i = 0; i < nbfiles; ++i) {
+        XrdCl::URL url(prepare_url(context, urls[i]));
+        const std::string host = url.GetHostId();
+        XrdCl::FileSystem& fs = get_filesystem(filesystems, url);
+
+        requests.Acquire(host, window);
+        BulkRmHandler* handler = new BulkRmHandler(requests, host, &errors[i]);
+        XrdCl::XRootDStatus status = fs.Rm(url.GetPathWithParams(), handler);
+        if (!status.IsOK()) {
+            gfal2_xrootd_set_error(&errors[i], xrootd_status_to_posix_errno(status), __func__,
+                "Failed to delete file: %s", status.ToStr().c_str());
+            delete handler;
+            requests.Release(host, true);
+        }
+    }
+
+    requests.Wait();
+    return requests.failures ? -1 : 0;
+}
+
+
+int gfal_xrootd_stat_listG(plugin_handle plugin_data, int nbfiles, const char* const* urls,
+    struct stat* buffers, GError** errors)
+{
+    gfal2_context_t context = (gfal2_context_t)plugin_data;
+    const int window = get_window(context);
+
+    FileSystemMap filesystems;
+    BulkRequests requests;
+
+    for (int i = 0; i < nbfiles; ++i) {
+        XrdCl::URL url(prepare_url(context, urls[i]));
+        const std::string host = url.GetHostId();
+        XrdCl::FileSystem& fs = get_filesystem(filesystems, url);
+
+        reset_stat(buffers[i]);
+        requests.Acquire(host, window);
+        BulkStatHandler* handler = new BulkStatHandler(requests, host, &errors[i], &buffers[i]);
+        XrdCl::XRootDStatus status = fs.Stat(url.GetPathWithParams(), handler);
+        if (!status.IsOK()) {
+            gfal2_xrootd_set_error(&errors[i], xrootd_status_to_posix_errno(status), __func__,
+                "Failed to stat file: %s", status.ToStr().c_str());
+            delete handler;
+            requests.Release(host, true);
+        }
+    }
+
+    requests.Wait();
+    return requests.failures ? -1 : 0;
+}
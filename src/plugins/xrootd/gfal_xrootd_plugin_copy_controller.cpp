@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) CERN 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "gfal_xrootd_plugin_copy_controller.h"
+
+// Below this relative change, the rate is considered not to have moved
+static const double RATE_TOLERANCE = 0.1;
+
+// Data a job should move per chunk, in seconds of its own rate
+static const double CHUNK_SECONDS = 0.25;
+
+const uint64_t CopyController::MIN_CHUNK_SIZE;
+const uint64_t CopyController::MAX_CHUNK_SIZE;
+const uint64_t CopyController::DEFAULT_CHUNK_SIZE;
+
+
+CopyController::CopyController(int minParallel, int maxParallel, int parallel, uint64_t targetRate):
+    minParallel(std::max(1, minParallel)), maxParallel(maxParallel), parallel(parallel),
+    targetRate(targetRate), chunkSize(DEFAULT_CHUNK_SIZE),
+    waveStart(0), rate(0), previousRate(0), direction(1)
+{
+    this->maxParallel = std::max(this->minParallel, this->maxParallel);
+    this->parallel = std::min(this->maxParallel, std::max(this->minParallel, this->parallel));
+}
+
+
+bool CopyController::IsAdaptive() const
+{
+    return minParallel != maxParallel;
+}
+
+
+int CopyController::GetParallel() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return parallel;
+}
+
+
+uint64_t CopyController::GetChunkSize() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return chunkSize;
+}
+
+
+uint64_t CopyController::GetRate() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return rate;
+}
+
+
+void CopyController::BeginWave(double now)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    waveStart = now;
+    jobs.clear();
+}
+
+
+void CopyController::JobProgress(int jobNum, uint64_t bytesProcessed, double now)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<int, JobTrace>::iterator i = jobs.find(jobNum);
+    if (i == jobs.end()) {
+        JobTrace trace = {bytesProcessed, now, now};
+        jobs[jobNum] = trace;
+    }
+    else {
+        i->second.bytes = std::max(i->second.bytes, bytesProcessed);
+        i->second.last = now;
+    }
+}
+
+
+void CopyController::EndWave(double now)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const double elapsed = now - waveStart;
+    uint64_t bytes = 0;
+    double jobRates = 0;
+    int timedJobs = 0;
+    for (std::map<int, JobTrace>::const_iterator i = jobs.begin(); i != jobs.end(); ++i) {
+        bytes += i->second.bytes;
+        if (i->second.last > i->second.first) {
+            jobRates += i->second.bytes / (i->second.last - i->second.first);
+            ++timedJobs;
+        }
+    }
+    if (elapsed <= 0 || bytes == 0) {
+        return;
+    }
+    rate = bytes / elapsed;
+
+    // Each chunk should take about the same time, whatever the speed of the link
+    if (timedJobs > 0) {
+        uint64_t size = MIN_CHUNK_SIZE;
+        while (size < MAX_CHUNK_SIZE && size * 2 <= (jobRates / timedJobs) * CHUNK_SECONDS) {
+            size *= 2;
+        }
+        chunkSize = size;
+    }
+
+    if (!IsAdaptive()) {
+        previousRate = rate;
+        return;
+    }
+
+    int step = std::max(1, parallel / 2);
+    if (targetRate > 0 && rate >= targetRate) {
+        // Fast enough, spare the server if there is a wide margin
+        if (rate > targetRate * (1 + 2 * RATE_TOLERANCE)) {
+            parallel -= std::max(1, parallel / 4);
+        }
+        direction = -1;
+    }
+    else if (previousRate == 0 || rate > previousRate * (1 + RATE_TOLERANCE)) {
+        // Keep going in the same direction while it pays off
+        if (previousRate == 0) {
+            direction = 1;
+        }
+        parallel += direction * step;
+    }
+    else if (rate < previousRate * (1 - RATE_TOLERANCE)) {
+        // The last move made things worse, undo it
+        direction = -direction;
+        parallel += direction * step;
+    }
+
+    parallel = std::min(maxParallel, std::max(minParallel, parallel));
+    previousRate = rate;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) CERN 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GFAL_XROOTD_PLUGIN_COPY_CONTROLLER_H_
+#define GFAL_XROOTD_PLUGIN_COPY_CONTROLLER_H_
+
+#include <map>
+#include <mutex>
+#include <stdint.h>
+
+/// Chooses how many copy jobs run concurrently, and the chunk size of each of them,
+/// from the throughput observed while they run.
+/// A bulk copy is run in waves: the controller is fed with the progress of the jobs
+/// of a wave, and adjusts the settings of the next one, climbing toward the
+/// parallelism that gives the highest aggregate rate, or the target rate if there is one.
+class CopyController
+{
+public:
+    static const uint64_t MIN_CHUNK_SIZE = 1 << 20;
+    static const uint64_t MAX_CHUNK_SIZE = 32 << 20;
+    static const uint64_t DEFAULT_CHUNK_SIZE = 8 << 20;
+
+    /// @param targetRate aggregate rate in bytes per second, 0 for as fast as possible
+    CopyController(int minParallel, int maxParallel, int parallel, uint64_t targetRate);
+
+    /// True if the parallelism is allowed to change
+    bool IsAdaptive() const;
+
+    int GetParallel() const;
+    uint64_t GetChunkSize() const;
+
+    /// Aggregate rate of the last wave, in bytes per second
+    uint64_t GetRate() const;
+
+    void BeginWave(double now);
+
+    /// Bytes processed so far by the job jobNum of the current wave
+    void JobProgress(int jobNum, uint64_t bytesProcessed, double now);
+
+    /// Adjust parallelism and chunk size for the next wave
+    void EndWave(double now);
+
+private:
+    struct JobTrace {
+        uint64_t bytes;
+        double first, last;
+    };
+
+    mutable std::mutex mutex;
+    int minParallel, maxParallel, parallel;
+    uint64_t targetRate;
+    uint64_t chunkSize;
+
+    double waveStart;
+    std::map<int, JobTrace> jobs;
+    uint64_t rate, previousRate;
+    int direction;
+};
+
+#endif /* GFAL_XROOTD_PLUGIN_COPY_CONTROLLER_H_ */
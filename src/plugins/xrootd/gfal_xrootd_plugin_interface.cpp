@@ -18,13 +18,17 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <condition_variable>
+#include <deque>
 #include <iostream>
 #include <mutex>
+#include <vector>
 #include <sys/stat.h>
 
 // This header provides all the required functions except chmod
 #include <XrdPosix/XrdPosixXrootd.hh>
+#include <XrdOuc/XrdOucIOVec.hh>
 
 // This header is required for chmod
 #include <XrdCl/XrdClFileSystem.hh>
@@ -132,6 +136,123 @@ ssize_t gfal_xrootd_writeG(plugin_handle handle, gfal_file_handle fd,
 }
 
 
+ssize_t gfal_xrootd_preadG(plugin_handle handle, gfal_file_handle fd, void *buff,
+        size_t count, off_t offset, GError ** err)
+{
+    int * fdesc = (int*) (gfal_file_handle_get_fdesc(fd));
+    if (!fdesc) {
+        gfal2_xrootd_set_error(err, errno, __func__, "Bad file handle");
+        return -1;
+    }
+    ssize_t l = XrdPosixXrootd::Pread(*fdesc, buff, count, offset);
+    if (l < 0) {
+        gfal2_xrootd_set_error(err, errno, __func__, "Failed while reading from file");
+        return -1;
+    }
+    return l;
+}
+
+
+ssize_t gfal_xrootd_pwriteG(plugin_handle handle, gfal_file_handle fd,
+        const void *buff, size_t count, off_t offset, GError ** err)
+{
+    int * fdesc = (int*) (gfal_file_handle_get_fdesc(fd));
+    if (!fdesc) {
+        gfal2_xrootd_set_error(err, errno, __func__, "Bad file handle");
+        return -1;
+    }
+    ssize_t l = XrdPosixXrootd::Pwrite(*fdesc, buff, count, offset);
+    if (l < 0) {
+        gfal2_xrootd_set_error(err, errno, __func__, "Failed while writing to file");
+        return -1;
+    }
+    return l;
+}
+
+// Limits of a single kXR_readv request
+static const int XROOTD_READV_MAX_CHUNKS = 1024;
+static const size_t XROOTD_READV_MAX_CHUNK_SIZE = 2097136;
+
+// Send the accumulated chunks as one kXR_readv
+static ssize_t gfal_xrootd_flush_readv(int fdesc, std::vector<XrdOucIOVec>& iov, GError ** err)
+{
+    if (iov.empty()) {
+        return 0;
+    }
+    ssize_t expected = 0;
+    for (std::vector<XrdOucIOVec>::const_iterator i = iov.begin(); i != iov.end(); ++i) {
+        expected += i->size;
+    }
+    ssize_t l = XrdPosixXrootd::VRead(fdesc, iov.data(), (int)iov.size());
+    if (l < 0) {
+        gfal2_xrootd_set_error(err, errno, __func__, "Failed while reading from file");
+        return -1;
+    }
+    if (l != expected) {
+        gfal2_xrootd_set_error(err, EINVAL, __func__, "Vectored read goes beyond the end of the file");
+        return -1;
+    }
+    iov.clear();
+    return l;
+}
+
+
+ssize_t gfal_xrootd_vector_readG(plugin_handle handle, gfal_file_handle fd,
+        const gfal2_read_chunk_t* chunks, int nchunks, GError ** err)
+{
+    int * fdesc = (int*) (gfal_file_handle_get_fdesc(fd));
+    if (!fdesc) {
+        gfal2_xrootd_set_error(err, errno, __func__, "Bad file handle");
+        return -1;
+    }
+
+    std::vector<XrdOucIOVec> iov;
+    iov.reserve(std::min(nchunks, XROOTD_READV_MAX_CHUNKS));
+    ssize_t total = 0;
+
+    for (int i = 0; i < nchunks; ++i) {
+        if (chunks[i].size == 0) {
+            continue;
+        }
+        // Chunks the protocol can not carry in a readv are read on their own
+        if (chunks[i].size > XROOTD_READV_MAX_CHUNK_SIZE) {
+            ssize_t l = XrdPosixXrootd::Pread(*fdesc, chunks[i].buffer, chunks[i].size, chunks[i].offset);
+            if (l < 0) {
+                gfal2_xrootd_set_error(err, errno, __func__, "Failed while reading from file");
+                return -1;
+            }
+            if ((size_t)l != chunks[i].size) {
+                gfal2_xrootd_set_error(err, EINVAL, __func__, "Chunk %d goes beyond the end of the file", i);
+                return -1;
+            }
+            total += l;
+            continue;
+        }
+
+        XrdOucIOVec v;
+        v.offset = chunks[i].offset;
+        v.size = (int)chunks[i].size;
+        v.info = 0;
+        v.data = (char*)chunks[i].buffer;
+        iov.push_back(v);
+
+        if (iov.size() == (size_t)XROOTD_READV_MAX_CHUNKS) {
+            ssize_t l = gfal_xrootd_flush_readv(*fdesc, iov, err);
+            if (l < 0) {
+                return -1;
+            }
+            total += l;
+        }
+    }
+
+    ssize_t l = gfal_xrootd_flush_readv(*fdesc, iov, err);
+    if (l < 0) {
+        return -1;
+    }
+    return total + l;
+}
+
+
 off_t gfal_xrootd_lseekG(plugin_handle handle, gfal_file_handle fd,
         off_t offset, int whence, GError **err)
 {
@@ -315,12 +436,72 @@ void StatInfo2Xattr(const XrdCl::StatInfo* stinfo,  char * buff)
 }
 
 // Callback class for directory listing
+// Asynchronous stats of the entries of a listing chunk that came without stat information
+struct ChunkStatBatch
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    int pending;
+    int errcode;
+    std::string errstr;
+
+    ChunkStatBatch(): pending(0), errcode(0)
+    {
+    }
+};
+
+
+class ChunkStatHandler: public XrdCl::ResponseHandler
+{
+private:
+    XrdCl::DirectoryList::ListEntry* entry;
+    ChunkStatBatch& batch;
+
+public:
+    ChunkStatHandler(XrdCl::DirectoryList::ListEntry* entry, ChunkStatBatch& batch): entry(entry), batch(batch)
+    {
+    }
+
+    void HandleResponse(XrdCl::XRootDStatus* status, XrdCl::AnyObject* response)
+    {
+        XrdCl::StatInfo* stinfo = NULL;
+        if (status->IsOK() && response) {
+            response->Get<XrdCl::StatInfo*>(stinfo);
+            if (stinfo) {
+                response->Set(stinfo, false);
+                entry->SetStatInfo(stinfo);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            if (!stinfo && batch.errcode == 0) {
+                batch.errcode = status->errNo ? status->errNo : EIO;
+                batch.errstr = status->ToString();
+            }
+            if (--batch.pending == 0)
+                batch.cv.notify_all();
+        }
+        delete status;
+        delete response;
+        delete this;
+    }
+};
+
+
+// Chunks are handed to readdir as soon as they arrive, and freed once consumed
 class DirListHandler: public XrdCl::ResponseHandler
 {
 private:
     XrdCl::URL url;
     XrdCl::FileSystem fs;
-    std::list<XrdCl::DirectoryList::ListEntry*> entries;
+    std::deque<XrdCl::DirectoryList*> chunks;
+
+    // Only accessed by the reader
+    XrdCl::DirectoryList* current;
+    size_t position;
+    bool currentStated;
+    int statErrcode;
+    std::string statErrstr;
 
     struct dirent dbuffer;
 
@@ -329,77 +510,122 @@ private:
     bool done;
 
 public:
+    // Error of the listing itself, protected by mutex once List() succeeded
     int errcode;
     std::string errstr;
 
-    DirListHandler(const XrdCl::URL& url): url(url), fs(url), done(false), errcode(0)
+    DirListHandler(const XrdCl::URL& url): url(url), fs(url), current(NULL), position(0),
+        currentStated(false), statErrcode(0), done(false), errcode(0)
     {
         memset(&dbuffer, 0, sizeof(dbuffer));
     }
 
+    ~DirListHandler()
+    {
+        // The listing may still be in flight
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return done; });
+        delete current;
+        for (std::deque<XrdCl::DirectoryList*>::iterator i = chunks.begin(); i != chunks.end(); ++i) {
+            delete *i;
+        }
+    }
+
     int List()
     {
-        XrdCl::XRootDStatus status = fs.DirList(url.GetPath(), XrdCl::DirListFlags::Stat, this);
+        XrdCl::XRootDStatus status = fs.DirList(url.GetPath(),
+            XrdCl::DirListFlags::Stat | XrdCl::DirListFlags::Chunked, this);
         if (!status.IsOK()) {
             errcode = status.code;
             errstr = status.ToString();
+            done = true;
             return -1;
         }
         return 0;
     }
 
-    // AFAIK, this is called only once
+    // Called once per chunk, with suContinue for all of them but the last one
     void HandleResponse(XrdCl::XRootDStatus* status, XrdCl::AnyObject* response)
     {
         std::lock_guard<std::mutex> lock(mutex);
         if (status->IsOK()) {
-            XrdCl::DirectoryList* list;
-            response->Get<XrdCl::DirectoryList*>(list);
+            XrdCl::DirectoryList* list = NULL;
+            if (response) {
+                response->Get<XrdCl::DirectoryList*>(list);
+                response->Set(list, false);
+            }
             if (list) {
-                XrdCl::DirectoryList::ConstIterator i;
-                for (i = list->Begin(); i != list->End(); ++i) {
-                    entries.push_back(*i);
-                }
+                chunks.push_back(list);
             }
         }
         else {
             errcode = status->code;
             errstr = status->ToString();
         }
-        done = true;
+        if (!status->IsOK() || status->code != XrdCl::suContinue) {
+            done = true;
+        }
+        delete status;
+        delete response;
         cv.notify_all();
     }
 
-    void StatInfo2Stat(const XrdCl::StatInfo* stinfo, struct stat* st)
+    // Stat concurrently all the entries of the current chunk without stat information
+    void StatCurrentChunk()
     {
-        st->st_size = stinfo->GetSize();
-        st->st_mtime = stinfo->GetModTime();
-        st->st_mode = 0;
-        if (stinfo->TestFlags(XrdCl::StatInfo::IsDir))
-            st->st_mode |= S_IFDIR;
-        if (stinfo->TestFlags(XrdCl::StatInfo::IsReadable))
-            st->st_mode |= (S_IRUSR | S_IRGRP | S_IROTH);
-        if (stinfo->TestFlags(XrdCl::StatInfo::IsWritable))
-            st->st_mode |= (S_IWUSR | S_IWGRP | S_IWOTH);
-        if (stinfo->TestFlags(XrdCl::StatInfo::XBitSet))
-            st->st_mode |= (S_IXUSR | S_IXGRP | S_IXOTH);
-    }
-
-    struct dirent* Get(struct stat* st = NULL)
+        ChunkStatBatch batch;
+        std::unique_lock<std::mutex> lock(batch.mutex);
+        for (size_t i = position; i < current->GetSize(); ++i) {
+            XrdCl::DirectoryList::ListEntry* entry = current->At(i);
+            if (entry->GetStatInfo() != NULL)
+                continue;
+            std::string fullPath = url.GetPath() + "/" + entry->GetName();
+            ChunkStatHandler* handler = new ChunkStatHandler(entry, batch);
+            XrdCl::XRootDStatus status = fs.Stat(fullPath, handler);
+            if (status.IsOK()) {
+                ++batch.pending;
+            }
+            else {
+                delete handler;
+                if (batch.errcode == 0) {
+                    batch.errcode = status.errNo ? status.errNo : EIO;
+                    batch.errstr = status.ToString();
+                }
+            }
+        }
+        batch.cv.wait(lock, [&batch] { return batch.pending == 0; });
+        currentStated = true;
+        statErrcode = batch.errcode;
+        statErrstr = batch.errstr;
+    }
+
+    // Next entry, or NULL at the end of the listing or on error, with err set to the errno.
+    // A failed stat is only reported for the entry it belongs to, the next call goes on
+    struct dirent* Get(struct stat* st, int& err, std::string& msg)
     {
-        if (!done) {
+        err = 0;
+        while (current == NULL || position >= current->GetSize()) {
+            delete current;
+            current = NULL;
+
             std::unique_lock<std::mutex> lock(mutex);
-            cv.wait_for(lock, std::chrono::seconds(60));
-            if (!done) {
+            cv.wait(lock, [this] { return done || !chunks.empty(); });
+            if (chunks.empty()) {
+                err = errcode;
+                msg = errstr;
                 return NULL;
             }
+            current = chunks.front();
+            chunks.pop_front();
+            position = 0;
+            currentStated = false;
         }
 
-        if (entries.empty())
-            return NULL;
-
-        XrdCl::DirectoryList::ListEntry* entry = entries.front();
-        entries.pop_front();
+        XrdCl::DirectoryList::ListEntry* entry = current->At(position);
+        if (st != NULL && entry->GetStatInfo() == NULL && !currentStated) {
+            StatCurrentChunk();
+        }
+        ++position;
 
         XrdCl::StatInfo* stinfo = entry->GetStatInfo();
 
@@ -412,25 +638,14 @@ public:
             dbuffer.d_type = DT_REG;
 
         if (st != NULL) {
-            if (stinfo != NULL) {
-                StatInfo2Stat(stinfo, st);
-            }
-            else {
-
-                stinfo = new XrdCl::StatInfo();
-                std::string fullPath = url.GetPath() + "/" + dbuffer.d_name;
-                XrdCl::XRootDStatus status = this->fs.Stat(fullPath, stinfo);
-                if (!status.IsOK()) {
-                    errcode = status.code;
-                    errstr = status.ToString();
-                    return NULL;
-                }
-                StatInfo2Stat(stinfo, st);
-                delete stinfo;
+            if (stinfo == NULL) {
+                err = statErrcode ? statErrcode : EIO;
+                msg = std::string("Failed to stat ") + dbuffer.d_name + ": " + statErrstr;
+                return NULL;
             }
+            stat_info_to_stat(*stinfo, *st);
         }
 
-        delete entry;
         return &dbuffer;
     }
 };
@@ -459,6 +674,7 @@ gfal_file_handle gfal_xrootd_opendirG(plugin_handle handle,
     if (handler->List() != 0) {
         gfal2_xrootd_set_error(err, handler->errcode, __func__, "Failed to open dir: %s",
                 handler->errstr.c_str());
+        delete handler;
         return NULL;
     }
 
@@ -474,10 +690,11 @@ struct dirent* gfal_xrootd_readdirG(plugin_handle plugin_data,
         gfal2_xrootd_set_error(err, errno, __func__, "Bad dir handle");
         return NULL;
     }
-    dirent* entry = handler->Get();
-    if (!entry && handler->errcode != 0) {
-        gfal2_xrootd_set_error(err, handler->errcode, __func__, "Failed reading directory: %s",
-                handler->errstr.c_str());
+    int errcode = 0;
+    std::string errstr;
+    dirent* entry = handler->Get(NULL, errcode, errstr);
+    if (!entry && errcode != 0) {
+        gfal2_xrootd_set_error(err, errcode, __func__, "Failed reading directory: %s", errstr.c_str());
         return NULL;
     }
     return entry;
@@ -492,10 +709,11 @@ struct dirent* gfal_xrootd_readdirppG(plugin_handle plugin_data,
         gfal2_xrootd_set_error(err, errno, __func__, "Bad dir handle");
         return NULL;
     }
-    dirent* entry = handler->Get(st);
-    if (!entry && handler->errcode != 0) {
-        gfal2_xrootd_set_error(err, handler->errcode, __func__, "Failed reading directory: %s",
-                handler->errstr.c_str());
+    int errcode = 0;
+    std::string errstr;
+    dirent* entry = handler->Get(st, errcode, errstr);
+    if (!entry && errcode != 0) {
+        gfal2_xrootd_set_error(err, errcode, __func__, "Failed reading directory: %s", errstr.c_str());
         return NULL;
     }
     return entry;
@@ -27,7 +27,12 @@
 #define XROOTD_DEFAULT_CHECKSUM "COPY_CHECKSUM_TYPE"
 #define XROOTD_CHECKSUM_MODE    "COPY_CHECKSUM_MODE"
 #define XROOTD_PARALLEL_COPIES  "PARALLEL_COPIES"
+#define XROOTD_PARALLEL_COPIES_MIN "PARALLEL_COPIES_MIN"
+#define XROOTD_PARALLEL_COPIES_MAX "PARALLEL_COPIES_MAX"
+#define XROOTD_COPY_TARGET_RATE "COPY_TARGET_RATE"
 #define XROOTD_NORMALIZE_PATH   "NORMALIZE_PATH"
+#define XROOTD_BULK_WINDOW      "BULK_WINDOW"
+#define XROOTD_SPACE_CACHE_TTL  "SPACE_CACHE_TTL"
 
 extern "C" {
 
@@ -40,6 +45,12 @@ ssize_t gfal_xrootd_readG(plugin_handle handle, gfal_file_handle fd, void *buff,
 
 ssize_t gfal_xrootd_writeG(plugin_handle handle, gfal_file_handle fd, const void *buff, size_t count, GError ** err);
 
+ssize_t gfal_xrootd_preadG(plugin_handle handle, gfal_file_handle fd, void *buff, size_t count, off_t offset, GError ** err);
+
+ssize_t gfal_xrootd_pwriteG(plugin_handle handle, gfal_file_handle fd, const void *buff, size_t count, off_t offset, GError ** err);
+
+ssize_t gfal_xrootd_vector_readG(plugin_handle handle, gfal_file_handle fd, const gfal2_read_chunk_t* chunks, int nchunks, GError ** err);
+
 off_t gfal_xrootd_lseekG(plugin_handle handle, gfal_file_handle fd, off_t offset, int whence, GError **err);
 
 int gfal_xrootd_closeG(plugin_handle handle, gfal_file_handle fd, GError ** err);
@@ -125,6 +136,11 @@ int gfal_xrootd_release_file_list(plugin_handle plugin_data,
 int gfal_xrootd_abort_files(plugin_handle plugin_data,
     int nbfiles, const char* const* urls, const char* token, GError** err);
 
+int gfal_xrootd_unlink_listG(plugin_handle plugin_data, int nbfiles, const char* const* urls, GError** errors);
+
+int gfal_xrootd_stat_listG(plugin_handle plugin_data, int nbfiles, const char* const* urls,
+    struct stat* buffers, GError** errors);
+
 int gfal_xrootd_archive_poll(plugin_handle plugin_data, const char* url, GError** err);
 
 int gfal_xrootd_archive_poll_list(plugin_handle plugin_data,
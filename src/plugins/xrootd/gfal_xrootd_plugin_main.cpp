@@ -23,12 +23,18 @@
 
 #include <gfal_plugins_api.h>
 #include "gfal_xrootd_plugin_interface.h"
+#include "gfal_xrootd_plugin_utils.h"
 #include <XrdPosix/XrdPosixXrootd.hh>
 
 extern "C" {
 
 gboolean gfal_xrootd_check_url(plugin_handle ch, const char* url,  plugin_mode mode, GError** err);
 
+static void gfal_xrootd_plugin_delete(plugin_handle handle)
+{
+    prepare_url_forget_context((gfal2_context_t) handle);
+}
+
 gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError** err)
 {
     static XrdPosixXrootd singleXroot;
@@ -42,6 +48,7 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError** err)
     xrootd_plugin.plugin_data = handle;
 
     xrootd_plugin.getName = &gfal_xrootd_getName;
+    xrootd_plugin.plugin_delete = &gfal_xrootd_plugin_delete;
     xrootd_plugin.check_plugin_url = &gfal_xrootd_check_url;
 
     xrootd_plugin.openG = &gfal_xrootd_openG;
@@ -52,13 +59,16 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError** err)
 
     xrootd_plugin.statG = &gfal_xrootd_statG;
     xrootd_plugin.lstatG = &gfal_xrootd_statG;
+    xrootd_plugin.stat_listG = &gfal_xrootd_stat_listG;
 
-    xrootd_plugin.preadG = NULL; // &gfal_xrootd_preadG;
-    xrootd_plugin.pwriteG = NULL; // &gfal_xrootd_pwriteG;
+    xrootd_plugin.preadG = &gfal_xrootd_preadG;
+    xrootd_plugin.pwriteG = &gfal_xrootd_pwriteG;
+    xrootd_plugin.vector_readG = &gfal_xrootd_vector_readG;
 
     xrootd_plugin.mkdirpG = &gfal_xrootd_mkdirpG;
     xrootd_plugin.chmodG = &gfal_xrootd_chmodG;
     xrootd_plugin.unlinkG = &gfal_xrootd_unlinkG;
+    xrootd_plugin.unlink_listG = &gfal_xrootd_unlink_listG;
     xrootd_plugin.rmdirG = &gfal_xrootd_rmdirG;
     xrootd_plugin.accessG = &gfal_xrootd_accessG;
     xrootd_plugin.renameG = &gfal_xrootd_renameG;
@@ -18,7 +18,10 @@
  * limitations under the License.
  */
 
+#include <limits>
+
 #include "gfal_xrootd_plugin_interface.h"
+#include "gfal_xrootd_plugin_space.h"
 #include "gfal_xrootd_plugin_utils.h"
 
 #include <XrdCl/XrdClFileSystem.hh>
@@ -26,16 +29,150 @@
 
 #include "space/gfal2_space.h"
 
-ssize_t gfal_xrootd_space_reporting(plugin_handle plugin_data, const char *url,
-    const char *key, void *buff, size_t s_buf, GError **err)
+
+const size_t SpaceReportCache::MAX_ENTRIES;
+
+
+SpaceReportCache::SpaceReportCache(Source source, Clock clock): source(source), clock(clock)
+{
+}
+
+
+time_t SpaceReportCache::Now() const
+{
+    return clock ? clock() : time(NULL);
+}
+
+
+bool SpaceReportCache::Expired(const Entry& entry, time_t now)
+{
+    return !entry.inFlight && (!entry.valid || entry.fetched + entry.ttl <= now);
+}
+
+
+void SpaceReportCache::DropExpired(time_t now)
+{
+    std::map<std::string, std::shared_ptr<Entry> >::iterator i = entries.begin();
+    while (i != entries.end()) {
+        if (Expired(*i->second, now)) {
+            entries.erase(i++);
+        }
+        else {
+            ++i;
+        }
+    }
+}
+
+
+XrdCl::XRootDStatus SpaceReportCache::Get(const std::string& url, time_t ttl, SpaceSample& sample)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // An expired entry is replaced, instead of waiting for the map to fill up
+    std::shared_ptr<Entry>& slot = entries[url];
+    if (!slot || Expired(*slot, Now())) {
+        slot = std::make_shared<Entry>();
+    }
+    std::shared_ptr<Entry> entry = slot;
+
+    if (entry->inFlight) {
+        cv.wait(lock, [&entry] { return !entry->inFlight; });
+        sample = entry->sample;
+        return entry->status;
+    }
+    if (entry->valid && entry->fetched + ttl > Now()) {
+        sample = entry->sample;
+        return XrdCl::XRootDStatus();
+    }
+
+    entry->inFlight = true;
+    lock.unlock();
+
+    SpaceSample fresh = SpaceSample();
+    XrdCl::XRootDStatus status = source(url, fresh);
+
+    lock.lock();
+    const time_t now = Now();
+    entry->inFlight = false;
+    entry->valid = status.IsOK();
+    entry->fetched = now;
+    entry->ttl = ttl;
+    entry->sample = fresh;
+    entry->status = status;
+    // The waiters hold their own reference, so an entry that is of no use
+    // to the next callers can go as soon as the query is done
+    if (!entry->valid || ttl <= 0) {
+        std::map<std::string, std::shared_ptr<Entry> >::iterator i = entries.find(url);
+        if (i != entries.end() && i->second == entry) {
+            entries.erase(i);
+        }
+    }
+    if (entries.size() > MAX_ENTRIES) {
+        DropExpired(now);
+    }
+    cv.notify_all();
+
+    sample = fresh;
+    return status;
+}
+
+
+void SpaceReportCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    DropExpired(std::numeric_limits<time_t>::max());
+}
+
+
+size_t SpaceReportCache::Size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+
+// All the space queries towards an endpoint go through the same FileSystem.
+// Never freed, as XrdCl may be gone by the time static objects are destroyed
+static std::mutex filesystems_mutex;
+static FileSystemMap* filesystems = new FileSystemMap();
+
+
+static XrdCl::XRootDStatus query_space_info(const std::string& url, SpaceSample& sample)
 {
-    std::string sanitizedUrl = prepare_url((gfal2_context_t) plugin_data, url);
-    XrdCl::FileSystem fs(sanitizedUrl);
+    XrdCl::URL xurl(url);
+    XrdCl::FileSystem* fs;
+    {
+        std::lock_guard<std::mutex> lock(filesystems_mutex);
+        fs = &get_filesystem(*filesystems, xurl);
+    }
+
     XrdCl::FileSystemUtils::SpaceInfo *space = NULL;
+    XrdCl::XRootDStatus status = XrdCl::FileSystemUtils::GetSpaceInfo(space, fs, xurl.GetPath());
+    if (!status.IsOK()) {
+        return status;
+    }
+
+    sample.used = space->GetUsed();
+    sample.free = space->GetFree();
+    sample.total = space->GetTotal();
+    sample.largestChunk = space->GetLargestFreeChunk();
+    delete space;
+    return status;
+}
+
 
-    XrdCl::URL xurl(sanitizedUrl);
+static SpaceReportCache space_cache(query_space_info);
 
-    XrdCl::XRootDStatus status = XrdCl::FileSystemUtils::GetSpaceInfo(space, &fs, xurl.GetPath());
+
+ssize_t gfal_xrootd_space_reporting(plugin_handle plugin_data, const char *url,
+    const char *key, void *buff, size_t s_buf, GError **err)
+{
+    gfal2_context_t context = (gfal2_context_t) plugin_data;
+    std::string sanitizedUrl = prepare_url(context, url);
+    int ttl = gfal2_get_opt_integer_with_default(context, XROOTD_CONFIG_GROUP, XROOTD_SPACE_CACHE_TTL, 60);
+
+    SpaceSample sample;
+    XrdCl::XRootDStatus status = space_cache.Get(sanitizedUrl, ttl > 0 ? ttl : 0, sample);
     if (!status.IsOK()) {
         gfal2_set_error(err, xrootd_domain, EIO, __func__, "Failed to get the space information: %s",
             status.GetErrorMessage().c_str());
@@ -43,14 +180,10 @@ ssize_t gfal_xrootd_space_reporting(plugin_handle plugin_data, const char *url,
     }
 
     struct space_report report = {0};
-    report.used = space->GetUsed();
-    report.free = space->GetFree();
-    report.total = space->GetTotal();
-
-    uint64_t chunk = space->GetLargestFreeChunk();
-    report.largest_chunk = &chunk;
-
-    delete space;
+    report.used = sample.used;
+    report.free = sample.free;
+    report.total = sample.total;
+    report.largest_chunk = &sample.largestChunk;
 
     return gfal2_space_generate_json(&report, (char*)buff, s_buf);
 }
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) CERN 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GFAL_XROOTD_PLUGIN_SPACE_H_
+#define GFAL_XROOTD_PLUGIN_SPACE_H_
+
+#include <condition_variable>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+
+#include <XrdCl/XrdClXRootDResponses.hh>
+
+/// Space information of a path
+struct SpaceSample {
+    uint64_t used, free, total, largestChunk;
+};
+
+/// Keeps the space information of each url for a while, so repeated queries do not
+/// fan out again to all the data servers. Concurrent queries for the same url
+/// share a single request.
+class SpaceReportCache
+{
+public:
+    typedef std::function<XrdCl::XRootDStatus (const std::string& url, SpaceSample& sample)> Source;
+    typedef std::function<time_t ()> Clock;
+
+    /// Entries beyond this are dropped once expired
+    static const size_t MAX_ENTRIES = 1024;
+
+    SpaceReportCache(Source source, Clock clock = Clock());
+
+    /// Get the space information of url, querying source if there is nothing
+    /// newer than ttl seconds (0 always queries, and does not keep the result).
+    /// Failures are shared with the concurrent callers, but not cached.
+    XrdCl::XRootDStatus Get(const std::string& url, time_t ttl, SpaceSample& sample);
+
+    void Clear();
+
+    /// Number of entries, including the queries in flight
+    size_t Size();
+
+private:
+    struct Entry {
+        bool inFlight;
+        bool valid;
+        time_t fetched, ttl;
+        SpaceSample sample;
+        XrdCl::XRootDStatus status;
+
+        Entry(): inFlight(false), valid(false), fetched(0), ttl(0), sample()
+        {
+        }
+    };
+
+    Source source;
+    Clock clock;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::map<std::string, std::shared_ptr<Entry> > entries;
+
+    time_t Now() const;
+    static bool Expired(const Entry& entry, time_t now);
+    void DropExpired(time_t now);
+};
+
+#endif /* GFAL_XROOTD_PLUGIN_SPACE_H_ */
@@ -19,10 +19,15 @@
  */
 
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <errno.h>
 #include <fcntl.h>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 #include <XProtocol/XProtocol.hh>
 #include <XrdCl/XrdClFileSystem.hh>
 
@@ -79,6 +84,24 @@ void reset_stat(struct stat& st)
 }
 
 
+void stat_info_to_stat(const XrdCl::StatInfo& info, struct stat& st)
+{
+    reset_stat(st);
+    st.st_size = info.GetSize();
+    st.st_mtime = info.GetModTime();
+    if (info.TestFlags(XrdCl::StatInfo::IsDir))
+        st.st_mode |= S_IFDIR;
+    else
+        st.st_mode |= S_IFREG;
+    if (info.TestFlags(XrdCl::StatInfo::IsReadable))
+        st.st_mode |= (S_IRUSR | S_IRGRP | S_IROTH);
+    if (info.TestFlags(XrdCl::StatInfo::IsWritable))
+        st.st_mode |= (S_IWUSR | S_IWGRP | S_IWOTH);
+    if (info.TestFlags(XrdCl::StatInfo::XBitSet))
+        st.st_mode |= (S_IXUSR | S_IXGRP | S_IXOTH);
+}
+
+
 static std::string query_args(gfal2_context_t context, const char *url)
 {
     bool prev_args = false;
@@ -188,7 +211,7 @@ static void normalize_path(gfal2_uri *uri)
 }
 
 
-std::string prepare_url(gfal2_context_t context, const char *url)
+static std::string sanitize_url(gfal2_context_t context, const char *url, bool normalize)
 {
     GError *error = NULL;
     gfal2_uri *uri = gfal2_parse_uri(url, &error);
@@ -197,8 +220,6 @@ std::string prepare_url(gfal2_context_t context, const char *url)
         return url;
     }
 
-    gboolean normalize = gfal2_get_opt_boolean_with_default(context,
-        XROOTD_CONFIG_GROUP, XROOTD_NORMALIZE_PATH, TRUE);
     if (normalize) {
         normalize_path(uri);
     }
@@ -216,6 +237,123 @@ std::string prepare_url(gfal2_context_t context, const char *url)
 }
 
 
+/**
+ * True if sanitize_url would return url unchanged: nothing to decode, no query to extend
+ * and, if normalizing, a path that already starts with three slashes
+ */
+static bool is_sanitized_url(const char *url, bool normalize)
+{
+    if (strpbrk(url, "?#%") != NULL) {
+        return false;
+    }
+    const char *authority = strstr(url, "://");
+    if (authority == NULL || authority == url) {
+        return false;
+    }
+    authority += 3;
+    const char *path = strchr(authority, '/');
+    if (path == NULL || path == authority) {
+        return false;
+    }
+    // The port is re-written from its numeric value
+    for (const char *p = authority; p < path; ++p) {
+        if (*p == ':' && (p[1] == '0' || p[1] == '/')) {
+            return false;
+        }
+    }
+    return normalize ? strncmp(path, "///", 3) == 0 : true;
+}
+
+
+static void has_x509_cred(const char *url_prefix, const gfal2_cred_t *cred, void *user_data)
+{
+    if (strcmp(cred->type, GFAL_CRED_X509_CERT) == 0 || strcmp(cred->type, GFAL_CRED_X509_KEY) == 0) {
+        *static_cast<bool*>(user_data) = true;
+    }
+}
+
+
+// Sanitized urls of a context, valid as long as its settings do not change
+struct SanitizedUrlCache {
+    guint serial;
+    bool normalize;
+    // No credential nor XRD. key will be added to the urls
+    bool emptyQuery;
+    std::unordered_map<std::string, std::string> urls;
+};
+
+static const size_t SANITIZED_URL_CACHE_MAX = 4096;
+static std::mutex sanitized_url_mutex;
+static std::map<gfal2_context_t, SanitizedUrlCache> sanitized_url_cache;
+
+
+static void refresh_sanitized_url_cache(gfal2_context_t context, SanitizedUrlCache& cache, guint serial)
+{
+    cache.serial = serial;
+    cache.urls.clear();
+    cache.normalize = gfal2_get_opt_boolean_with_default(context,
+        XROOTD_CONFIG_GROUP, XROOTD_NORMALIZE_PATH, TRUE);
+
+    bool x509 = false;
+    gfal2_cred_foreach(context, has_x509_cred, &x509);
+    if (!x509) {
+        gchar *cert = gfal2_get_opt_string_with_default(context, "X509", "CERT", NULL);
+        gchar *key = gfal2_get_opt_string_with_default(context, "X509", "KEY", NULL);
+        x509 = (cert != NULL || key != NULL);
+        g_free(cert);
+        g_free(key);
+    }
+    cache.emptyQuery = !x509 && query_args(context, "").empty();
+}
+
+
+std::string prepare_url(gfal2_context_t context, const char *url)
+{
+    const guint serial = gfal2_get_opt_serial(context);
+    bool normalize;
+    {
+        std::lock_guard<std::mutex> lock(sanitized_url_mutex);
+        std::map<gfal2_context_t, SanitizedUrlCache>::iterator i = sanitized_url_cache.find(context);
+        if (i == sanitized_url_cache.end()) {
+            i = sanitized_url_cache.insert(std::make_pair(context, SanitizedUrlCache())).first;
+            refresh_sanitized_url_cache(context, i->second, serial);
+        }
+        else if (i->second.serial != serial) {
+            refresh_sanitized_url_cache(context, i->second, serial);
+        }
+        SanitizedUrlCache& cache = i->second;
+
+        if (cache.emptyQuery && is_sanitized_url(url, cache.normalize)) {
+            return url;
+        }
+        std::unordered_map<std::string, std::string>::const_iterator cached = cache.urls.find(url);
+        if (cached != cache.urls.end()) {
+            return cached->second;
+        }
+        normalize = cache.normalize;
+    }
+
+    std::string sanitized = sanitize_url(context, url, normalize);
+
+    std::lock_guard<std::mutex> lock(sanitized_url_mutex);
+    std::map<gfal2_context_t, SanitizedUrlCache>::iterator i = sanitized_url_cache.find(context);
+    if (i != sanitized_url_cache.end() && i->second.serial == serial) {
+        if (i->second.urls.size() >= SANITIZED_URL_CACHE_MAX) {
+            i->second.urls.clear();
+        }
+        i->second.urls[url] = sanitized;
+    }
+    return sanitized;
+}
+
+
+void prepare_url_forget_context(gfal2_context_t context)
+{
+    std::lock_guard<std::mutex> lock(sanitized_url_mutex);
+    sanitized_url_cache.erase(context);
+}
+
+
 std::string predefined_checksum_type_to_lower(const std::string& type)
 {
     std::string lowerForm(type);
@@ -407,3 +545,125 @@ void copy_to_cstring(char* dest, size_t dest_size, const char* source, size_t so
         dest[dest_size - 1] = '\0';
     }
 }
+
+
+XrdCl::FileSystem& get_filesystem(FileSystemMap& filesystems, const XrdCl::URL& url)
+{
+    const std::string host = url.GetHostId();
+    FileSystemMap::iterator i = filesystems.find(host);
+    if (i == filesystems.end()) {
+        XrdCl::URL endpoint(url);
+        endpoint.SetPath(std::string());
+        i = filesystems.insert(std::make_pair(host, std::make_shared<XrdCl::FileSystem>(endpoint))).first;
+    }
+    return *i->second;
+}
+
+
+std::map<std::string, std::vector<int> > group_by_endpoint(gfal2_context_t context, int nbfiles,
+    const char* const* urls)
+{
+    std::map<std::string, std::vector<int> > groups;
+    for (int i = 0; i < nbfiles; ++i) {
+        XrdCl::URL url(prepare_url(context, urls[i]));
+        groups[url.GetHostId()].push_back(i);
+    }
+    return groups;
+}
+
+
+// Combined tokens are "endpoint=token" pairs separated by ';'
+std::string join_endpoint_tokens(const std::map<std::string, std::string>& tokens)
+{
+    if (tokens.size() == 1) {
+        return tokens.begin()->second;
+    }
+    std::string joined;
+    for (std::map<std::string, std::string>::const_iterator i = tokens.begin(); i != tokens.end(); ++i) {
+        if (!joined.empty()) {
+            joined += ';';
+        }
+        joined += i->first + '=' + i->second;
+    }
+    return joined;
+}
+
+
+std::string get_endpoint_token(const std::string& token, const std::string& endpoint)
+{
+    // A combined token always has several endpoints
+    if (token.find(';') == std::string::npos) {
+        return token;
+    }
+    size_t start = 0;
+    while (start <= token.size()) {
+        size_t end = token.find(';', start);
+        if (end == std::string::npos) {
+            end = token.size();
+        }
+        std::string pair = token.substr(start, end - start);
+        size_t eq = pair.find('=');
+        if (eq != std::string::npos && pair.compare(0, eq, endpoint) == 0) {
+            return pair.substr(eq + 1);
+        }
+        start = end + 1;
+    }
+    return std::string();
+}
+
+
+// A failed request is recorded as '!' followed by its errno
+std::string failed_endpoint_token(int errcode)
+{
+    return "!" + std::to_string(errcode);
+}
+
+
+bool is_endpoint_token_valid(const std::string& endpointToken)
+{
+    return !endpointToken.empty() && endpointToken[0] != '!';
+}
+
+
+void set_endpoint_token_errors(const std::string& endpoint, const std::string& endpointToken,
+    int nbfiles, GError** errors)
+{
+    for (int i = 0; i < nbfiles; ++i) {
+        if (endpointToken.empty()) {
+            gfal2_set_error(&errors[i], xrootd_domain, EINVAL, __func__,
+                "The token has no request for %s", endpoint.c_str());
+        }
+        else {
+            int errcode = atoi(endpointToken.c_str() + 1);
+            if (errcode <= 0) {
+                errcode = EIO;
+            }
+            gfal2_set_error(&errors[i], xrootd_domain, errcode, __func__,
+                "The request to %s failed when it was submitted: %s", endpoint.c_str(), strerror(errcode));
+        }
+    }
+}
+
+
+int poll_result_from_errors(int nbfiles, GError** errors)
+{
+    int done = 0, failed = 0;
+    for (int i = 0; i < nbfiles; ++i) {
+        if (errors[i] == NULL) {
+            ++done;
+        }
+        else if (errors[i]->code != EAGAIN) {
+            ++failed;
+        }
+    }
+    if (done == nbfiles) {
+        return 1;
+    }
+    if (failed == nbfiles) {
+        return -1;
+    }
+    if (done + failed == nbfiles) {
+        return 2;
+    }
+    return 0;
+}
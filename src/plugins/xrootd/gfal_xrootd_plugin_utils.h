@@ -25,7 +25,13 @@
 
 #include <gfal_api.h>
 #include <json.h>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
+#include <errno.h>
 #include <sys/stat.h>
 
 extern GQuark xrootd_domain;
@@ -36,10 +42,16 @@ XrdCl::Access::Mode file_mode_to_xrdcl_access( mode_t mode );
 /// Initialize all stat fields to zero
 void reset_stat(struct stat& st);
 
+/// Fill a stat structure from an XrdCl::StatInfo
+void stat_info_to_stat(const XrdCl::StatInfo& info, struct stat& st);
+
 /// Return the same URL, but making sure the path is always relative
 /// and adding the user credentials appended as keywords
 std::string prepare_url(gfal2_context_t context, const char *url);
 
+/// Drop the urls prepared for the given context
+void prepare_url_forget_context(gfal2_context_t context);
+
 /// If the checksum type is one of the predefined ones, always lowercase
 /// @note adler32, crc32, md5
 std::string predefined_checksum_type_to_lower(const std::string& type);
@@ -64,4 +76,134 @@ void gfal2_xrootd_poll_set_error(GError **err, int errcode, const char *func, co
 /// Copy contents of source buffer to dest buffer and always terminate dest buffer with null terminator
 void copy_to_cstring(char* dest, size_t dest_size, const char* source, size_t source_size);
 
+/// One FileSystem per endpoint (host id), shared by the requests sent to it
+typedef std::map<std::string, std::shared_ptr<XrdCl::FileSystem> > FileSystemMap;
+
+/// Return the FileSystem of the endpoint of url, creating it if needed
+XrdCl::FileSystem& get_filesystem(FileSystemMap& filesystems, const XrdCl::URL& url);
+
+/// Group the urls by endpoint (host id), each group holding the indexes of its urls in order
+std::map<std::string, std::vector<int> > group_by_endpoint(gfal2_context_t context, int nbfiles,
+    const char* const* urls);
+
+/// Combine the tokens of the requests sent to several endpoints into one token
+/// @note a single endpoint keeps its token as it is
+std::string join_endpoint_tokens(const std::map<std::string, std::string>& tokens);
+
+/// Extract from a token built by join_endpoint_tokens the one of the given endpoint
+/// @return the token itself if it is not a combined one, an empty string if the endpoint is not there
+std::string get_endpoint_token(const std::string& token, const std::string& endpoint);
+
+/// Token recorded for an endpoint whose request failed with errcode,
+/// so the files of that endpoint keep their error when polled
+std::string failed_endpoint_token(int errcode);
+
+/// @return true if endpointToken identifies a request accepted by its endpoint
+bool is_endpoint_token_valid(const std::string& endpointToken);
+
+/// Set the errors of the files of an endpoint without an accepted request:
+/// the errno its request failed with, or EINVAL if the token does not know the endpoint
+void set_endpoint_token_errors(const std::string& endpoint, const std::string& endpointToken,
+    int nbfiles, GError** errors);
+
+/// Combine the per-file outcome of a poll: 1 if all are done, -1 if all failed,
+/// 2 if they are all either done or failed, 0 if some are still pending (EAGAIN)
+int poll_result_from_errors(int nbfiles, GError** errors);
+
+/// Call func(endpoint, nbfiles, urls, errors) once per endpoint, concurrently, with the
+/// urls of that endpoint only. Per-file errors are scattered back into errors.
+/// @return the value returned by func for each endpoint
+template <typename Func>
+std::map<std::string, int> run_per_endpoint(gfal2_context_t context, int nbfiles, const char* const* urls,
+    GError** errors, Func func)
+{
+    std::map<std::string, std::vector<int> > groups = group_by_endpoint(context, nbfiles, urls);
+    std::vector<std::string> endpoints;
+    std::vector<std::vector<const char*> > groupUrls(groups.size());
+    std::vector<std::vector<GError*> > groupErrors(groups.size());
+
+    size_t g = 0;
+    for (std::map<std::string, std::vector<int> >::const_iterator i = groups.begin(); i != groups.end(); ++i, ++g) {
+        endpoints.push_back(i->first);
+        for (std::vector<int>::const_iterator j = i->second.begin(); j != i->second.end(); ++j) {
+            groupUrls[g].push_back(urls[*j]);
+        }
+        groupErrors[g].resize(i->second.size(), NULL);
+    }
+
+    std::map<std::string, int> results;
+    if (groups.size() == 1) {
+        results[endpoints[0]] = func(endpoints[0], (int)groupUrls[0].size(), groupUrls[0].data(),
+            groupErrors[0].data());
+    }
+    else {
+        std::vector<std::future<int> > futures;
+        for (g = 0; g < groups.size(); ++g) {
+            futures.push_back(std::async(std::launch::async, [&, g]() {
+                return func(endpoints[g], (int)groupUrls[g].size(), groupUrls[g].data(), groupErrors[g].data());
+            }));
+        }
+        for (g = 0; g < groups.size(); ++g) {
+            results[endpoints[g]] = futures[g].get();
+        }
+    }
+
+    g = 0;
+    for (std::map<std::string, std::vector<int> >::const_iterator i = groups.begin(); i != groups.end(); ++i, ++g) {
+        for (size_t j = 0; j < i->second.size(); ++j) {
+            errors[i->second[j]] = groupErrors[g][j];
+        }
+    }
+    return results;
+}
+
+/// Send one request per endpoint with submit(endpoint, nbfiles, urls, errors, token), and combine
+/// their tokens. Endpoints whose request failed are recorded as such in the combined token.
+/// @return the combined token, empty if every request failed
+template <typename Func>
+std::string submit_per_endpoint(gfal2_context_t context, int nbfiles, const char* const* urls,
+    GError** errors, Func submit)
+{
+    std::mutex mutex;
+    std::map<std::string, std::string> tokens;
+    bool accepted = false;
+
+    run_per_endpoint(context, nbfiles, urls, errors,
+        [&](const std::string& endpoint, int n, const char* const* group, GError** groupErrors) {
+            std::string token;
+            int ret = submit(endpoint, n, group, groupErrors, token);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ret == 0) {
+                tokens[endpoint] = token;
+                accepted = true;
+            }
+            else {
+                tokens[endpoint] = failed_endpoint_token((n > 0 && groupErrors[0]) ? groupErrors[0]->code : EIO);
+            }
+            return ret;
+        });
+
+    if (!accepted) {
+        return std::string();
+    }
+    return join_endpoint_tokens(tokens);
+}
+
+/// Call func(endpoint, nbfiles, urls, errors, endpointToken) for each endpoint with an accepted
+/// request in token. The files of the other endpoints get the error their request failed with.
+template <typename Func>
+std::map<std::string, int> run_per_endpoint_token(gfal2_context_t context, int nbfiles, const char* const* urls,
+    const std::string& token, GError** errors, Func func)
+{
+    return run_per_endpoint(context, nbfiles, urls, errors,
+        [&](const std::string& endpoint, int n, const char* const* group, GError** groupErrors) {
+            std::string endpointToken = get_endpoint_token(token, endpoint);
+            if (!is_endpoint_token_valid(endpointToken)) {
+                set_endpoint_token_errors(endpoint, endpointToken, n, groupErrors);
+                return -1;
+            }
+            return func(endpoint, n, group, groupErrors, endpointToken);
+        });
+}
+
 #endif /* GFAL_XROOTD_PLUGIN_UTILS_H_ */
@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#include "checksums.h"
+#include "checksum_kernels.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define GFAL2_HAVE_SSE42_KERNELS 1
+#include <nmmintrin.h>
+#endif
+
+
+static void checksum_to_hex(const unsigned char* bytes, size_t n, char* hex)
+{
+    static const char hex_str[] = "0123456789abcdef";
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        hex[i * 2] = hex_str[(bytes[i] >> 4) & 0x0f];
+        hex[i * 2 + 1] = hex_str[bytes[i] & 0x0f];
+    }
+    hex[n * 2] = '\0';
+}
+
+// ----------------------------------------------------------------------------------------------------
+// md5
+// TODO: this scalar implementation tops out around 500 MB/s, and is now the slowest kernel.
+// A single stream can not be vectorized, a faster one needs either a multi-buffer kernel
+// hashing several files at once, or an optimized implementation from a crypto library.
+
+static void md5_kernel_init(void* ctx)
+{
+    gfal2_md5_init((GFAL_MD5_CTX*)ctx);
+}
+
+
+static void md5_kernel_update(void* ctx, const void* data, size_t size)
+{
+    gfal2_md5_update((GFAL_MD5_CTX*)ctx, data, (unsigned long)size);
+}
+
+
+static int md5_kernel_final(void* ctx, char* hex, size_t s_hex)
+{
+    unsigned char digest[16];
+    if (s_hex < sizeof(digest) * 2 + 1)
+        return -1;
+    gfal2_md5_final(digest, (GFAL_MD5_CTX*)ctx);
+    checksum_to_hex(digest, sizeof(digest), hex);
+    return 0;
+}
+
+// ----------------------------------------------------------------------------------------------------
+// crc32c (Castagnoli), reflected polynomial 0x82F63B78
+
+static uint32_t crc32c_table[8][256];
+static pthread_once_t crc32c_table_once = PTHREAD_ONCE_INIT;
+
+
+static void crc32c_init_table(void)
+{
+    uint32_t i, j;
+    for (i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (j = 0; j < 8; ++j)
+            crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+        crc32c_table[0][i] = crc;
+    }
+    for (i = 0; i < 256; ++i) {
+        for (j = 1; j < 8; ++j)
+            crc32c_table[j][i] = (crc32c_table[j - 1][i] >> 8) ^ crc32c_table[0][crc32c_table[j - 1][i] & 0xff];
+    }
+}
+
+
+static void crc32c_kernel_init(void* ctx)
+{
+    pthread_once(&crc32c_table_once, crc32c_init_table);
+    *(uint32_t*)ctx = 0xFFFFFFFF;
+}
+
+
+// Slicing by 8
+static void crc32c_generic_update(void* ctx, const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    uint32_t crc = *(uint32_t*)ctx;
+
+    while (size && ((uintptr_t)p & 7)) {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xff];
+        --size;
+    }
+    while (size >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        lo = __builtin_bswap32(lo);
+        hi = __builtin_bswap32(hi);
+#endif
+        lo ^= crc;
+        crc = crc32c_table[7][lo & 0xff] ^ crc32c_table[6][(lo >> 8) & 0xff] ^
+              crc32c_table[5][(lo >> 16) & 0xff] ^ crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][hi & 0xff] ^ crc32c_table[2][(hi >> 8) & 0xff] ^
+              crc32c_table[1][(hi >> 16) & 0xff] ^ crc32c_table[0][hi >> 24];
+        p += 8;
+        size -= 8;
+    }
+    while (size--) {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xff];
+    }
+
+    *(uint32_t*)ctx = crc;
+}
+
+
+static int crc32c_kernel_final(void* ctx, char* hex, size_t s_hex)
+{
+    const uint32_t crc = *(uint32_t*)ctx ^ 0xFFFFFFFF;
+    const unsigned char bytes[4] = {crc >> 24, (crc >> 16) & 0xff, (crc >> 8) & 0xff, crc & 0xff};
+    if (s_hex < 9)
+        return -1;
+    checksum_to_hex(bytes, sizeof(bytes), hex);
+    return 0;
+}
+
+
+#ifdef GFAL2_HAVE_SSE42_KERNELS
+
+static int crc32c_sse42_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+}
+
+
+__attribute__((target("sse4.2")))
+static void crc32c_sse42_update(void* ctx, const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t crc = *(uint32_t*)ctx;
+
+    while (size && ((uintptr_t)p & 7)) {
+        crc = _mm_crc32_u8((uint32_t)crc, *p++);
+        --size;
+    }
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc = _mm_crc32_u64(crc, word);
+        p += 8;
+        size -= 8;
+    }
+    while (size--) {
+        crc = _mm_crc32_u8((uint32_t)crc, *p++);
+    }
+
+    *(uint32_t*)ctx = (uint32_t)crc;
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+// sha256 (FIPS 180-4)
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char buffer[64];
+    size_t used;
+} sha256_ctx_t;
+
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+
+static void sha256_transform(sha256_ctx_t* ctx, const unsigned char* block)
+{
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h;
+    int i;
+
+    for (i = 0; i < 16; ++i) {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+    }
+    for (i = 16; i < 64; ++i) {
+        uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    a = ctx->state[0]; b = ctx->state[1]; c = ctx->state[2]; d = ctx->state[3];
+    e = ctx->state[4]; f = ctx->state[5]; g = ctx->state[6]; h = ctx->state[7];
+
+    for (i = 0; i < 64; ++i) {
+        uint32_t s1 = ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+        uint32_t s0 = ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    ctx->state[0] += a; ctx->state[1] += b; ctx->state[2] += c; ctx->state[3] += d;
+    ctx->state[4] += e; ctx->state[5] += f; ctx->state[6] += g; ctx->state[7] += h;
+}
+
+
+static void sha256_kernel_init(void* ctx)
+{
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    sha256_ctx_t* sha = (sha256_ctx_t*)ctx;
+    memcpy(sha->state, initial, sizeof(initial));
+    sha->length = 0;
+    sha->used = 0;
+}
+
+
+static void sha256_kernel_update(void* ctx, const void* data, size_t size)
+{
+    sha256_ctx_t* sha = (sha256_ctx_t*)ctx;
+    const unsigned char* p = (const unsigned char*)data;
+
+    sha->length += size;
+    if (sha->used) {
+        size_t fill = sizeof(sha->buffer) - sha->used;
+        if (size < fill) {
+            memcpy(sha->buffer + sha->used, p, size);
+            sha->used += size;
+            return;
+        }
+        memcpy(sha->buffer + sha->used, p, fill);
+        sha256_transform(sha, sha->buffer);
+        p += fill;
+        size -= fill;
+        sha->used = 0;
+    }
+    while (size >= 64) {
+        sha256_transform(sha, p);
+        p += 64;
+        size -= 64;
+    }
+    memcpy(sha->buffer, p, size);
+    sha->used = size;
+}
+
+
+static int sha256_kernel_final(void* ctx, char* hex, size_t s_hex)
+{
+    sha256_ctx_t* sha = (sha256_ctx_t*)ctx;
+    unsigned char digest[32];
+    int i;
+
+    if (s_hex < sizeof(digest) * 2 + 1)
+        return -1;
+
+    const uint64_t bits = sha->length * 8;
+    sha->buffer[sha->used++] = 0x80;
+    if (sha->used > 56) {
+        memset(sha->buffer + sha->used, 0, 64 - sha->used);
+        sha256_transform(sha, sha->buffer);
+        sha->used = 0;
+    }
+    memset(sha->buffer + sha->used, 0, 56 - sha->used);
+    for (i = 0; i < 8; ++i)
+        sha->buffer[56 + i] = (unsigned char)(bits >> (56 - i * 8));
+    sha256_transform(sha, sha->buffer);
+
+    for (i = 0; i < 8; ++i) {
+        digest[i * 4] = (unsigned char)(sha->state[i] >> 24);
+        digest[i * 4 + 1] = (unsigned char)(sha->state[i] >> 16);
+        digest[i * 4 + 2] = (unsigned char)(sha->state[i] >> 8);
+        digest[i * 4 + 3] = (unsigned char)(sha->state[i]);
+    }
+    checksum_to_hex(digest, sizeof(digest), hex);
+    return 0;
+}
+
+// ----------------------------------------------------------------------------------------------------
+// Registry
+
+static const gfal2_checksum_kernel_t builtin_kernels[] = {
+#ifdef GFAL2_HAVE_SSE42_KERNELS
+    {"crc32c", "sse4.2", sizeof(uint32_t), crc32c_sse42_supported,
+        crc32c_kernel_init, crc32c_sse42_update, crc32c_kernel_final},
+#endif
+    {"crc32c", "generic", sizeof(uint32_t), NULL,
+        crc32c_kernel_init, crc32c_generic_update, crc32c_kernel_final},
+    {"md5", "generic", sizeof(GFAL_MD5_CTX), NULL,
+        md5_kernel_init, md5_kernel_update, md5_kernel_final},
+    {"sha256", "generic", sizeof(sha256_ctx_t), NULL,
+        sha256_kernel_init, sha256_kernel_update, sha256_kernel_final},
+};
+
+#define GFAL2_CHECKSUM_MAX_REGISTERED 16
+
+static const gfal2_checksum_kernel_t* registered_kernels[GFAL2_CHECKSUM_MAX_REGISTERED];
+static size_t registered_count = 0;
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+const gfal2_checksum_kernel_t* gfal2_checksum_kernel_get(size_t index)
+{
+    const gfal2_checksum_kernel_t* kernel = NULL;
+
+    pthread_mutex_lock(&registry_lock);
+    if (index < registered_count)
+        kernel = registered_kernels[registered_count - index - 1];
+    else if (index - registered_count < sizeof(builtin_kernels) / sizeof(builtin_kernels[0]))
+        kernel = &builtin_kernels[index - registered_count];
+    pthread_mutex_unlock(&registry_lock);
+
+    return kernel;
+}
+
+
+const gfal2_checksum_kernel_t* gfal2_checksum_kernel_find(const char* name)
+{
+    const gfal2_checksum_kernel_t* kernel;
+    size_t i;
+
+    if (name == NULL)
+        return NULL;
+
+    for (i = 0; (kernel = gfal2_checksum_kernel_get(i)) != NULL; ++i) {
+        if (strcasecmp(kernel->name, name) == 0 && (kernel->supported == NULL || kernel->supported()))
+            return kernel;
+    }
+    return NULL;
+}
+
+
+int gfal2_checksum_kernel_register(const gfal2_checksum_kernel_t* kernel)
+{
+    int ret = -1;
+
+    pthread_mutex_lock(&registry_lock);
+    if (registered_count < GFAL2_CHECKSUM_MAX_REGISTERED) {
+        registered_kernels[registered_count++] = kernel;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    return ret;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef GFAL2_CHECKSUM_KERNELS_H_
+#define GFAL2_CHECKSUM_KERNELS_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Streaming checksum implementation
+ * Several kernels may implement the same algorithm, i.e. with and without
+ * hardware support. The first one supported by the running CPU is used.
+ */
+typedef struct gfal2_checksum_kernel {
+    // Algorithm name, case insensitive (i.e. "crc32c")
+    const char* name;
+    // Implementation name, for logging and benchmarks (i.e. "sse4.2")
+    const char* implementation;
+    // Size of the state passed to init, update and final
+    size_t ctx_size;
+    // Return 1 if the kernel can run on this host. NULL means always
+    int (*supported)(void);
+
+    void (*init)(void* ctx);
+    void (*update)(void* ctx, const void* data, size_t size);
+    // Write the checksum as a hex string. Return -1 if hex is too short
+    int (*final)(void* ctx, char* hex, size_t s_hex);
+} gfal2_checksum_kernel_t;
+
+/**
+ * Return the best kernel available for the algorithm, or NULL
+ */
+const gfal2_checksum_kernel_t* gfal2_checksum_kernel_find(const char* name);
+
+/**
+ * Iterate over all the known kernels, supported or not
+ * Return NULL when index is past the end
+ */
+const gfal2_checksum_kernel_t* gfal2_checksum_kernel_get(size_t index);
+
+/**
+ * Add a kernel. It takes precedence over the built-in ones for the same algorithm
+ * The kernel must remain valid for the lifetime of the process
+ * @return 0 on success, -1 if the registry is full
+ */
+int gfal2_checksum_kernel_register(const gfal2_checksum_kernel_t* kernel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GFAL2_CHECKSUM_KERNELS_H_ */
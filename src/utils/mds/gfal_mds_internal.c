@@ -44,6 +44,29 @@ static const char* SRM_PREFIX_NAME="SRM";
 
 static pthread_mutex_t mux_init_lap = PTHREAD_MUTEX_INITIALIZER;
 
+// Idle connections, per ldap uri, reused by the following lookups
+static const char* bdii_config_pool_size = "MAX_IDLE_CONNECTIONS";
+#define GFAL_MDS_POOL_SIZE_MAX 64
+static pthread_mutex_t mux_pool = PTHREAD_MUTEX_INITIALIZER;
+static GHashTable* ldap_pool = NULL;
+
+// Results of the lookups, per ldap uri and host, including the negative ones
+static const char* bdii_config_cache_ttl = "CACHE_TTL";
+static const char* bdii_config_negative_ttl = "NEGATIVE_CACHE_TTL";
+static pthread_mutex_t mux_result_cache = PTHREAD_MUTEX_INITIALIZER;
+static GHashTable* result_cache = NULL;
+
+#define GFAL_MDS_RESULT_CACHE_MAX 1024
+
+typedef struct {
+	gint64 expiration;
+	int n_endpoints;
+	gfal_mds_endpoint* endpoints;
+	GQuark errdomain;
+	int errcode;
+	char* errmsg;
+} gfal_mds_cached_result;
+
 
 LDAP *gfal_mds_ldap_connect(gfal2_context_t context, const char *uri, GError **err)
 {
@@ -283,8 +306,201 @@ void gfal_mds_ldap_disconnect(LDAP *ld)
 	gfal_mds_ldap.ldap_unbind_ext_s(ld, NULL, NULL);
 }
 
+
+static void gfal_mds_ldap_pool_free_queue(gpointer data)
+{
+	GQueue* idle = (GQueue*) data;
+	LDAP* ld;
+	while ((ld = g_queue_pop_head(idle)) != NULL)
+		gfal_mds_ldap_disconnect(ld);
+	g_queue_free(idle);
+}
+
+/*
+ * Take an idle connection to the uri from the pool, or open a new one
+ * from_pool is set to TRUE if the connection was reused
+ */
+static LDAP* gfal_mds_ldap_acquire(gfal2_context_t context, const char* uri, gboolean* from_pool, GError** err)
+{
+	LDAP* ld = NULL;
+
+	pthread_mutex_lock(&mux_pool);
+	if (ldap_pool) {
+		GQueue* idle = g_hash_table_lookup(ldap_pool, uri);
+		if (idle)
+			ld = g_queue_pop_head(idle);
+	}
+	pthread_mutex_unlock(&mux_pool);
+
+	*from_pool = (ld != NULL);
+	if (ld) {
+		gfal2_log(G_LOG_LEVEL_DEBUG, "  Reuse connection to the bdii %s", uri);
+		return ld;
+	}
+	return gfal_mds_ldap_connect(context, uri, err);
+}
+
+/*
+ * Give back a connection to the pool, or close it if there are enough idle ones
+ */
+static void gfal_mds_ldap_release(gfal2_context_t context, const char* uri, LDAP* ld)
+{
+	const int pool_size = gfal2_get_opt_integer_with_default(context, bdii_config_group,
+			bdii_config_pool_size, 4);
+	const guint max_idle = CLAMP(pool_size, 0, GFAL_MDS_POOL_SIZE_MAX);
+
+	pthread_mutex_lock(&mux_pool);
+	if (!ldap_pool)
+		ldap_pool = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, gfal_mds_ldap_pool_free_queue);
+	GQueue* idle = g_hash_table_lookup(ldap_pool, uri);
+	if (!idle) {
+		idle = g_queue_new();
+		g_hash_table_insert(ldap_pool, g_strdup(uri), idle);
+	}
+	if (g_queue_get_length(idle) < max_idle) {
+		g_queue_push_head(idle, ld);
+		ld = NULL;
+	}
+	pthread_mutex_unlock(&mux_pool);
+
+	if (ld)
+		gfal_mds_ldap_disconnect(ld);
+}
+
+
+static void gfal_mds_cached_result_free(gpointer data)
+{
+	gfal_mds_cached_result* cached = (gfal_mds_cached_result*) data;
+	g_free(cached->endpoints);
+	g_free(cached->errmsg);
+	g_free(cached);
+}
+
+
+static gboolean gfal_mds_cached_result_expired(gpointer key, gpointer value, gpointer user_data)
+{
+	return ((gfal_mds_cached_result*) value)->expiration <= *((gint64*) user_data);
+}
+
+/*
+ * Look for a previous result of the same lookup
+ * @return TRUE if found, with ret set to the number of endpoints, or -1 if the cached result is an error
+ */
+static gboolean gfal_mds_result_cache_lookup(const char* key, gfal_mds_endpoint* endpoints, size_t s_endpoint,
+		int* ret, GError** err)
+{
+	const gint64 now = g_get_monotonic_time();
+
+	pthread_mutex_lock(&mux_result_cache);
+	gfal_mds_cached_result* cached = result_cache ? g_hash_table_lookup(result_cache, key) : NULL;
+	if (cached && cached->expiration <= now) {
+		g_hash_table_remove(result_cache, key);
+		cached = NULL;
+	}
+	if (cached) {
+		if (cached->errmsg) {
+			g_set_error(err, cached->errdomain, cached->errcode, "%s", cached->errmsg);
+			*ret = -1;
+		} else {
+			*ret = MIN(cached->n_endpoints, (int) s_endpoint);
+			memcpy(endpoints, cached->endpoints, *ret * sizeof(gfal_mds_endpoint));
+		}
+	}
+	pthread_mutex_unlock(&mux_result_cache);
+	return cached != NULL;
+}
+
+
+static void gfal_mds_result_cache_store(const char* key, int ttl, const gfal_mds_endpoint* endpoints, int n_endpoints,
+		const GError* error)
+{
+	if (ttl <= 0)
+		return;
+
+	gfal_mds_cached_result* cached = g_new0(gfal_mds_cached_result, 1);
+	const gint64 now = g_get_monotonic_time();
+	cached->expiration = now + (gint64) ttl * G_USEC_PER_SEC;
+	if (error) {
+		cached->errdomain = error->domain;
+		cached->errcode = error->code;
+		cached->errmsg = g_strdup(error->message);
+	} else {
+		cached->n_endpoints = n_endpoints;
+		cached->endpoints = g_memdup(endpoints, n_endpoints * sizeof(gfal_mds_endpoint));
+	}
+
+	pthread_mutex_lock(&mux_result_cache);
+	if (!result_cache)
+		result_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, gfal_mds_cached_result_free);
+	if (g_hash_table_size(result_cache) >= GFAL_MDS_RESULT_CACHE_MAX) {
+		g_hash_table_foreach_remove(result_cache, gfal_mds_cached_result_expired, (gpointer) &now);
+		if (g_hash_table_size(result_cache) >= GFAL_MDS_RESULT_CACHE_MAX)
+			g_hash_table_remove_all(result_cache);
+	}
+	g_hash_table_replace(result_cache, g_strdup(key), cached);
+	pthread_mutex_unlock(&mux_result_cache);
+}
+
+
+void gfal_mds_bdii_cache_clear(void)
+{
+	pthread_mutex_lock(&mux_result_cache);
+	if (result_cache)
+		g_hash_table_remove_all(result_cache);
+	pthread_mutex_unlock(&mux_result_cache);
+
+	pthread_mutex_lock(&mux_pool);
+	if (ldap_pool)
+		g_hash_table_remove_all(ldap_pool);
+	pthread_mutex_unlock(&mux_pool);
+}
+
+/*
+ * Run the endpoint query against the bdii, reusing a pooled connection if there is one
+ * If a reused connection fails, it may have been closed by the server, so try once more with a new one
+ * @param endpoints: set to a newly allocated table with all the endpoints returned, to be freed with g_free
+ * @param definitive: set to TRUE if the bdii answered, even if the answer is an error
+ */
+static int gfal_mds_bdii_query_srm_endpoint(gfal2_context_t context, const char* uri, const char* base_url,
+		gfal_mds_endpoint** endpoints, gboolean* definitive, GError** err)
+{
+	GError* tmp_err = NULL;
+	gboolean from_pool = FALSE;
+	int ret = -1;
+	LDAP* ld;
+
+	*definitive = FALSE;
+	char buff_filter[GFAL_URL_MAX_LEN];
+	snprintf(buff_filter, GFAL_URL_MAX_LEN, srm_endpoint_filter, base_url, base_url); // construct the request
+
+	while ((ld = gfal_mds_ldap_acquire(context, uri, &from_pool, &tmp_err)) != NULL) {
+		LDAPMessage* res;
+		if (gfal_mds_ldap_search(ld, sbasedn, buff_filter, tabattr, &res, &tmp_err) >= 0) {
+			*definitive = TRUE;
+			const int n_entries = MAX(gfal_mds_ldap.ldap_count_entries(ld, res), 0);
+			*endpoints = g_new0(gfal_mds_endpoint, MAX(n_entries, 1));
+			ret = gfal_mds_get_srm_types_endpoint(ld, res, *endpoints, n_entries, &tmp_err);
+			gfal_mds_ldap.ldap_msgfree(res);
+			gfal_mds_ldap_release(context, uri, ld);
+			break;
+		}
+
+		gfal_mds_ldap_disconnect(ld);
+		if (!from_pool)
+			break;
+		gfal2_log(G_LOG_LEVEL_DEBUG, "  Reused connection to the bdii failed, reconnect: %s", tmp_err->message);
+		g_clear_error(&tmp_err);
+	}
+
+	if (tmp_err)
+		g_propagate_error(err, tmp_err);
+	return ret;
+}
+
 /*
  * resolve the SRM endpoint associated with a given base_url with the bdii
+ * Connections to the bdii are kept open between calls, and the results are cached
+ * for BDII:CACHE_TTL seconds, or BDII:NEGATIVE_CACHE_TTL if the bdii had no valid answer
  * @param base_url : basic url to resolve
  * @param endpoints : table of gfal_mds_endpoint to set with a size of s_endpoint
  * @param s_endpoint : maximum number of endpoints to set
@@ -297,19 +513,29 @@ int gfal_mds_bdii_get_srm_endpoint(gfal2_context_t context, const char *base_url
 	int ret = -1;
 	GError *tmp_err = NULL;
 	char uri[GFAL_URL_MAX_LEN];
-	LDAP *ld;
 	gfal2_log(G_LOG_LEVEL_DEBUG, " gfal_mds_bdii_get_srm_endpoint ->");
 	if (gfal_mds_get_ldapuri(context, uri, GFAL_URL_MAX_LEN, &tmp_err) >= 0) {
-		if ((ld = gfal_mds_ldap_connect(context, uri, &tmp_err)) != NULL) {
-			LDAPMessage *res;
-			char buff_filter[GFAL_URL_MAX_LEN];
-			snprintf(buff_filter, GFAL_URL_MAX_LEN, srm_endpoint_filter, base_url, base_url); // construct the request
-			if (gfal_mds_ldap_search(ld, sbasedn, buff_filter, tabattr, &res, &tmp_err) >= 0) {
-				ret = gfal_mds_get_srm_types_endpoint(ld, res, endpoints, s_endpoint, &tmp_err);
-				gfal_mds_ldap.ldap_msgfree(res);
+		char* cache_key = g_strconcat(uri, " ", base_url, NULL);
+		if (gfal_mds_result_cache_lookup(cache_key, endpoints, s_endpoint, &ret, &tmp_err)) {
+			gfal2_log(G_LOG_LEVEL_DEBUG, "  bdii result for %s found in memory", base_url);
+		} else {
+			// The whole list is cached, the next callers may ask for more endpoints than this one
+			gboolean definitive = FALSE;
+			gfal_mds_endpoint* all_endpoints = NULL;
+			ret = gfal_mds_bdii_query_srm_endpoint(context, uri, base_url, &all_endpoints,
+					&definitive, &tmp_err);
+			if (definitive) {
+				const int ttl = gfal2_get_opt_integer_with_default(context, bdii_config_group,
+						(ret > 0) ? bdii_config_cache_ttl : bdii_config_negative_ttl, (ret > 0) ? 300 : 60);
+				gfal_mds_result_cache_store(cache_key, ttl, all_endpoints, ret, tmp_err);
+			}
+			if (ret > 0) {
+				ret = MIN(ret, (int) s_endpoint);
+				memcpy(endpoints, all_endpoints, ret * sizeof(gfal_mds_endpoint));
 			}
-			gfal_mds_ldap_disconnect(ld);
+			g_free(all_endpoints);
 		}
+		g_free(cache_key);
 	}
 
 	gfal2_log(G_LOG_LEVEL_DEBUG, " gfal_mds_bdii_get_srm_endpoint <-");
@@ -38,6 +38,9 @@ int gfal_mds_get_srm_types_endpoint(LDAP* ld, LDAPMessage *result, gfal_mds_endp
 
 int gfal_mds_bdii_get_srm_endpoint(gfal2_context_t handle, const char* base_url, gfal_mds_endpoint* endpoints, size_t s_endpoint, GError** err);
 
+// Drop the cached bdii results and close the idle connections
+void gfal_mds_bdii_cache_clear(void);
+
 #ifndef MDS_WITHOUT_CACHE
 /** Tries to resolve the available endpoints from a cache file
  *  compatible with FTS3 bdii cache format
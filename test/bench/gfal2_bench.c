@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Measures the overhead of the core against the in-memory plugin, and prints
+// the results as JSON. No plugin is loaded from disk, so it runs fully offline.
+//
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include <gfal_api.h>
+#include <common/gfal_plugin.h>
+#include <transfer/gfal_transfer.h>
+
+#include <common/gfal_mem_plugin.h>
+
+
+static gint iterations = 10000;
+static gint nfiles = 1000;
+static gint nhosts = 4;
+static gint copy_size_mb = 256;
+static gint nbstreams = 1;
+static gint64 latency = 0;
+static gint64 bandwidth = 0;
+static gint error_every = 0;
+static gchar* output = NULL;
+
+static GOptionEntry bench_options[] = {
+    {"iterations", 'i', 0, G_OPTION_ARG_INT, &iterations, "Iterations of the per-call benchmarks", "N"},
+    {"files", 'f', 0, G_OPTION_ARG_INT, &nfiles, "Files in the listed directory and in the bulk copy", "N"},
+    {"hosts", 0, 0, G_OPTION_ARG_INT, &nhosts, "Hosts the bulk copy is spread over", "N"},
+    {"size", 's', 0, G_OPTION_ARG_INT, &copy_size_mb, "Size of the streamed copy, in MB", "MB"},
+    {"streams", 'n', 0, G_OPTION_ARG_INT, &nbstreams, "Streams of the streamed copy", "N"},
+    {"latency", 'l', 0, G_OPTION_ARG_INT64, &latency, "Latency added to each plugin operation", "USEC"},
+    {"bandwidth", 'b', 0, G_OPTION_ARG_INT64, &bandwidth, "Bandwidth cap of the plugin, 0 for none", "BYTES/S"},
+    {"error-every", 'e', 0, G_OPTION_ARG_INT, &error_every, "Fail one every N plugin operations", "N"},
+    {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "Write the results here instead of stdout", "FILE"},
+    {NULL}
+};
+
+
+typedef struct {
+    const char* name;
+    gint64 ops;
+    gint64 errors;
+    gint64 bytes;
+    gint64 usec;
+} bench_result_t;
+
+
+static void bench_report(GString* json, const bench_result_t* res)
+{
+    const double seconds = res->usec / (double)G_USEC_PER_SEC;
+
+    if (json->str[json->len - 1] == '}')
+        g_string_append(json, ",");
+    g_string_append_printf(json, "\n    {\"name\": \"%s\", \"ops\": %" G_GINT64_FORMAT ", \"errors\": %" G_GINT64_FORMAT
+        ", \"seconds\": %.6f", res->name, res->ops, res->errors, seconds);
+    if (res->ops > 0 && res->usec > 0) {
+        g_string_append_printf(json, ", \"ops_per_sec\": %.1f, \"usec_per_op\": %.3f",
+            res->ops / seconds, res->usec / (double)res->ops);
+    }
+    if (res->bytes > 0 && res->usec > 0) {
+        g_string_append_printf(json, ", \"bytes\": %" G_GINT64_FORMAT ", \"mb_per_sec\": %.2f",
+            res->bytes, res->bytes / seconds / (1024 * 1024));
+    }
+    g_string_append(json, "}");
+}
+
+
+static gfal2_context_t bench_context_new(gfal_mem_plugin_t* mem)
+{
+    GError* error = NULL;
+    gfal2_context_t context = gfal2_context_new(&error);
+    if (context == NULL || gfal_mem_plugin_register(context, mem, &error) < 0) {
+        fprintf(stderr, "Could not create the context: %s\n", error->message);
+        exit(1);
+    }
+    return context;
+}
+
+
+static void bench_context(gfal_mem_plugin_t* mem, bench_result_t* res)
+{
+    res->name = "context_new";
+    const gint64 start = g_get_monotonic_time();
+    for (res->ops = 0; res->ops < iterations; ++res->ops) {
+        gfal2_context_t context = bench_context_new(mem);
+        gfal2_context_free(context);
+    }
+    res->usec = g_get_monotonic_time() - start;
+}
+
+
+static void bench_find_plugin(gfal2_context_t context, bench_result_t* res)
+{
+    res->name = "find_plugin";
+    const gint64 start = g_get_monotonic_time();
+    for (res->ops = 0; res->ops < iterations; ++res->ops) {
+        GError* error = NULL;
+        if (gfal_find_plugin(context, "mem://bench/data/file0", GFAL_PLUGIN_STAT, &error) == NULL) {
+            ++res->errors;
+            g_error_free(error);
+        }
+    }
+    res->usec = g_get_monotonic_time() - start;
+}
+
+
+static void bench_open_close(gfal2_context_t context, bench_result_t* res)
+{
+    res->name = "open_close";
+    const gint64 start = g_get_monotonic_time();
+    for (res->ops = 0; res->ops < iterations; ++res->ops) {
+        GError* error = NULL;
+        int fd = gfal2_open(context, "mem://bench/data/file0", O_RDONLY, &error);
+        if (fd < 0 || gfal2_close(context, fd, &error) < 0) {
+            ++res->errors;
+            g_clear_error(&error);
+        }
+    }
+    res->usec = g_get_monotonic_time() - start;
+}
+
+
+static void bench_stat(gfal2_context_t context, bench_result_t* res)
+{
+    res->name = "stat";
+    struct stat st;
+    char url[GFAL_URL_MAX_LEN];
+    const gint64 start = g_get_monotonic_time();
+    for (res->ops = 0; res->ops < iterations; ++res->ops) {
+        GError* error = NULL;
+        g_snprintf(url, sizeof(url), "mem://bench/data/file%" G_GINT64_FORMAT, res->ops % nfiles);
+        if (gfal2_stat(context, url, &st, &error) < 0) {
+            ++res->errors;
+            g_error_free(error);
+        }
+    }
+    res->usec = g_get_monotonic_time() - start;
+}
+
+
+static void bench_readdirpp(gfal2_context_t context, bench_result_t* res)
+{
+    res->name = "readdirpp";
+    struct stat st;
+    GError* error = NULL;
+    const gint64 start = g_get_monotonic_time();
+    DIR* dir = gfal2_opendir(context, "mem://bench/data", &error);
+    if (dir) {
+        while (gfal2_readdirpp(context, dir, &st, &error) != NULL)
+            ++res->ops;
+        gfal2_closedir(context, dir, error ? NULL : &error);
+    }
+    res->usec = g_get_monotonic_time() - start;
+    if (error) {
+        ++res->errors;
+        g_error_free(error);
+    }
+}
+
+
+static void bench_streamed_copy(gfal2_context_t context, bench_result_t* res)
+{
+    res->name = "streamed_copy";
+    GError* error = NULL;
+    gfalt_params_t params = gfalt_params_handle_new(NULL);
+    gfalt_set_replace_existing_file(params, TRUE, NULL);
+    gfalt_set_nbstreams(params, nbstreams, NULL);
+
+    const gint64 start = g_get_monotonic_time();
+    if (gfalt_copy_file(context, params, "mem://bench/big", "mem://bench/copy/big", &error) < 0) {
+        ++res->errors;
+        g_error_free(error);
+    }
+    else {
+        res->bytes = (gint64)copy_size_mb * 1024 * 1024;
+    }
+    res->usec = g_get_monotonic_time() - start;
+    res->ops = 1;
+
+    gfalt_params_handle_delete(params, NULL);
+}
+
+
+static void bench_bulk_copy(gfal2_context_t context, bench_result_t* res)
+{
+    res->name = "bulk_copy";
+    char** srcs = g_new0(char*, nfiles + 1);
+    char** dsts = g_new0(char*, nfiles + 1);
+    int i;
+    for (i = 0; i < nfiles; ++i) {
+        srcs[i] = g_strdup_printf("mem://host%d/bulk/file%d", i % nhosts, i);
+        dsts[i] = g_strdup_printf("mem://host%d/bulk-copy/file%d", i % nhosts, i);
+    }
+
+    GError* op_error = NULL;
+    GError** file_errors = NULL;
+    const gint64 start = g_get_monotonic_time();
+    gfalt_copy_bulk(context, NULL, nfiles, (const char* const*)srcs, (const char* const*)dsts, NULL,
+        &op_error, &file_errors);
+    res->usec = g_get_monotonic_time() - start;
+    res->ops = nfiles;
+
+    if (op_error) {
+        res->errors = nfiles;
+        g_error_free(op_error);
+    }
+    if (file_errors) {
+        for (i = 0; i < nfiles; ++i) {
+            if (file_errors[i]) {
+                ++res->errors;
+                g_error_free(file_errors[i]);
+            }
+        }
+        g_free(file_errors);
+    }
+
+    g_strfreev(srcs);
+    g_strfreev(dsts);
+}
+
+
+int main(int argc, char** argv)
+{
+    GError* error = NULL;
+    GOptionContext* opt_context = g_option_context_new("- benchmark the gfal2 core against an in-memory plugin");
+    g_option_context_add_main_entries(opt_context, bench_options, NULL);
+    if (!g_option_context_parse(opt_context, &argc, &argv, &error)) {
+        fprintf(stderr, "%s\n", error->message);
+        return 1;
+    }
+    g_option_context_free(opt_context);
+
+    if (iterations <= 0 || nfiles <= 0 || nhosts <= 0 || copy_size_mb < 0 || nbstreams <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    // Point the plugin directory to an empty one, so only the in-memory plugin is there
+    char* plugin_dir = g_dir_make_tmp("gfal2-bench-XXXXXX", &error);
+    if (!plugin_dir) {
+        fprintf(stderr, "Could not create the plugin directory: %s\n", error->message);
+        return 1;
+    }
+    g_setenv("GFAL_PLUGIN_DIR", plugin_dir, TRUE);
+    gfal2_log_set_level(G_LOG_LEVEL_WARNING);
+
+    gfal_mem_plugin_t* mem = gfal_mem_plugin_new();
+    gfal_mem_plugin_set_latency(mem, latency);
+    gfal_mem_plugin_set_bandwidth(mem, bandwidth);
+
+    char url[GFAL_URL_MAX_LEN];
+    int i;
+    for (i = 0; i < nfiles; ++i) {
+        g_snprintf(url, sizeof(url), "mem://bench/data/file%d", i);
+        gfal_mem_plugin_put(mem, url, 1024);
+        g_snprintf(url, sizeof(url), "mem://host%d/bulk/file%d", i % nhosts, i);
+        gfal_mem_plugin_put(mem, url, 64 * 1024);
+    }
+    gfal_mem_plugin_put(mem, "mem://bench/big", (size_t)copy_size_mb * 1024 * 1024);
+
+    // Error injection starts once the files are in place
+    gfal_mem_plugin_set_error_every(mem, error_every);
+
+    GString* json = g_string_new("{\n  \"config\": {");
+    g_string_append_printf(json, "\"iterations\": %d, \"files\": %d, \"hosts\": %d, \"size_mb\": %d, \"streams\": %d, "
+        "\"latency_usec\": %" G_GINT64_FORMAT ", \"bandwidth\": %" G_GINT64_FORMAT ", \"error_every\": %d},\n"
+        "  \"results\": [",
+        iterations, nfiles, nhosts, copy_size_mb, nbstreams, latency, bandwidth, error_every);
+
+    bench_result_t res;
+
+    memset(&res, 0, sizeof(res));
+    bench_context(mem, &res);
+    bench_report(json, &res);
+
+    gfal2_context_t context = bench_context_new(mem);
+
+    memset(&res, 0, sizeof(res));
+    bench_find_plugin(context, &res);
+    bench_report(json, &res);
+
+    memset(&res, 0, sizeof(res));
+    bench_open_close(context, &res);
+    bench_report(json, &res);
+
+    memset(&res, 0, sizeof(res));
+    bench_stat(context, &res);
+    bench_report(json, &res);
+
+    memset(&res, 0, sizeof(res));
+    bench_readdirpp(context, &res);
+    bench_report(json, &res);
+
+    memset(&res, 0, sizeof(res));
+    bench_streamed_copy(context, &res);
+    bench_report(json, &res);
+
+    memset(&res, 0, sizeof(res));
+    bench_bulk_copy(context, &res);
+    bench_report(json, &res);
+
+    g_string_append(json, "\n  ]\n}\n");
+
+    int ret = 0;
+    if (output) {
+        if (!g_file_set_contents(output, json->str, json->len, &error)) {
+            fprintf(stderr, "Could not write the results: %s\n", error->message);
+            g_error_free(error);
+            ret = 1;
+        }
+    }
+    else {
+        fputs(json->str, stdout);
+    }
+
+    g_string_free(json, TRUE);
+    gfal2_context_free(context);
+    gfal_mem_plugin_free(mem);
+    g_rmdir(plugin_dir);
+    g_free(plugin_dir);
+    g_free(output);
+    return ret;
+}
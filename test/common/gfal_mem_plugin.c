@@ -0,0 +1,855 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "gfal_mem_plugin.h"
+
+// Files are stored in chunks that never move once allocated, so data can be
+// copied in and out without holding the store lock. Missing chunks read as zeros.
+#define MEM_CHUNK_SIZE (1024 * 1024)
+
+// Data that can be moved at once after an idle period, with a bandwidth cap
+#define MEM_BURST_USEC (100 * 1000)
+
+
+typedef struct {
+    gint ref_count;
+    mode_t mode;
+    time_t mtime;
+    off_t size;
+    GPtrArray* chunks;
+} MemEntry;
+
+
+typedef struct {
+    MemEntry* entry;
+    off_t offset;
+} MemFile;
+
+
+typedef struct {
+    GSList* list;
+    GSList* item;
+} MemDirectory;
+
+
+typedef struct {
+    struct stat st;
+    struct dirent de;
+} MemDirEntry;
+
+
+struct gfal_mem_plugin {
+    pthread_mutex_t lock;
+    GHashTable* entries;
+
+    guint64 latency;
+    guint64 bandwidth;
+
+    // Token bucket shared by all the callers, in bytes. Negative while in debt
+    pthread_mutex_t bucket_lock;
+    gint64 bucket_tokens;
+    gint64 bucket_update;
+    guint error_every;
+    gint op_count;
+    gboolean positional_io;
+
+    gint reads_active;
+    gint reads_max_active;
+};
+
+
+static GQuark gfal_mem_plugin_quark()
+{
+    return g_quark_from_static_string(GFAL2_QUARK_PLUGINS "::MEM");
+}
+
+
+static const char* gfal_mem_plugin_getName()
+{
+    return "mem";
+}
+
+
+static gboolean is_mem_uri(const char* url)
+{
+    return strncmp(url, "mem://", 6) == 0;
+}
+
+
+static MemEntry* mem_entry_new(mode_t mode)
+{
+    MemEntry* entry = g_new0(MemEntry, 1);
+    entry->ref_count = 1;
+    entry->mode = mode;
+    entry->mtime = time(NULL);
+    if (S_ISREG(mode))
+        entry->chunks = g_ptr_array_new_with_free_func(g_free);
+    return entry;
+}
+
+
+static MemEntry* mem_entry_ref(MemEntry* entry)
+{
+    g_atomic_int_inc(&entry->ref_count);
+    return entry;
+}
+
+
+static void mem_entry_unref(gpointer data)
+{
+    MemEntry* entry = (MemEntry*)data;
+    if (g_atomic_int_dec_and_test(&entry->ref_count)) {
+        if (entry->chunks)
+            g_ptr_array_free(entry->chunks, TRUE);
+        g_free(entry);
+    }
+}
+
+
+// Strip the query and trailing slashes, so the same entry is found for all spellings
+static char* mem_key(const char* url)
+{
+    size_t len = strcspn(url, "?");
+    while (len > 6 && url[len - 1] == '/')
+        --len;
+    return g_strndup(url, len);
+}
+
+
+// Parent key, or NULL for the root of a host
+static char* mem_parent(const char* key)
+{
+    const char* slash = strrchr(key, '/');
+    if (slash == NULL || slash - key < 6 || strchr(key + 6, '/') == NULL)
+        return NULL;
+    return g_strndup(key, slash - key);
+}
+
+
+static void mem_report_error(GError** err, int errn, const char* func, const char* url)
+{
+    gfal2_set_error(err, gfal_mem_plugin_quark(), errn, func, "%s: %s", strerror(errn), url);
+}
+
+
+// Called at the beginning of each operation: apply the latency and inject the failures
+static int mem_enter(gfal_mem_plugin_t* mem, const char* func, GError** err)
+{
+    if (mem->latency > 0)
+        g_usleep(mem->latency);
+    if (mem->error_every > 0) {
+        guint n = (guint)g_atomic_int_add(&mem->op_count, 1) + 1;
+        if (n % mem->error_every == 0) {
+            gfal2_set_error(err, gfal_mem_plugin_quark(), EIO, func, "Injected failure");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+// The bucket is shared, so the cap holds for the plugin as a whole, whatever the number of streams.
+// Each caller takes its tokens, and sleeps outside the lock until the debt it left is paid back
+static void mem_throttle(gfal_mem_plugin_t* mem, size_t count)
+{
+    if (mem->bandwidth == 0 || count == 0)
+        return;
+
+    const gint64 bandwidth = mem->bandwidth;
+    const gint64 burst = bandwidth * MEM_BURST_USEC / G_USEC_PER_SEC;
+
+    pthread_mutex_lock(&mem->bucket_lock);
+    const gint64 now = g_get_monotonic_time();
+    if (mem->bucket_update == 0) {
+        mem->bucket_tokens = burst;
+    }
+    else {
+        const gint64 elapsed = MIN(now - mem->bucket_update, MEM_BURST_USEC);
+        mem->bucket_tokens = MIN(mem->bucket_tokens + elapsed * bandwidth / G_USEC_PER_SEC, burst);
+    }
+    mem->bucket_update = now;
+    mem->bucket_tokens -= count;
+    const gint64 debt = -mem->bucket_tokens;
+    pthread_mutex_unlock(&mem->bucket_lock);
+
+    if (debt > 0)
+        g_usleep(debt * G_USEC_PER_SEC / bandwidth);
+}
+
+
+// Must be called with the lock held. Creates the missing parents as directories
+static void mem_insert(gfal_mem_plugin_t* mem, char* key, MemEntry* entry)
+{
+    char* parent = mem_parent(key);
+    while (parent && !g_hash_table_lookup(mem->entries, parent)) {
+        char* next = mem_parent(parent);
+        g_hash_table_insert(mem->entries, parent, mem_entry_new(S_IFDIR | 0755));
+        parent = next;
+    }
+    g_free(parent);
+    g_hash_table_replace(mem->entries, key, entry);
+}
+
+
+// Returns a new reference to the entry, or NULL
+static MemEntry* mem_lookup(gfal_mem_plugin_t* mem, const char* url)
+{
+    char* key = mem_key(url);
+    pthread_mutex_lock(&mem->lock);
+    MemEntry* entry = g_hash_table_lookup(mem->entries, key);
+    if (entry)
+        mem_entry_ref(entry);
+    pthread_mutex_unlock(&mem->lock);
+    g_free(key);
+    return entry;
+}
+
+
+static void mem_fill_stat(const MemEntry* entry, off_t size, struct stat* st)
+{
+    memset(st, 0, sizeof(*st));
+    st->st_mode = entry->mode;
+    st->st_nlink = 1;
+    st->st_size = size;
+    st->st_mtime = st->st_ctime = st->st_atime = entry->mtime;
+}
+
+
+static ssize_t mem_read_at(gfal_mem_plugin_t* mem, MemEntry* entry, char* buff, size_t count, off_t offset)
+{
+    pthread_mutex_lock(&mem->lock);
+    const off_t size = entry->size;
+    pthread_mutex_unlock(&mem->lock);
+
+    if (offset >= size)
+        return 0;
+    if ((off_t)count > size - offset)
+        count = size - offset;
+
+    size_t done = 0;
+    while (done < count) {
+        const guint index = (offset + done) / MEM_CHUNK_SIZE;
+        const size_t chunk_offset = (offset + done) % MEM_CHUNK_SIZE;
+        size_t n = MIN(count - done, MEM_CHUNK_SIZE - chunk_offset);
+
+        pthread_mutex_lock(&mem->lock);
+        const char* chunk = (index < entry->chunks->len) ? g_ptr_array_index(entry->chunks, index) : NULL;
+        pthread_mutex_unlock(&mem->lock);
+
+        if (chunk)
+            memcpy(buff + done, chunk + chunk_offset, n);
+        else
+            memset(buff + done, 0, n);
+        done += n;
+    }
+    return count;
+}
+
+
+static ssize_t mem_write_at(gfal_mem_plugin_t* mem, MemEntry* entry, const char* buff, size_t count, off_t offset)
+{
+    size_t done = 0;
+    while (done < count) {
+        const guint index = (offset + done) / MEM_CHUNK_SIZE;
+        const size_t chunk_offset = (offset + done) % MEM_CHUNK_SIZE;
+        size_t n = MIN(count - done, MEM_CHUNK_SIZE - chunk_offset);
+
+        pthread_mutex_lock(&mem->lock);
+        if (entry->chunks->len <= index)
+            g_ptr_array_set_size(entry->chunks, index + 1);
+        char* chunk = g_ptr_array_index(entry->chunks, index);
+        if (chunk == NULL) {
+            chunk = g_malloc0(MEM_CHUNK_SIZE);
+            g_ptr_array_index(entry->chunks, index) = chunk;
+        }
+        pthread_mutex_unlock(&mem->lock);
+
+        memcpy(chunk + chunk_offset, buff + done, n);
+        done += n;
+    }
+
+    pthread_mutex_lock(&mem->lock);
+    if (entry->size < offset + (off_t)count)
+        entry->size = offset + count;
+    entry->mtime = time(NULL);
+    pthread_mutex_unlock(&mem->lock);
+    return count;
+}
+
+
+static gboolean gfal_mem_check_url(plugin_handle plugin_data, const char* url, plugin_mode mode, GError** err)
+{
+    switch (mode) {
+        case GFAL_PLUGIN_ACCESS:
+        case GFAL_PLUGIN_MKDIR:
+        case GFAL_PLUGIN_STAT:
+        case GFAL_PLUGIN_LSTAT:
+        case GFAL_PLUGIN_RMDIR:
+        case GFAL_PLUGIN_OPENDIR:
+        case GFAL_PLUGIN_OPEN:
+        case GFAL_PLUGIN_UNLINK:
+            return is_mem_uri(url);
+        default:
+            return FALSE;
+    }
+}
+
+
+static int gfal_mem_statG(plugin_handle plugin_data, const char* url, struct stat* buf, GError** err)
+{
+    gfal_mem_plugin_t* mem = (gfal_mem_plugin_t*)plugin_data;
+    if (mem_enter(mem, __func__, err) < 0)
+        return -1;
+
+    MemEntry* entry = mem_lookup(mem, url);
+    if (!entry) {
+        mem_report_error(err, ENOENT, __func__, url);
+        return -1;
+    }
+    pthread_mutex_lock(&mem->lock);
+    mem_fill_stat(entry, entry->size, buf);
+    pthread_mutex_unlock(&mem->lock);
+    mem_entry_unref(entry);
+    return 0;
+}
+
+
+static int gfal_mem_accessG(plugin_handle plugin_data, const char* url, int mode, GError** err)
+{
+    struct stat st;
+    return gfal_mem_statG(plugin_data, url, &st, err);
+}
+
+
+static int gfal_mem_mkdirpG(plugin_handle plugin_data, const char* url, mode_t mode, gboolean rec_flag, GError** err)
+{
+    gfal_mem_plugin_t* mem = (gfal_mem_plugin_t*)plugin_data;
+    if (mem_enter(mem, __func__, err) < 0)
+        return -1;
+
+    char* key = mem_key(url);
+    char* parent = mem_parent(key);
+    int errn = 0;
+
+    pthread_mutex_lock(&mem->lock);
+    if (g_hash_table_lookup(mem->entries, key))
+        errn = EEXIST;
+    else if (!rec_flag && parent && !g_hash_table_lookup(mem->entries, parent))
+        errn = ENOENT;
+    else
+        mem_insert(mem, key, mem_entry_new(S_IFDIR | (mode & 07777)));
+    pthread_mutex_unlock(&mem->lock);
+
+    g_free(parent);
+    if (errn) {
+        g_free(key);
+        mem_report_error(err, errn, __func__, url);
+        return -1;
+    }
+    return 0;
+}
+
+
+static int gfal_mem_remove(gfal_mem_plugin_t* mem, const char* url, gboolean dir, const char* func, GError** err)
+{
+    if (mem_enter(mem, func, err) < 0)
+        return -1;
+
+    char* key = mem_key(url);
+    int errn = 0;
+
+    pthread_mutex_lock(&mem->lock);
+    MemEntry* entry = g_hash_table_lookup(mem->entries, key);
+    if (!entry)
+        errn = ENOENT;
+    else if (dir && !S_ISDIR(entry->mode))
+        errn = ENOTDIR;
+    else if (!dir && S_ISDIR(entry->mode))
+        errn = EISDIR;
+    else
+        g_hash_table_remove(mem->entries, key);
+    pthread_mutex_unlock(&mem->lock);
+
+    g_free(key);
+    if (errn) {
+        mem_report_error(err, errn, func, url);
+        return -1;
+    }
+    return 0;
+}
+
+
+static int gfal_mem_unlinkG(plugin_handle plugin_data, const char* url, GError** err)
+{
+    return gfal_mem_remove((gfal_mem_plugin_t*)plugin_data, url, FALSE, __func__, err);
+}
+
+
+static int gfal_mem_rmdirG(plugin_handle plugin_data, const char* url, GError** err)
+{
+    return gfal_mem_remove((gfal_mem_plugin_t*)plugin_data, url, TRUE, __func__, err);
+}
+
+
+static gfal_file_handle gfal_mem_opendirG(plugin_handle plugin_data, const char* url, GError** err)
+{
+    gfal_mem_plugin_t* mem = (gfal_mem_plugin_t*)plugin_data;
+    if (mem_enter(mem, __func__, err) < 0)
+        return NULL;
+
+    char* key = mem_key(url);
+    const size_t key_len = strlen(key);
+    MemDirectory* dir = NULL;
+    int errn = 0;
+
+    pthread_mutex_lock(&mem->lock);
+    MemEntry* entry = g_hash_table_lookup(mem->entries, key);
+    if (!entry) {
+        errn = ENOENT;
+    }
+    else if (!S_ISDIR(entry->mode)) {
+        errn = ENOTDIR;
+    }
+    else {
+        dir = g_new0(MemDirectory, 1);
+
+        GHashTableIter iter;
+        gpointer child_key, child_value;
+        g_hash_table_iter_init(&iter, mem->entries);
+        while (g_hash_table_iter_next(&iter, &child_key, &child_value)) {
+            const char* name = (const char*)child_key + key_len;
+            if (strncmp(child_key, key, key_len) != 0 || name[0] != '/' || strchr(name + 1, '/') != NULL)
+                continue;
+
+            MemEntry* child = (MemEntry*)child_value;
+            MemDirEntry* dir_entry = g_new0(MemDirEntry, 1);
+            mem_fill_stat(child, child->size, &dir_entry->st);
+            g_strlcpy(dir_entry->de.d_name, name + 1, sizeof(dir_entry->de.d_name));
+            dir_entry->de.d_type = S_ISDIR(child->mode) ? DT_DIR : DT_REG;
+            dir_entry->de.d_reclen = sizeof(struct dirent);
+            dir->list = g_slist_prepend(dir->list, dir_entry);
+        }
+    }
+    pthread_mutex_unlock(&mem->lock);
+
+    g_free(key);
+    if (errn) {
+        mem_report_error(err, errn, __func__, url);
+        return NULL;
+    }
+
+    dir->item = dir->list;
+    return gfal_file_handle_new2(gfal_mem_plugin_getName(), dir, NULL, url);
+}
+
+
+static struct dirent* gfal_mem_readdirppG(plugin_handle plugin_data, gfal_file_handle dir_desc,
+    struct stat* st, GError** err)
+{
+    MemDirectory* dir = gfal_file_handle_get_fdesc(dir_desc);
+    if (!dir->item)
+        return NULL;
+
+    MemDirEntry* entry = (MemDirEntry*)dir->item->data;
+    dir->item = g_slist_next(dir->item);
+
+    memcpy(st, &entry->st, sizeof(struct stat));
+    return &entry->de;
+}
+
+
+static struct dirent* gfal_mem_readdirG(plugin_handle plugin_data, gfal_file_handle dir_desc, GError** err)
+{
+    struct stat st;
+    return gfal_mem_readdirppG(plugin_data, dir_desc, &st, err);
+}
+
+
+static int gfal_mem_closedirG(plugin_handle plugin_data, gfal_file_handle dir_desc, GError** err)
+{
+    MemDirectory* dir = gfal_file_handle_get_fdesc(dir_desc);
+    g_slist_free_full(dir->list, g_free);
+    g_free(dir);
+    gfal_file_handle_delete(dir_desc);
+    return 0;
+}
+
+
+static gfal_file_handle gfal_mem_openG(plugin_handle plugin_data, const char* url, int flag, mode_t mode, GError** err)
+{
+    gfal_mem_plugin_t* mem = (gfal_mem_plugin_t*)plugin_data;
+    if (mem_enter(mem, __func__, err) < 0)
+        return NULL;
+
+    char* key = mem_key(url);
+    char* parent = mem_parent(key);
+    MemEntry* entry = NULL;
+    int errn = 0;
+
+    pthread_mutex_lock(&mem->lock);
+    entry = g_hash_table_lookup(mem->entries, key);
+    if (entry && S_ISDIR(entry->mode)) {
+        errn = EISDIR;
+    }
+    else if (entry && (flag & O_CREAT) && (flag & O_EXCL)) {
+        errn = EEXIST;
+    }
+    else if (!entry || (flag & O_TRUNC)) {
+        if (!(flag & O_CREAT) && !entry) {
+            errn = ENOENT;
+        }
+        else if (parent && !g_hash_table_lookup(mem->entries, parent)) {
+            errn = ENOENT;
+        }
+        else {
+            entry = mem_entry_new(S_IFREG | (mode & 07777));
+            mem_insert(mem, key, entry);
+            key = NULL;
+        }
+    }
+    if (!errn)
+        mem_entry_ref(entry);
+    pthread_mutex_unlock(&mem->lock);
+
+    g_free(parent);
+    g_free(key);
+    if (errn) {
+        mem_report_error(err, errn, __func__, url);
+        return NULL;
+    }
+
+    MemFile* fd = g_new0(MemFile, 1);
+    fd->entry = entry;
+    if (flag & O_APPEND)
+        fd->offset = entry->size;
+    return gfal_file_handle_new2(gfal_mem_plugin_getName(), fd, NULL, url);
+}
+
+
+static ssize_t gfal_mem_preadG(plugin_handle plugin_data, gfal_file_handle fd, void* buff, size_t count,
+    off_t offset, GError** err)
+{
+    gfal_mem_plugin_t* mem = (gfal_mem_plugin_t*)plugin_data;
+    MemFile* mfd = gfal_file_handle_get_fdesc(fd);
+
+    pthread_mutex_lock(&mem->lock);
+    mem->reads_active++;
+    mem->reads_max_active = MAX(mem->reads_active, mem->reads_max_active);
+    pthread_mutex_unlock(&mem->lock);
+
+    ssize_t ret = -1;
+    if (mem_enter(mem, __func__, err) == 0) {
+        ret = mem_read_at(mem, mfd->entry, buff, count, offset);
+        mem_throttle(mem, ret);
+    }
+
+    pthread_mutex_lock(&mem->lock);
+    mem->reads_active--;
+    pthread_mutex_unlock(&mem->lock);
+    return ret;
+}
+
+
+static ssize_t gfal_mem_pwriteG(plugin_handle plugin_data, gfal_file_handle fd, const void* buff, size_t count,
+    off_t offset, GError** err)
+{
+    gfal_mem_plugin_t* mem = (gfal_mem_plugin_t*)plugin_data;
+    MemFile* mfd = gfal_file_handle_get_fdesc(fd);
+    if (mem_enter(mem, __func__, err) < 0)
+        return -1;
+
+    ssize_t ret = mem_write_at(mem, mfd->entry, buff, count, offset);
+    mem_throttle(mem, ret);
+    return ret;
+}
+
+
+static ssize_t gfal_mem_readG(plugin_handle plugin_data, gfal_file_handle fd, void* buff, size_t count, GError** err)
+{
+    MemFile* mfd = gfal_file_handle_get_fdesc(fd);
+    ssize_t ret = gfal_mem_preadG(plugin_data, fd, buff, count, mfd->offset, err);
+    if (ret > 0)
+        mfd->offset += ret;
+    return ret;
+}
+
+
+static ssize_t gfal_mem_writeG(plugin_handle plugin_data, gfal_file_handle fd, const void* buff, size_t count,
+    GError** err)
+{
+    MemFile* mfd = gfal_file_handle_get_fdesc(fd);
+    ssize_t ret = gfal_mem_pwriteG(plugin_data, fd, buff, count, mfd->offset, err);
+    if (ret > 0)
+        mfd->offset += ret;
+    return ret;
+}
+
+
+static off_t gfal_mem_lseekG(plugin_handle plugin_data, gfal_file_handle fd, off_t offset, int whence, GError** err)
+{
+    gfal_mem_plugin_t* mem = (gfal_mem_plugin_t*)plugin_data;
+    MemFile* mfd = gfal_file_handle_get_fdesc(fd);
+    switch (whence) {
+        case SEEK_SET:
+            mfd->offset = offset;
+            break;
+        case SEEK_END:
+            pthread_mutex_lock(&mem->lock);
+            mfd->offset = mfd->entry->size + offset;
+            pthread_mutex_unlock(&mem->lock);
+            break;
+        case SEEK_CUR:
+            mfd->offset += offset;
+            break;
+        default:
+            gfal2_set_error(err, gfal_mem_plugin_quark(), EINVAL, __func__, "Invalid whence");
+            return -1;
+    }
+    return mfd->offset;
+}
+
+
+static int gfal_mem_closeG(plugin_handle plugin_data, gfal_file_handle fd, GError** err)
+{
+    MemFile* mfd = gfal_file_handle_get_fdesc(fd);
+    mem_entry_unref(mfd->entry);
+    g_free(mfd);
+    gfal_file_handle_delete(fd);
+    return 0;
+}
+
+
+// Only bulk copies are handled by the plugin, single copies go through the
+// core streamed copy so its overhead can be measured
+static int gfal_mem_check_url_transfer(plugin_handle plugin_data, gfal2_context_t context,
+    const char* src, const char* dst, gfal_url2_check check)
+{
+    return check == GFAL_BULK_COPY && is_mem_uri(src) && is_mem_uri(dst);
+}
+
+
+typedef struct {
+    gfal_mem_plugin_t* mem;
+    const char* const* dsts;
+} MemBulkCopy;
+
+
+static int gfal_mem_copy_one(gfal2_context_t context, const char* src, int index, gpointer user_data, GError** err)
+{
+    MemBulkCopy* bulk = (MemBulkCopy*)user_data;
+    gfal_mem_plugin_t* mem = bulk->mem;
+    const char* dst = bulk->dsts[index];
+
+    if (mem_enter(mem, __func__, err) < 0)
+        return -1;
+
+    MemEntry* source = mem_lookup(mem, src);
+    if (!source || !S_ISREG(source->mode)) {
+        if (source)
+            mem_entry_unref(source);
+        mem_report_error(err, source ? EISDIR : ENOENT, __func__, src);
+        return -1;
+    }
+
+    MemEntry* copy = mem_entry_new(S_IFREG | 0644);
+    char buffer[64 * 1024];
+    off_t offset = 0;
+    ssize_t n;
+    while ((n = mem_read_at(mem, source, buffer, sizeof(buffer), offset)) > 0) {
+        mem_write_at(mem, copy, buffer, n, offset);
+        offset += n;
+    }
+    mem_entry_unref(source);
+    mem_throttle(mem, offset);
+
+    pthread_mutex_lock(&mem->lock);
+    mem_insert(mem, mem_key(dst), copy);
+    pthread_mutex_unlock(&mem->lock);
+    return 0;
+}
+
+
+static int gfal_mem_copy_bulk(plugin_handle plugin_data, gfal2_context_t context, gfalt_params_t params,
+    size_t nbfiles, const char* const* srcs, const char* const* dsts, const char* const* checksums,
+    GError** op_error, GError*** file_errors)
+{
+    if (nbfiles == 0 || srcs == NULL || dsts == NULL) {
+        gfal2_set_error(op_error, gfal_mem_plugin_quark(), EINVAL, __func__, "Invalid parameters");
+        return -1;
+    }
+
+    MemBulkCopy bulk;
+    bulk.mem = (gfal_mem_plugin_t*)plugin_data;
+    bulk.dsts = dsts;
+
+    *file_errors = g_new0(GError*, nbfiles);
+    // Like the other bulk copies, each failed file has its error, and the number of failures is returned negated
+    const int failed = gfal_plugin_fanout(context, nbfiles, srcs, gfal_mem_copy_one, &bulk, *file_errors);
+    return -failed;
+}
+
+
+gfal_mem_plugin_t* gfal_mem_plugin_new(void)
+{
+    gfal_mem_plugin_t* mem = g_new0(gfal_mem_plugin_t, 1);
+    mem->positional_io = TRUE;
+    pthread_mutex_init(&mem->lock, NULL);
+    pthread_mutex_init(&mem->bucket_lock, NULL);
+    mem->entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, mem_entry_unref);
+    return mem;
+}
+
+
+void gfal_mem_plugin_free(gfal_mem_plugin_t* mem)
+{
+    if (mem == NULL)
+        return;
+    g_hash_table_destroy(mem->entries);
+    pthread_mutex_destroy(&mem->bucket_lock);
+    pthread_mutex_destroy(&mem->lock);
+    g_free(mem);
+}
+
+
+int gfal_mem_plugin_register(gfal2_context_t context, gfal_mem_plugin_t* mem, GError** err)
+{
+    gfal_plugin_interface mem_plugin;
+    memset(&mem_plugin, 0, sizeof(gfal_plugin_interface));
+
+    // The store belongs to the caller, so there is no plugin_delete
+    mem_plugin.plugin_data = mem;
+    mem_plugin.check_plugin_url = gfal_mem_check_url;
+    mem_plugin.getName = gfal_mem_plugin_getName;
+
+    mem_plugin.statG = gfal_mem_statG;
+    mem_plugin.lstatG = gfal_mem_statG;
+    mem_plugin.accessG = gfal_mem_accessG;
+    mem_plugin.mkdirpG = gfal_mem_mkdirpG;
+    mem_plugin.unlinkG = gfal_mem_unlinkG;
+    mem_plugin.rmdirG = gfal_mem_rmdirG;
+
+    mem_plugin.opendirG = gfal_mem_opendirG;
+    mem_plugin.readdirG = gfal_mem_readdirG;
+    mem_plugin.readdirppG = gfal_mem_readdirppG;
+    mem_plugin.closedirG = gfal_mem_closedirG;
+
+    mem_plugin.openG = gfal_mem_openG;
+    mem_plugin.closeG = gfal_mem_closeG;
+    mem_plugin.readG = gfal_mem_readG;
+    mem_plugin.writeG = gfal_mem_writeG;
+    mem_plugin.lseekG = gfal_mem_lseekG;
+    if (mem->positional_io) {
+        mem_plugin.preadG = gfal_mem_preadG;
+        mem_plugin.pwriteG = gfal_mem_pwriteG;
+    }
+
+    mem_plugin.check_plugin_url_transfer = gfal_mem_check_url_transfer;
+    mem_plugin.copy_bulk = gfal_mem_copy_bulk;
+
+    return gfal2_register_plugin(context, &mem_plugin, err);
+}
+
+
+void gfal_mem_plugin_set_latency(gfal_mem_plugin_t* mem, guint64 usec)
+{
+    mem->latency = usec;
+}
+
+
+void gfal_mem_plugin_set_bandwidth(gfal_mem_plugin_t* mem, guint64 bytes_per_sec)
+{
+    pthread_mutex_lock(&mem->bucket_lock);
+    mem->bandwidth = bytes_per_sec;
+    mem->bucket_update = 0;
+    pthread_mutex_unlock(&mem->bucket_lock);
+}
+
+
+void gfal_mem_plugin_set_error_every(gfal_mem_plugin_t* mem, guint n)
+{
+    mem->error_every = n;
+    g_atomic_int_set(&mem->op_count, 0);
+}
+
+
+void gfal_mem_plugin_put(gfal_mem_plugin_t* mem, const char* url, size_t size)
+{
+    MemEntry* entry = mem_entry_new(S_IFREG | 0644);
+    entry->size = size;
+
+    pthread_mutex_lock(&mem->lock);
+    mem_insert(mem, mem_key(url), entry);
+    pthread_mutex_unlock(&mem->lock);
+}
+
+
+void gfal_mem_plugin_set_positional_io(gfal_mem_plugin_t* mem, gboolean enabled)
+{
+    mem->positional_io = enabled;
+}
+
+
+void gfal_mem_plugin_put_data(gfal_mem_plugin_t* mem, const char* url, const void* data, size_t size)
+{
+    MemEntry* entry = mem_entry_new(S_IFREG | 0644);
+    mem_write_at(mem, entry, data, size, 0);
+
+    pthread_mutex_lock(&mem->lock);
+    mem_insert(mem, mem_key(url), entry);
+    pthread_mutex_unlock(&mem->lock);
+}
+
+
+char* gfal_mem_plugin_get_data(gfal_mem_plugin_t* mem, const char* url, size_t* size)
+{
+    MemEntry* entry = mem_lookup(mem, url);
+    if (!entry || !S_ISREG(entry->mode)) {
+        if (entry)
+            mem_entry_unref(entry);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&mem->lock);
+    *size = entry->size;
+    pthread_mutex_unlock(&mem->lock);
+
+    char* data = g_malloc(*size + 1);
+    mem_read_at(mem, entry, data, *size, 0);
+    mem_entry_unref(entry);
+    return data;
+}
+
+
+guint gfal_mem_plugin_get_max_concurrent_reads(gfal_mem_plugin_t* mem)
+{
+    pthread_mutex_lock(&mem->lock);
+    const guint max_active = mem->reads_max_active;
+    mem->reads_max_active = mem->reads_active;
+    pthread_mutex_unlock(&mem->lock);
+    return max_active;
+}
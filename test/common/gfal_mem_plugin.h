@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef GFAL_MEM_PLUGIN_H_
+#define GFAL_MEM_PLUGIN_H_
+
+#include <gfal_plugins_api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * In-process plugin serving mem:// urls from memory
+ * Latency, bandwidth and failures are deterministic, so the overhead of
+ * the core can be measured without any real storage
+ */
+typedef struct gfal_mem_plugin gfal_mem_plugin_t;
+
+gfal_mem_plugin_t* gfal_mem_plugin_new(void);
+
+void gfal_mem_plugin_free(gfal_mem_plugin_t* mem);
+
+// Register the plugin into the context. The same store can be shared by several contexts
+int gfal_mem_plugin_register(gfal2_context_t context, gfal_mem_plugin_t* mem, GError** err);
+
+// Added latency, in microseconds, to each operation
+void gfal_mem_plugin_set_latency(gfal_mem_plugin_t* mem, guint64 usec);
+
+// Bandwidth cap, in bytes per second, shared by all read and write operations. 0 means unlimited
+void gfal_mem_plugin_set_bandwidth(gfal_mem_plugin_t* mem, guint64 bytes_per_sec);
+
+// Fail one every n operations with EIO. 0 means never
+void gfal_mem_plugin_set_error_every(gfal_mem_plugin_t* mem, guint n);
+
+// Create, or replace, a file of the given size without going through the plugin interface
+void gfal_mem_plugin_put(gfal_mem_plugin_t* mem, const char* url, size_t size);
+
+// Whether pread and pwrite are registered. Only contexts registered afterwards are affected
+void gfal_mem_plugin_set_positional_io(gfal_mem_plugin_t* mem, gboolean enabled);
+
+// Create, or replace, a file with the given content
+void gfal_mem_plugin_put_data(gfal_mem_plugin_t* mem, const char* url, const void* data, size_t size);
+
+// Copy of the content of a file, to be freed with g_free, or NULL if it does not exist
+char* gfal_mem_plugin_get_data(gfal_mem_plugin_t* mem, const char* url, size_t* size);
+
+// Highest number of concurrent preads since the previous call
+guint gfal_mem_plugin_get_max_concurrent_reads(gfal_mem_plugin_t* mem);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GFAL_MEM_PLUGIN_H_ */
@@ -211,6 +211,36 @@ TEST_F(DeleteTest, BulkDeletionIsDir)
     }
 }
 
+TEST_F(DeleteTest, BulkStatOddFail)
+{
+    int ret;
+
+    // Remove odd files to force an error
+    for (int i = 0; i < N_FILES; ++i) {
+        GError* err = NULL;
+        if (i % 2) {
+            ret = gfal2_unlink(context, files[i], &err);
+            EXPECT_PRED_FORMAT2(AssertGfalSuccess, ret, err);
+        }
+    }
+
+    struct stat buffers[N_FILES];
+    GError *errors[N_FILES] = {0};
+    ret = gfal2_stat_list(context, N_FILES, files, buffers, errors);
+    EXPECT_LT(ret, 0);
+
+    for (int i = 0; i < N_FILES; ++i) {
+        if (i % 2) {
+            EXPECT_PRED_FORMAT3(AssertGfalErrno, -1, errors[i], ENOENT);
+        }
+        else {
+            EXPECT_EQ(NULL, errors[i]);
+            EXPECT_TRUE(S_ISREG(buffers[i].st_mode));
+            EXPECT_GT(buffers[i].st_size, 0);
+        }
+    }
+}
+
 const char* DeleteTest::root;
 
 int main(int argc, char** argv)
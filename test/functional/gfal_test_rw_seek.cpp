@@ -129,6 +129,54 @@ TEST_F(RwSeekTest, ReadSeek)
 }
 
 
+// Sequential preads, served by a single partial transfer, then jumps around
+TEST_F(RwSeekTest, PreadPattern)
+{
+    char buffer[file_size];
+    long i;
+    for (i = 0; i < file_size; ++i)
+        buffer[i] = i * 7;
+
+    GError* error = NULL;
+    int fd = gfal2_open(context, surl, O_WRONLY | O_CREAT, &error);
+    EXPECT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+
+    int ret = gfal2_write(context, fd, buffer, sizeof(buffer), &error);
+    ASSERT_NE(-1, ret);
+    EXPECT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+
+    ret = gfal2_close(context, fd, &error);
+    EXPECT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+
+    fd = gfal2_open(context, surl, O_RDONLY, &error);
+    EXPECT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+
+    char read_buffer[block_size];
+    for (i = 0; i + block_size <= file_size; i += block_size) {
+        ssize_t r = gfal2_pread(context, fd, read_buffer, block_size, i, &error);
+        EXPECT_PRED_FORMAT2(AssertGfalSuccess, r, error);
+        ASSERT_EQ(block_size, r);
+        ASSERT_EQ(0, memcmp(buffer + i, read_buffer, block_size));
+    }
+
+    const off_t offsets[] = {file_size / 2, 0, file_size - block_size, file_size / 3};
+    for (size_t k = 0; k < sizeof(offsets) / sizeof(offsets[0]); ++k) {
+        ssize_t r = gfal2_pread(context, fd, read_buffer, block_size, offsets[k], &error);
+        EXPECT_PRED_FORMAT2(AssertGfalSuccess, r, error);
+        ASSERT_EQ(block_size, r);
+        ASSERT_EQ(0, memcmp(buffer + offsets[k], read_buffer, block_size));
+    }
+
+    // Past the end of the file
+    ssize_t r = gfal2_pread(context, fd, read_buffer, block_size, file_size - block_size / 2, &error);
+    EXPECT_PRED_FORMAT2(AssertGfalSuccess, r, error);
+    ASSERT_EQ(block_size / 2, r);
+
+    ret = gfal2_close(context, fd, &error);
+    EXPECT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+}
+
+
 int main(int argc, char** argv)
 {
     testing::InitGoogleTest(&argc, argv);
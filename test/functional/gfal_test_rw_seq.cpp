@@ -61,7 +61,8 @@ long RwSeqTest::block_size = 0;
 long RwSeqTest::file_size = 0;
 
 
-TEST_F(RwSeqTest, WriteReadSeq)
+// Write and read back the file sequentially, and check the contents
+static void write_read_seq(gfal2_context_t context, const char* surl, long block_size, long file_size)
 {
     // Create
     char buffer[file_size];
@@ -99,6 +100,8 @@ TEST_F(RwSeqTest, WriteReadSeq)
 
         ret = gfal2_read(context, fd, read_buffer + i, j, &error);
         EXPECT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+        if (ret <= 0)
+            break;
 
         i += (long) ret;
     }
@@ -107,10 +110,32 @@ TEST_F(RwSeqTest, WriteReadSeq)
     EXPECT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
 
     // Compare
+    EXPECT_EQ(file_size, i);
     EXPECT_EQ(0, memcmp(buffer, read_buffer, file_size));
 }
 
 
+TEST_F(RwSeqTest, WriteReadSeq)
+{
+    write_read_seq(context, surl, block_size, file_size);
+}
+
+
+// Only meaningful for gsiftp, the others ignore the option
+TEST_F(RwSeqTest, WriteReadSeqStreamBuffers)
+{
+    gfal2_set_opt_integer(context, "GRIDFTP PLUGIN", "STREAM_BUFFERS", 1, NULL);
+    write_read_seq(context, surl, block_size, file_size);
+
+    GError* error = NULL;
+    gfal2_unlink(context, surl, &error);
+    g_clear_error(&error);
+
+    gfal2_set_opt_integer(context, "GRIDFTP PLUGIN", "STREAM_BUFFERS", 8, NULL);
+    write_read_seq(context, surl, block_size, file_size);
+}
+
+
 int main(int argc, char** argv)
 {
     testing::InitGoogleTest(&argc, argv);
@@ -20,6 +20,8 @@
 
 #include <gfal_api.h>
 #include <gtest/gtest.h>
+#include <poll.h>
+#include <pthread.h>
 
 
 TEST(gfalCancel, test_cancel_simple){
@@ -65,3 +67,96 @@ TEST(gfalGlobal, testCancelCallback){
 }
 
 
+
+
+struct CancelScope {
+    gfal2_context_t context;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool started;
+    int woken;
+};
+
+static void* cancel_scope_thread(void* data)
+{
+    CancelScope* scope = (CancelScope*)data;
+    gfal2_start_scope_cancel(scope->context, NULL);
+
+    pthread_mutex_lock(&scope->lock);
+    scope->started = true;
+    pthread_cond_signal(&scope->cond);
+    pthread_mutex_unlock(&scope->lock);
+
+    struct pollfd fd;
+    fd.fd = gfal2_cancel_get_fd(scope->context);
+    fd.events = POLLIN;
+    scope->woken = poll(&fd, 1, 10000);
+
+    gfal2_end_scope_cancel(scope->context);
+    return NULL;
+}
+
+TEST(gfalCancel, testCancelWaitsForScope){
+    GError* tmp_err=NULL;
+    gfal2_context_t c = gfal2_context_new(&tmp_err);
+    ASSERT_TRUE(c != NULL);
+
+    int fd = gfal2_cancel_get_fd(c);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(gfal2_cancel_get_fd(c), fd);
+
+    CancelScope scope;
+    scope.context = c;
+    pthread_mutex_init(&scope.lock, NULL);
+    pthread_cond_init(&scope.cond, NULL);
+    scope.started = false;
+    scope.woken = 0;
+
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, cancel_scope_thread, &scope), 0);
+    pthread_mutex_lock(&scope.lock);
+    while (!scope.started)
+        pthread_cond_wait(&scope.cond, &scope.lock);
+    pthread_mutex_unlock(&scope.lock);
+
+    // Returns once the thread has been woken up by the fd, and left its scope
+    ASSERT_EQ(gfal2_cancel(c), 1);
+    ASSERT_EQ(scope.woken, 1);
+    pthread_join(thread, NULL);
+
+    // The fd is not readable anymore, and new operations can run
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    ASSERT_EQ(poll(&pfd, 1, 0), 0);
+    ASSERT_FALSE(gfal2_is_canceled(c));
+    ASSERT_EQ(gfal2_start_scope_cancel(c, NULL), 0);
+    gfal2_end_scope_cancel(c);
+
+    pthread_mutex_destroy(&scope.lock);
+    pthread_cond_destroy(&scope.cond);
+    gfal2_context_free(c);
+}
+
+
+static void cancel_hook_get_fd(gfal2_context_t context, void* userdata)
+{
+    int* fd = (int*)userdata;
+    *fd = gfal2_cancel_get_fd(context);
+}
+
+TEST(gfalCancel, testGetFdFromHook){
+    GError* tmp_err=NULL;
+    gfal2_context_t c = gfal2_context_new(&tmp_err);
+    ASSERT_TRUE(c != NULL);
+
+    int fd = -1;
+    gfal_cancel_token_t tok = gfal2_register_cancel_callback(c, &cancel_hook_get_fd, &fd);
+    ASSERT_TRUE(tok != NULL);
+    ASSERT_EQ(gfal2_cancel(c), 0);
+    ASSERT_EQ(fd, gfal2_cancel_get_fd(c));
+    ASSERT_GE(fd, 0);
+
+    gfal2_remove_cancel_callback(c, tok);
+    gfal2_context_free(c);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+
+#include <utils/checksums/checksum_kernels.h>
+
+
+static std::string kernelDigest(const gfal2_checksum_kernel_t *kernel, const void *data, size_t size,
+    size_t step = 0)
+{
+    std::vector<char> ctx(kernel->ctx_size);
+    char hex[129];
+
+    kernel->init(ctx.data());
+    if (step == 0) {
+        kernel->update(ctx.data(), data, size);
+    }
+    else {
+        const char *p = static_cast<const char*>(data);
+        for (size_t done = 0; done < size; done += step) {
+            kernel->update(ctx.data(), p + done, std::min(step, size - done));
+        }
+    }
+    EXPECT_EQ(0, kernel->final(ctx.data(), hex, sizeof(hex)));
+    return hex;
+}
+
+
+static bool kernelSupported(const gfal2_checksum_kernel_t *kernel)
+{
+    return kernel->supported == NULL || kernel->supported();
+}
+
+
+TEST(ChecksumKernels, KnownValues)
+{
+    struct {
+        const char *algorithm, *input, *expected;
+    } vectors[] = {
+        {"crc32c", "123456789", "e3069283"},
+        {"crc32c", "", "00000000"},
+        {"md5", "", "d41d8cd98f00b204e9800998ecf8427e"},
+        {"md5", "abc", "900150983cd24fb0d6963f7d28e17f72"},
+        {"sha256", "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+        {"sha256", "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+        {"sha256", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+    };
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); ++i) {
+        for (size_t k = 0; const gfal2_checksum_kernel_t *kernel = gfal2_checksum_kernel_get(k); ++k) {
+            if (strcmp(kernel->name, vectors[i].algorithm) != 0 || !kernelSupported(kernel))
+                continue;
+            EXPECT_EQ(vectors[i].expected, kernelDigest(kernel, vectors[i].input, strlen(vectors[i].input)))
+                << kernel->name << "/" << kernel->implementation << " '" << vectors[i].input << "'";
+        }
+    }
+}
+
+
+TEST(ChecksumKernels, Find)
+{
+    const gfal2_checksum_kernel_t *kernel = gfal2_checksum_kernel_find("SHA256");
+    ASSERT_NE((void *) NULL, kernel);
+    EXPECT_STREQ("sha256", kernel->name);
+    EXPECT_EQ(NULL, gfal2_checksum_kernel_find("nope"));
+    EXPECT_EQ(NULL, gfal2_checksum_kernel_find(NULL));
+}
+
+
+// All the implementations of an algorithm must agree, for any split of the input
+TEST(ChecksumKernels, ImplementationsAgree)
+{
+    std::vector<unsigned char> data(1 << 20);
+    srand(1234);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = rand() % 256;
+    }
+
+    const size_t steps[] = {0, 1, 3, 63, 64, 65, 4095};
+    for (size_t k = 0; const gfal2_checksum_kernel_t *kernel = gfal2_checksum_kernel_get(k); ++k) {
+        if (!kernelSupported(kernel))
+            continue;
+        const gfal2_checksum_kernel_t *reference = gfal2_checksum_kernel_find(kernel->name);
+        // Offset by one to exercise unaligned input
+        const std::string expected = kernelDigest(reference, data.data() + 1, data.size() - 1);
+        for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); ++s) {
+            EXPECT_EQ(expected, kernelDigest(kernel, data.data() + 1, data.size() - 1, steps[s]))
+                << kernel->name << "/" << kernel->implementation << " step " << steps[s];
+        }
+    }
+}
+
+
+TEST(ChecksumKernels, Throughput)
+{
+    std::vector<unsigned char> data(64 << 20, 0x5a);
+
+    for (size_t k = 0; const gfal2_checksum_kernel_t *kernel = gfal2_checksum_kernel_get(k); ++k) {
+        if (!kernelSupported(kernel))
+            continue;
+
+        struct timeval start, end;
+        gettimeofday(&start, NULL);
+        kernelDigest(kernel, data.data(), data.size());
+        gettimeofday(&end, NULL);
+
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+        double gbps = (data.size() / 1e9) / (elapsed > 0 ? elapsed : 1e-9);
+        std::string property = std::string(kernel->name) + "/" + kernel->implementation;
+        RecordProperty(property.c_str(), std::to_string(gbps));
+        printf("%-20s %8.2f GB/s\n", property.c_str(), gbps);
+    }
+}
@@ -119,4 +119,30 @@ TEST_F(ConfigFixture, KeyList)
     EXPECT_EQ(NULL, keys[2]);
 
     g_strfreev(keys);
-}
\ No newline at end of file
+}
+
+TEST_F(ConfigFixture, Serial)
+{
+    GError *error = NULL;
+
+    guint serial = gfal2_get_opt_serial(context);
+    EXPECT_EQ(serial, gfal2_get_opt_serial(context));
+
+    gfal2_set_opt_boolean(context, "GROUP1", "KEY1", TRUE, &error);
+    EXPECT_NE(serial, gfal2_get_opt_serial(context));
+    serial = gfal2_get_opt_serial(context);
+
+    gfal2_remove_opt(context, "GROUP1", "KEY1", &error);
+    g_clear_error(&error);
+    EXPECT_NE(serial, gfal2_get_opt_serial(context));
+    serial = gfal2_get_opt_serial(context);
+
+    gfal2_cred_t *cred = gfal2_cred_new(GFAL_CRED_X509_CERT, "/tmp/cert");
+    gfal2_cred_set(context, "root://host", cred, &error);
+    gfal2_cred_free(cred);
+    EXPECT_NE(serial, gfal2_get_opt_serial(context));
+    serial = gfal2_get_opt_serial(context);
+
+    gfal2_cred_clean(context, &error);
+    EXPECT_NE(serial, gfal2_get_opt_serial(context));
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <zlib.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "gfal_file_plugin.h"
+
+
+class FileChecksumTest: public testing::Test {
+public:
+    char path[64];
+    int fd;
+    std::vector<unsigned char> content;
+
+    virtual void SetUp() {
+        strcpy(path, "/tmp/gfal2_file_checksum_XXXXXX");
+        fd = mkstemp(path);
+        ASSERT_GE(fd, 0);
+        srand(42);
+    }
+
+    virtual void TearDown() {
+        close(fd);
+        unlink(path);
+    }
+
+    void Fill(size_t size) {
+        content.resize(size);
+        for (size_t i = 0; i < size; ++i) {
+            content[i] = rand() % 256;
+        }
+        ASSERT_EQ((ssize_t)size, pwrite(fd, content.data(), size, 0));
+    }
+
+    // Reference value, computed serially
+    unsigned long Serial(bool is_adler32, off_t offset, off_t length) {
+        const Bytef *data = content.data() + offset;
+        if (is_adler32)
+            return adler32(adler32(0L, Z_NULL, 0), data, length);
+        return crc32(crc32(0L, Z_NULL, 0), data, length);
+    }
+};
+
+
+TEST_F(FileChecksumTest, MatchesSerial)
+{
+    Fill(1 << 20);
+
+    const off_t chunk_sizes[] = {1, 1000, 4096, 65537, 1 << 20, 1 << 21};
+    const int nthreads[] = {1, 2, 3, 8};
+
+    for (int round = 0; round < 20; ++round) {
+        const bool is_adler32 = (round % 2 == 0);
+        const off_t offset = rand() % 1024;
+        const off_t length = rand() % (content.size() - offset);
+        const off_t chunk_size = (round < 2) ? 1 : chunk_sizes[rand() % G_N_ELEMENTS(chunk_sizes)];
+        const int threads = nthreads[rand() % G_N_ELEMENTS(nthreads)];
+
+        // Keep the one byte chunk cases small
+        const off_t effective_length = (chunk_size == 1) ? MIN(length, 5000) : length;
+
+        unsigned long value = 0;
+        GError *error = NULL;
+        int ret = gfal_file_checksum_parallel(fd, is_adler32, offset, effective_length,
+            chunk_size, threads, &value, &error);
+        ASSERT_EQ(0, ret);
+        ASSERT_EQ(NULL, error);
+        EXPECT_EQ(Serial(is_adler32, offset, effective_length), value)
+            << (is_adler32 ? "adler32" : "crc32") << " offset=" << offset << " length=" << effective_length
+            << " chunk=" << chunk_size << " threads=" << threads;
+    }
+}
+
+
+TEST_F(FileChecksumTest, Empty)
+{
+    unsigned long value = 1234;
+    GError *error = NULL;
+    ASSERT_EQ(0, gfal_file_checksum_parallel(fd, TRUE, 0, 0, 4096, 4, &value, &error));
+    EXPECT_EQ(adler32(0L, Z_NULL, 0), value);
+    ASSERT_EQ(0, gfal_file_checksum_parallel(fd, FALSE, 0, 0, 4096, 4, &value, &error));
+    EXPECT_EQ(crc32(0L, Z_NULL, 0), value);
+}
+
+
+TEST_F(FileChecksumTest, ShortFile)
+{
+    Fill(10000);
+
+    unsigned long value = 0;
+    GError *error = NULL;
+    int ret = gfal_file_checksum_parallel(fd, TRUE, 0, 20000, 4096, 4, &value, &error);
+    EXPECT_EQ(-1, ret);
+    ASSERT_NE((void *) NULL, error);
+    EXPECT_EQ(EIO, error->code);
+    g_error_free(error);
+}
+
+
+TEST_F(FileChecksumTest, CacheHit)
+{
+    Fill(4096);
+
+    struct stat st;
+    ASSERT_EQ(0, fstat(fd, &st));
+
+    char value[64];
+    EXPECT_EQ(-1, gfal_file_checksum_cache_get(path, "ADLER32", &st, value, sizeof(value)));
+
+    if (gfal_file_checksum_cache_set(path, "ADLER32", &st, "0badcafe") < 0) {
+        // The file system does not support user extended attributes
+        EXPECT_EQ(-1, gfal_file_checksum_cache_get(path, "ADLER32", &st, value, sizeof(value)));
+        return;
+    }
+
+    ASSERT_EQ(0, gfal_file_checksum_cache_get(path, "adler32", &st, value, sizeof(value)));
+    EXPECT_STREQ("0badcafe", value);
+    // Other algorithms are independent
+    EXPECT_EQ(-1, gfal_file_checksum_cache_get(path, "md5", &st, value, sizeof(value)));
+    // Buffer too short
+    EXPECT_EQ(-1, gfal_file_checksum_cache_get(path, "adler32", &st, value, 4));
+}
+
+
+TEST_F(FileChecksumTest, CacheInvalidation)
+{
+    Fill(4096);
+
+    struct stat st;
+    ASSERT_EQ(0, fstat(fd, &st));
+    if (gfal_file_checksum_cache_set(path, "adler32", &st, "0badcafe") < 0)
+        return;
+
+    // Modify the file
+    ASSERT_EQ(1, pwrite(fd, "x", 1, 4096));
+    struct stat st_modified;
+    ASSERT_EQ(0, fstat(fd, &st_modified));
+
+    char value[64];
+    EXPECT_EQ(-1, gfal_file_checksum_cache_get(path, "adler32", &st_modified, value, sizeof(value)));
+
+    // A stale state is not stored
+    EXPECT_EQ(-1, gfal_file_checksum_cache_set(path, "adler32", &st, "0badcafe"));
+}
+
+
+TEST_F(FileChecksumTest, CacheMissingFile)
+{
+    struct stat st;
+    ASSERT_EQ(0, fstat(fd, &st));
+    unlink(path);
+
+    char value[64];
+    EXPECT_EQ(-1, gfal_file_checksum_cache_set(path, "adler32", &st, "0badcafe"));
+    EXPECT_EQ(-1, gfal_file_checksum_cache_get(path, "adler32", &st, value, sizeof(value)));
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+#include <gfal_api.h>
+#include <transfer/gfal_transfer.h>
+
+#include "gfal_file_plugin.h"
+
+
+// Fake kernel calls: each one fails with its errno if set, otherwise copies
+// at most max bytes per call, and nothing from offset stop onwards
+struct FakeMethod {
+    int errcode;
+    size_t max;
+    off_t stop;
+    int calls;
+};
+
+static int clone_errno;
+static FakeMethod fake_range, fake_sendfile;
+
+
+static ssize_t fake_copy(FakeMethod& method, int fd_src, int fd_dst, off_t offset, size_t len)
+{
+    method.calls++;
+    if (method.errcode) {
+        errno = method.errcode;
+        return -1;
+    }
+    if (method.stop >= 0 && offset >= method.stop)
+        return 0;
+
+    std::vector<char> buffer(std::min(len, method.max));
+    ssize_t n = pread(fd_src, buffer.data(), buffer.size(), offset);
+    if (n > 0 && pwrite(fd_dst, buffer.data(), n, offset) != n)
+        return -1;
+    return n;
+}
+
+
+static int fake_clone_func(int, int)
+{
+    errno = clone_errno;
+    return -1;
+}
+
+
+static ssize_t fake_range_func(int fd_src, int fd_dst, off_t offset, size_t len)
+{
+    return fake_copy(fake_range, fd_src, fd_dst, offset, len);
+}
+
+
+static ssize_t fake_sendfile_func(int fd_src, int fd_dst, off_t offset, size_t len)
+{
+    return fake_copy(fake_sendfile, fd_src, fd_dst, offset, len);
+}
+
+
+static const gfal_file_copy_ops_t fake_ops = {
+    fake_clone_func,
+    fake_range_func,
+    fake_sendfile_func
+};
+
+
+class FileCopyTest: public testing::Test {
+public:
+    char src[64], dst[64];
+    int fd_src, fd_dst;
+    std::vector<char> content;
+    gfal2_context_t context;
+    gfalt_params_t params;
+
+    virtual void SetUp() {
+        strcpy(src, "/tmp/gfal2_file_copy_src_XXXXXX");
+        strcpy(dst, "/tmp/gfal2_file_copy_dst_XXXXXX");
+        fd_src = mkstemp(src);
+        fd_dst = mkstemp(dst);
+        ASSERT_GE(fd_src, 0);
+        ASSERT_GE(fd_dst, 0);
+        srand(42);
+
+        context = gfal2_context_new(NULL);
+        ASSERT_NE((void*)NULL, context);
+        gfal2_set_opt_integer(context, "CORE", "COPY_BUFFERSIZE", 65536, NULL);
+        params = gfalt_params_handle_new(NULL);
+
+        clone_errno = EOPNOTSUPP;
+        fake_range.errcode = fake_sendfile.errcode = 0;
+        fake_range.max = fake_sendfile.max = 1 << 20;
+        fake_range.stop = fake_sendfile.stop = -1;
+        fake_range.calls = fake_sendfile.calls = 0;
+    }
+
+    virtual void TearDown() {
+        gfalt_params_handle_delete(params, NULL);
+        gfal2_context_free(context);
+        close(fd_src);
+        close(fd_dst);
+        unlink(src);
+        unlink(dst);
+    }
+
+    void Fill(size_t size) {
+        content.resize(size);
+        for (size_t i = 0; i < size; ++i) {
+            content[i] = rand() % 256;
+        }
+        ASSERT_EQ((ssize_t)size, pwrite(fd_src, content.data(), size, 0));
+    }
+
+    ssize_t Copy(off_t size, const gfal_file_copy_ops_t* ops, gfal_file_copy_method_t* method, GError** err) {
+        return gfal_file_copy_fd(context, params, src, dst, fd_src, fd_dst, size, ops, method, err);
+    }
+
+    void ExpectCopied() {
+        std::vector<char> copied(content.size() + 1);
+        EXPECT_EQ((ssize_t)content.size(), pread(fd_dst, copied.data(), copied.size(), 0));
+        copied.resize(content.size());
+        EXPECT_TRUE(copied == content);
+    }
+};
+
+
+TEST_F(FileCopyTest, KernelOffload)
+{
+    Fill(3 * 1000 * 1000 + 17);
+
+    GError* err = NULL;
+    gfal_file_copy_method_t method;
+    ASSERT_EQ((ssize_t)content.size(), Copy(content.size(), NULL, &method, &err)) << (err ? err->message : "");
+    ExpectCopied();
+#ifdef __linux__
+    // sendfile is always possible between two regular files
+    EXPECT_NE(FILE_COPY_READ_WRITE, method);
+#endif
+}
+
+
+TEST_F(FileCopyTest, ShortCopies)
+{
+    Fill(100 * 1000 + 1);
+    fake_range.max = 1000;
+
+    GError* err = NULL;
+    gfal_file_copy_method_t method;
+    ASSERT_EQ((ssize_t)content.size(), Copy(content.size(), &fake_ops, &method, &err)) << (err ? err->message : "");
+    ExpectCopied();
+    EXPECT_EQ(FILE_COPY_RANGE, method);
+    EXPECT_EQ(101, fake_range.calls);
+    EXPECT_EQ(0, fake_sendfile.calls);
+}
+
+
+TEST_F(FileCopyTest, Fallback)
+{
+    Fill(300 * 1000);
+    fake_range.errcode = EXDEV;
+    fake_sendfile.errcode = ENOSYS;
+
+    GError* err = NULL;
+    gfal_file_copy_method_t method;
+    ASSERT_EQ((ssize_t)content.size(), Copy(content.size(), &fake_ops, &method, &err)) << (err ? err->message : "");
+    ExpectCopied();
+    EXPECT_EQ(FILE_COPY_READ_WRITE, method);
+    EXPECT_EQ(1, fake_range.calls);
+    EXPECT_EQ(1, fake_sendfile.calls);
+}
+
+
+TEST_F(FileCopyTest, FallbackMidway)
+{
+    // copy_file_range stops moving data half way, sendfile goes on from there
+    Fill(1000 * 1000);
+    fake_range.max = 4096;
+    fake_range.stop = 100 * 4096;
+    fake_sendfile.max = 7000;
+
+    GError* err = NULL;
+    gfal_file_copy_method_t method;
+    ASSERT_EQ((ssize_t)content.size(), Copy(content.size(), &fake_ops, &method, &err)) << (err ? err->message : "");
+    ExpectCopied();
+    EXPECT_EQ(FILE_COPY_SENDFILE, method);
+    EXPECT_EQ(101, fake_range.calls);
+    EXPECT_EQ((int)((content.size() - 100 * 4096 + 6999) / 7000), fake_sendfile.calls);
+}
+
+
+TEST_F(FileCopyTest, NoFallbackOnError)
+{
+    Fill(10000);
+    fake_range.errcode = EIO;
+
+    GError* err = NULL;
+    gfal_file_copy_method_t method;
+    ASSERT_EQ(-1, Copy(content.size(), &fake_ops, &method, &err));
+    ASSERT_NE((void*)NULL, err);
+    EXPECT_EQ(EIO, err->code);
+    EXPECT_EQ(FILE_COPY_RANGE, method);
+    EXPECT_EQ(0, fake_sendfile.calls);
+    g_clear_error(&err);
+}
+
+
+TEST_F(FileCopyTest, UnknownSize)
+{
+    // Only read until the end of file, without trying the offloaded methods
+    Fill(200 * 1000);
+
+    GError* err = NULL;
+    gfal_file_copy_method_t method;
+    ASSERT_EQ((ssize_t)content.size(), Copy(-1, &fake_ops, &method, &err)) << (err ? err->message : "");
+    ExpectCopied();
+    EXPECT_EQ(FILE_COPY_READ_WRITE, method);
+    EXPECT_EQ(0, fake_range.calls);
+}
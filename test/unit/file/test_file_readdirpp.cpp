@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <map>
+#include <string>
+
+#include "gfal_file_plugin.h"
+
+
+class FileReaddirppTest: public testing::Test {
+public:
+    char path[64];
+
+    virtual void SetUp() {
+        strcpy(path, "/tmp/gfal2_file_readdirpp_XXXXXX");
+        ASSERT_NE((char*)NULL, mkdtemp(path));
+    }
+
+    virtual void TearDown() {
+        DIR* dir = opendir(path);
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            std::string full = std::string(path) + "/" + entry->d_name;
+            if (entry->d_name[0] != '.')
+                (entry->d_type == DT_DIR) ? rmdir(full.c_str()) : unlink(full.c_str());
+        }
+        closedir(dir);
+        rmdir(path);
+    }
+};
+
+
+TEST_F(FileReaddirppTest, MatchesStat)
+{
+    for (int i = 0; i < 100; ++i) {
+        char name[128];
+        snprintf(name, sizeof(name), "%s/file%d", path, i);
+        int fd = open(name, O_CREAT | O_WRONLY, 0644);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(0, ftruncate(fd, i * 100));
+        close(fd);
+    }
+    std::string subdir = std::string(path) + "/subdir";
+    ASSERT_EQ(0, mkdir(subdir.c_str(), 0755));
+    std::string link = std::string(path) + "/link";
+    ASSERT_EQ(0, symlink("file10", link.c_str()));
+
+    std::string url = std::string("file://") + path;
+    GError* err = NULL;
+    gfal_file_handle fh = gfal_plugin_file_opendir(NULL, url.c_str(), &err);
+    ASSERT_NE((void*)NULL, fh);
+
+    std::map<std::string, struct stat> listed;
+    struct stat st;
+    struct dirent* entry;
+    while ((entry = gfal_plugin_file_readdirpp(NULL, fh, &st, &err)) != NULL) {
+        listed[entry->d_name] = st;
+    }
+    EXPECT_EQ(NULL, err);
+    EXPECT_EQ(0, gfal_plugin_file_closedir(NULL, fh, &err));
+
+    // 100 files, subdir, link, . and ..
+    EXPECT_EQ(104u, listed.size());
+    for (std::map<std::string, struct stat>::iterator i = listed.begin(); i != listed.end(); ++i) {
+        struct stat expected;
+        std::string full = std::string(path) + "/" + i->first;
+        ASSERT_EQ(0, stat(full.c_str(), &expected));
+        EXPECT_EQ(expected.st_ino, i->second.st_ino) << i->first;
+        EXPECT_EQ(expected.st_mode, i->second.st_mode) << i->first;
+        EXPECT_EQ(expected.st_size, i->second.st_size) << i->first;
+    }
+    // Symlinks are followed, as stat does
+    EXPECT_TRUE(S_ISREG(listed["link"].st_mode));
+    EXPECT_TRUE(S_ISDIR(listed["subdir"].st_mode));
+}
+
+
+TEST_F(FileReaddirppTest, DanglingLink)
+{
+    std::string link = std::string(path) + "/dangling";
+    ASSERT_EQ(0, symlink("missing", link.c_str()));
+
+    std::string url = std::string("file://") + path;
+    GError* err = NULL;
+    gfal_file_handle fh = gfal_plugin_file_opendir(NULL, url.c_str(), &err);
+    ASSERT_NE((void*)NULL, fh);
+
+    struct stat st;
+    while (gfal_plugin_file_readdirpp(NULL, fh, &st, &err) != NULL)
+        ;
+    // Same as stat on the entry
+    ASSERT_NE((void*)NULL, err);
+    EXPECT_EQ(ENOENT, err->code);
+    g_clear_error(&err);
+    gfal_plugin_file_closedir(NULL, fh, NULL);
+}
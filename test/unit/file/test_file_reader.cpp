@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "gfal_file_plugin.h"
+
+
+class FileReaderTest: public testing::Test {
+public:
+    char path[64];
+    int fd;
+    std::vector<char> content;
+
+    virtual void SetUp() {
+        strcpy(path, "/tmp/gfal2_file_reader_XXXXXX");
+        fd = mkstemp(path);
+        ASSERT_GE(fd, 0);
+        srand(42);
+    }
+
+    virtual void TearDown() {
+        close(fd);
+        unlink(path);
+    }
+
+    void Fill(size_t size) {
+        content.resize(size);
+        for (size_t i = 0; i < size; ++i) {
+            content[i] = rand() % 256;
+        }
+        ASSERT_EQ((ssize_t)size, pwrite(fd, content.data(), size, 0));
+    }
+};
+
+
+TEST_F(FileReaderTest, SequentialRead)
+{
+    const size_t sizes[] = {0, 1, 4096, 65536, 65537, 300000};
+
+    for (size_t s = 0; s < G_N_ELEMENTS(sizes); ++s) {
+        Fill(sizes[s]);
+        ASSERT_EQ(0, ftruncate(fd, sizes[s]));
+
+        gfal_file_reader_t* reader = gfal_file_reader_new(fd, 3, 4096);
+        if (reader == NULL) {
+            std::cout << "io_uring not available, skipping" << std::endl;
+            return;
+        }
+
+        std::vector<char> read_back;
+        char buffer[7000];
+        ssize_t ret;
+        do {
+            ret = gfal_file_reader_read(reader, buffer, 1 + rand() % sizeof(buffer));
+            ASSERT_GE(ret, 0);
+            read_back.insert(read_back.end(), buffer, buffer + ret);
+        } while (ret > 0);
+
+        EXPECT_EQ(content, read_back);
+        // Once at the end, keep returning 0
+        EXPECT_EQ(0, gfal_file_reader_read(reader, buffer, sizeof(buffer)));
+        gfal_file_reader_free(reader);
+    }
+}
+
+
+TEST_F(FileReaderTest, Seek)
+{
+    Fill(100000);
+
+    gfal_file_reader_t* reader = gfal_file_reader_new(fd, 4, 8192);
+    if (reader == NULL) {
+        std::cout << "io_uring not available, skipping" << std::endl;
+        return;
+    }
+
+    char buffer[5000];
+    for (int round = 0; round < 50; ++round) {
+        const off_t offset = rand() % (content.size() + 100);
+        ASSERT_EQ(0, gfal_file_reader_seek(reader, offset));
+        EXPECT_EQ(offset, gfal_file_reader_tell(reader));
+
+        const ssize_t ret = gfal_file_reader_read(reader, buffer, sizeof(buffer));
+        const ssize_t expected = std::max<ssize_t>(0, std::min<ssize_t>(sizeof(buffer), content.size() - offset));
+        ASSERT_EQ(expected, ret);
+        EXPECT_EQ(0, memcmp(content.data() + offset, buffer, ret));
+        EXPECT_EQ(offset + ret, gfal_file_reader_tell(reader));
+    }
+
+    gfal_file_reader_free(reader);
+}
+
+
+TEST_F(FileReaderTest, ReadAfterEofRewind)
+{
+    Fill(10000);
+
+    gfal_file_reader_t* reader = gfal_file_reader_new(fd, 2, 4096);
+    if (reader == NULL) {
+        std::cout << "io_uring not available, skipping" << std::endl;
+        return;
+    }
+
+    std::vector<char> buffer(20000);
+    EXPECT_EQ(10000, gfal_file_reader_read(reader, buffer.data(), buffer.size()));
+    EXPECT_EQ(0, gfal_file_reader_read(reader, buffer.data(), buffer.size()));
+
+    ASSERT_EQ(0, gfal_file_reader_seek(reader, 0));
+    EXPECT_EQ(10000, gfal_file_reader_read(reader, buffer.data(), buffer.size()));
+    EXPECT_EQ(0, memcmp(content.data(), buffer.data(), content.size()));
+
+    gfal_file_reader_free(reader);
+}
+
+
+TEST_F(FileReaderTest, StartsAtFileOffset)
+{
+    Fill(20000);
+    ASSERT_EQ(12345, lseek(fd, 12345, SEEK_SET));
+
+    gfal_file_reader_t* reader = gfal_file_reader_new(fd, 2, 4096);
+    if (reader == NULL) {
+        std::cout << "io_uring not available, skipping" << std::endl;
+        return;
+    }
+
+    EXPECT_EQ(12345, gfal_file_reader_tell(reader));
+    std::vector<char> buffer(20000);
+    EXPECT_EQ(20000 - 12345, gfal_file_reader_read(reader, buffer.data(), buffer.size()));
+    EXPECT_EQ(0, memcmp(content.data() + 12345, buffer.data(), 20000 - 12345));
+
+    gfal_file_reader_free(reader);
+}
+
+
+TEST_F(FileReaderTest, ShrunkAfterOpen)
+{
+    Fill(50000);
+
+    gfal_file_reader_t* reader = gfal_file_reader_new(fd, 2, 4096);
+    if (reader == NULL) {
+        std::cout << "io_uring not available, skipping" << std::endl;
+        return;
+    }
+
+    // The size seen at open is only a limit, the end is where a read returns nothing
+    ASSERT_EQ(0, ftruncate(fd, 30000));
+    ASSERT_EQ(0, gfal_file_reader_seek(reader, 1000));
+
+    std::vector<char> read_back;
+    char buffer[3000];
+    ssize_t ret;
+    do {
+        ret = gfal_file_reader_read(reader, buffer, sizeof(buffer));
+        ASSERT_GE(ret, 0);
+        read_back.insert(read_back.end(), buffer, buffer + ret);
+    } while (ret > 0);
+
+    ASSERT_EQ(29000u, read_back.size());
+    EXPECT_EQ(0, memcmp(content.data() + 1000, read_back.data(), read_back.size()));
+
+    gfal_file_reader_free(reader);
+}
+
+
+TEST_F(FileReaderTest, GrownAfterEof)
+{
+    Fill(10000);
+
+    gfal_file_reader_t* reader = gfal_file_reader_new(fd, 2, 4096);
+    if (reader == NULL) {
+        std::cout << "io_uring not available, skipping" << std::endl;
+        return;
+    }
+
+    std::vector<char> buffer(20000);
+    EXPECT_EQ(10000, gfal_file_reader_read(reader, buffer.data(), buffer.size()));
+    EXPECT_EQ(0, gfal_file_reader_read(reader, buffer.data(), buffer.size()));
+
+    // Data appended once the reader reached the end is returned too
+    const char appended[] = "appended";
+    ASSERT_EQ((ssize_t)sizeof(appended), pwrite(fd, appended, sizeof(appended), 10000));
+    EXPECT_EQ((ssize_t)sizeof(appended), gfal_file_reader_read(reader, buffer.data(), buffer.size()));
+    EXPECT_EQ(0, memcmp(appended, buffer.data(), sizeof(appended)));
+    EXPECT_EQ(0, gfal_file_reader_read(reader, buffer.data(), buffer.size()));
+
+    gfal_file_reader_free(reader);
+}
@@ -18,9 +18,11 @@
  * limitations under the License.
  */
 
+#include <errno.h>
 #include <gfal_api.h>
 #include <gfal_plugins_api.h>
 #include <gtest/gtest.h>
+#include <common/gfal_metrics_internal.h>
 
 
 TEST(gfalGlobal, testLogLevel)
@@ -100,3 +102,392 @@ TEST(gfalGlobal, registerPlugin)
 
     gfal2_context_free(c);
 }
+
+
+TEST(gfalGlobal, metrics)
+{
+    GError *tmp_err = NULL;
+    gfal2_context_t c = gfal2_context_new(&tmp_err);
+    ASSERT_NE((void *) NULL, c);
+
+    gfal_plugin_interface test_plugin;
+    memset(&test_plugin, 0, sizeof(test_plugin));
+
+    test_plugin.getName = test_plugin_get_name;
+    test_plugin.check_plugin_url = test_plugin_url;
+    test_plugin.statG = test_plugin_stat;
+
+    int ret = gfal2_register_plugin(c, &test_plugin, &tmp_err);
+    ASSERT_EQ(0, ret);
+
+    // Opt-in
+    struct stat st;
+    gfal2_set_opt_boolean(c, "CORE", "METRICS", FALSE, NULL);
+    gfal2_stat(c, "test://host.cern.ch:1094/blah", &st, &tmp_err);
+    ASSERT_EQ(NULL, tmp_err);
+    EXPECT_EQ(NULL, gfal2_get_metrics(c, GFAL2_METRICS_JSON, &tmp_err));
+    ASSERT_NE((void *) NULL, tmp_err);
+    EXPECT_EQ(ENOTSUP, tmp_err->code);
+    g_clear_error(&tmp_err);
+
+    gfal2_set_opt_boolean(c, "CORE", "METRICS", TRUE, NULL);
+    gfal2_stat(c, "test://host.cern.ch:1094/blah", &st, &tmp_err);
+    gfal2_stat(c, "test://host.cern.ch/other", &st, &tmp_err);
+    ASSERT_EQ(NULL, tmp_err);
+
+    char *json = gfal2_get_metrics(c, GFAL2_METRICS_JSON, &tmp_err);
+    ASSERT_NE((void *) NULL, json);
+    EXPECT_NE((char *) NULL, strstr(json,
+        "{\"plugin\":\"TEST PLUGIN\",\"operation\":\"stat\",\"host\":\"host.cern.ch\",\"count\":2,\"errors\":0"));
+    g_free(json);
+
+    char *prometheus = gfal2_get_metrics(c, GFAL2_METRICS_PROMETHEUS, &tmp_err);
+    ASSERT_NE((void *) NULL, prometheus);
+    EXPECT_NE((char *) NULL, strstr(prometheus,
+        "gfal2_operation_duration_seconds_count{plugin=\"TEST PLUGIN\",operation=\"stat\",host=\"host.cern.ch\"} 2"));
+    g_free(prometheus);
+
+    gfal2_reset_metrics(c, NULL);
+    json = gfal2_get_metrics(c, GFAL2_METRICS_JSON, &tmp_err);
+    EXPECT_STREQ("{\"operations\":[]}\n", json);
+    g_free(json);
+
+    gfal2_context_free(c);
+}
+
+
+TEST(gfalGlobal, metricsBuckets)
+{
+    // Exact for small values
+    for (guint64 i = 0; i < GFAL_METRICS_SUB_COUNT; ++i) {
+        EXPECT_EQ(i, gfal_metrics_bucket_index(i));
+    }
+    // Contiguous, and the relative error is bounded
+    for (guint i = 1; i < GFAL_METRICS_BUCKETS; ++i) {
+        guint64 upper = gfal_metrics_bucket_upper(i - 1);
+        ASSERT_EQ(i - 1, gfal_metrics_bucket_index(upper));
+        ASSERT_EQ(i, gfal_metrics_bucket_index(upper + 1));
+        ASSERT_LE(gfal_metrics_bucket_upper(i) - upper, (upper + 1) / GFAL_METRICS_SUB_COUNT + 1);
+    }
+    // Saturates
+    EXPECT_EQ(GFAL_METRICS_BUCKETS - 1, gfal_metrics_bucket_index(G_MAXUINT64));
+
+    char host[64];
+    gfal_metrics_host_from_url("root://user@eos.cern.ch:1094//eos/file", host, sizeof(host));
+    EXPECT_STREQ("eos.cern.ch", host);
+    gfal_metrics_host_from_url("https://[::1]:443/path", host, sizeof(host));
+    EXPECT_STREQ("[::1]", host);
+    gfal_metrics_host_from_url("file:///tmp/file", host, sizeof(host));
+    EXPECT_STREQ("", host);
+}
+
+
+static void test_async_callback(gfal2_async_op_t op, gpointer user_data)
+{
+    g_atomic_int_inc((gint*)user_data);
+    EXPECT_TRUE(gfal2_async_is_done(op));
+}
+
+
+TEST(gfalGlobal, asyncStat)
+{
+    GError *tmp_err = NULL;
+    gfal2_context_t c = gfal2_context_new(&tmp_err);
+    ASSERT_NE((void *) NULL, c);
+    gfal2_set_opt_integer(c, "CORE", "ASYNC_THREADS", 4, NULL);
+
+    gfal_plugin_interface test_plugin;
+    memset(&test_plugin, 0, sizeof(test_plugin));
+
+    test_plugin.getName = test_plugin_get_name;
+    test_plugin.check_plugin_url = test_plugin_url;
+    test_plugin.statG = test_plugin_stat;
+
+    int ret = gfal2_register_plugin(c, &test_plugin, &tmp_err);
+    ASSERT_EQ(0, ret);
+
+    const int nops = 64;
+    struct stat st[nops];
+    gfal2_async_op_t ops[nops];
+    gint called = 0;
+
+    for (int i = 0; i < nops; ++i) {
+        ops[i] = gfal2_async_stat(c, "test://blah", &st[i], test_async_callback, &called, &tmp_err);
+        ASSERT_NE((void *) NULL, ops[i]);
+    }
+    for (int i = 0; i < nops; ++i) {
+        ASSERT_EQ(0, gfal2_async_wait(ops[i], &tmp_err));
+        ASSERT_EQ(NULL, tmp_err);
+        ASSERT_EQ(12345, st[i].st_mode);
+        gfal2_async_free(ops[i]);
+    }
+
+    // Unsupported protocol, error is reported by wait
+    struct stat st_err;
+    gfal2_async_op_t op = gfal2_async_stat(c, "nope://blah", &st_err, NULL, NULL, &tmp_err);
+    ASSERT_NE((void *) NULL, op);
+    ASSERT_EQ(-1, gfal2_async_wait(op, &tmp_err));
+    ASSERT_NE((void *) NULL, tmp_err);
+    EXPECT_EQ(EPROTONOSUPPORT, tmp_err->code);
+    g_clear_error(&tmp_err);
+    gfal2_async_free(op);
+
+    // Released before completion, the context waits for it
+    op = gfal2_async_stat(c, "test://blah", &st_err, test_async_callback, &called, &tmp_err);
+    gfal2_async_free(op);
+
+    gfal2_context_free(c);
+    EXPECT_EQ(nops + 1, called);
+}
+
+
+static int test_plugin_stat_list(plugin_handle plugin_data, int nbfiles, const char* const* urls,
+    struct stat *buffers, GError **errors)
+{
+    for (int i = 0; i < nbfiles; ++i) {
+        buffers[i].st_mode = 54321;
+    }
+    return 0;
+}
+
+
+TEST(gfalGlobal, statList)
+{
+    GError *tmp_err = NULL;
+    gfal2_context_t c = gfal2_context_new(&tmp_err);
+    ASSERT_NE((void *) NULL, c);
+
+    gfal_plugin_interface test_plugin;
+    memset(&test_plugin, 0, sizeof(test_plugin));
+
+    test_plugin.getName = test_plugin_get_name;
+    test_plugin.check_plugin_url = test_plugin_url;
+    test_plugin.statG = test_plugin_stat;
+
+    int ret = gfal2_register_plugin(c, &test_plugin, &tmp_err);
+    ASSERT_EQ(0, ret);
+
+    // Fallback, with one failure
+    const char *urls[] = {"test://a", "test://b", "nope://c", "test://d"};
+    struct stat buffers[4];
+    GError *errors[4] = {NULL};
+
+    ret = gfal2_stat_list(c, 4, urls, buffers, errors);
+    EXPECT_EQ(-1, ret);
+    for (int i = 0; i < 4; ++i) {
+        if (i == 2) {
+            ASSERT_NE((void *) NULL, errors[i]);
+            EXPECT_EQ(EPROTONOSUPPORT, errors[i]->code);
+            g_clear_error(&errors[i]);
+        }
+        else {
+            EXPECT_EQ(NULL, errors[i]);
+            EXPECT_EQ(12345, buffers[i].st_mode);
+        }
+    }
+
+    gfal2_context_free(c);
+
+    // Native bulk stat
+    c = gfal2_context_new(&tmp_err);
+    test_plugin.stat_listG = test_plugin_stat_list;
+    ret = gfal2_register_plugin(c, &test_plugin, &tmp_err);
+    ASSERT_EQ(0, ret);
+
+    const char *native_urls[] = {"test://a", "test://b"};
+    ret = gfal2_stat_list(c, 2, native_urls, buffers, errors);
+    EXPECT_EQ(0, ret);
+    EXPECT_EQ(54321, buffers[0].st_mode);
+    EXPECT_EQ(54321, buffers[1].st_mode);
+
+    gfal2_context_free(c);
+}
+
+
+static gboolean test_plugin_unlink_url(plugin_handle plugin_data, const char *url,
+    plugin_mode operation, GError **err)
+{
+    return strncmp(url, "test://", 7) == 0 && operation == GFAL_PLUGIN_UNLINK;
+}
+
+
+static gint fanout_active[2], fanout_max_active[2];
+static gint fanout_calls;
+
+
+static int test_plugin_unlink(plugin_handle plugin_data, const char *url, GError **err)
+{
+    const int host = (url[7] == 'a') ? 0 : 1;
+    gint active = g_atomic_int_add(&fanout_active[host], 1) + 1;
+    gint max_active;
+    do {
+        max_active = g_atomic_int_get(&fanout_max_active[host]);
+    } while (active > max_active &&
+        !g_atomic_int_compare_and_exchange(&fanout_max_active[host], max_active, active));
+
+    g_atomic_int_inc(&fanout_calls);
+    g_usleep(1000);
+    g_atomic_int_add(&fanout_active[host], -1);
+
+    if (strstr(url, "missing")) {
+        gfal2_set_error(err, g_quark_from_static_string("test"), ENOENT, __func__, "Not found");
+        return -1;
+    }
+    return 0;
+}
+
+
+TEST(gfalGlobal, unlinkListFanout)
+{
+    GError *tmp_err = NULL;
+    gfal2_context_t c = gfal2_context_new(&tmp_err);
+    ASSERT_NE((void *) NULL, c);
+
+    gfal2_set_opt_integer(c, "CORE", "FANOUT_THREADS", 8, NULL);
+    gfal2_set_opt_integer(c, "CORE", "FANOUT_PER_HOST", 2, NULL);
+
+    gfal_plugin_interface test_plugin;
+    memset(&test_plugin, 0, sizeof(test_plugin));
+
+    test_plugin.getName = test_plugin_get_name;
+    test_plugin.check_plugin_url = test_plugin_unlink_url;
+    test_plugin.unlinkG = test_plugin_unlink;
+
+    int ret = gfal2_register_plugin(c, &test_plugin, &tmp_err);
+    ASSERT_EQ(0, ret);
+
+    const int nbfiles = 20;
+    char *urls[nbfiles];
+    GError *errors[nbfiles];
+    for (int i = 0; i < nbfiles; ++i) {
+        urls[i] = g_strdup_printf("test://%c/%s%d", (i % 2) ? 'a' : 'b', (i % 7) ? "file" : "missing", i);
+        errors[i] = NULL;
+    }
+
+    ret = gfal2_unlink_list(c, nbfiles, (const char* const*)urls, errors);
+    EXPECT_EQ(-1, ret);
+    EXPECT_EQ(nbfiles, fanout_calls);
+    EXPECT_LE(fanout_max_active[0], 2);
+    EXPECT_LE(fanout_max_active[1], 2);
+
+    for (int i = 0; i < nbfiles; ++i) {
+        if (i % 7) {
+            EXPECT_EQ(NULL, errors[i]);
+        }
+        else {
+            ASSERT_NE((void *) NULL, errors[i]);
+            EXPECT_EQ(ENOENT, errors[i]->code);
+            g_clear_error(&errors[i]);
+        }
+        g_free(urls[i]);
+    }
+
+    gfal2_context_free(c);
+}
+
+
+static gboolean test_plugin_open_url(plugin_handle plugin_data, const char *url,
+    plugin_mode operation, GError **err)
+{
+    return strncmp(url, "test://", 7) == 0 && operation == GFAL_PLUGIN_OPEN;
+}
+
+
+static gfal_file_handle test_plugin_open(plugin_handle plugin_data, const char *url, int flag, mode_t mode,
+    GError **err)
+{
+    return gfal_file_handle_new("TEST PLUGIN", NULL);
+}
+
+
+static int test_plugin_close(plugin_handle plugin_data, gfal_file_handle fh, GError **err)
+{
+    gfal_file_handle_delete(fh);
+    return 0;
+}
+
+
+// 1000 bytes file where each byte is its offset modulo 256
+static ssize_t test_plugin_pread(plugin_handle plugin_data, gfal_file_handle fh, void *buff, size_t count,
+    off_t offset, GError **err)
+{
+    size_t i;
+    for (i = 0; i < count && offset + i < 1000; ++i) {
+        ((unsigned char*)buff)[i] = (offset + i) % 256;
+    }
+    return i;
+}
+
+
+static gint vector_read_calls;
+
+static ssize_t test_plugin_vector_read(plugin_handle plugin_data, gfal_file_handle fh,
+    const gfal2_read_chunk_t *chunks, int nchunks, GError **err)
+{
+    ssize_t total = 0;
+    g_atomic_int_inc(&vector_read_calls);
+    for (int i = 0; i < nchunks; ++i) {
+        total += test_plugin_pread(plugin_data, fh, chunks[i].buffer, chunks[i].size, chunks[i].offset, err);
+    }
+    return total;
+}
+
+
+TEST(gfalGlobal, vectorRead)
+{
+    GError *tmp_err = NULL;
+    gfal2_context_t c = gfal2_context_new(&tmp_err);
+    ASSERT_NE((void *) NULL, c);
+
+    gfal_plugin_interface test_plugin;
+    memset(&test_plugin, 0, sizeof(test_plugin));
+
+    test_plugin.getName = test_plugin_get_name;
+    test_plugin.check_plugin_url = test_plugin_open_url;
+    test_plugin.openG = test_plugin_open;
+    test_plugin.closeG = test_plugin_close;
+    test_plugin.preadG = test_plugin_pread;
+
+    int ret = gfal2_register_plugin(c, &test_plugin, &tmp_err);
+    ASSERT_EQ(0, ret);
+
+    int fd = gfal2_open(c, "test://file", O_RDONLY, &tmp_err);
+    ASSERT_GT(fd, 0);
+
+    // Fallback, one pread per chunk
+    unsigned char a[10], b[100], d[5];
+    gfal2_read_chunk_t chunks[] = {{500, sizeof(a), a}, {10, sizeof(b), b}, {995, sizeof(d), d}};
+    ssize_t r = gfal2_vector_read(c, fd, chunks, 3, &tmp_err);
+    ASSERT_EQ(NULL, tmp_err);
+    EXPECT_EQ(115, r);
+    EXPECT_EQ(500 % 256, a[0]);
+    EXPECT_EQ(109, b[99]);
+    EXPECT_EQ(999 % 256, d[4]);
+
+    // A chunk past the end of the file is an error
+    gfal2_read_chunk_t past[] = {{998, sizeof(a), a}};
+    r = gfal2_vector_read(c, fd, past, 1, &tmp_err);
+    EXPECT_EQ(-1, r);
+    ASSERT_NE((void *) NULL, tmp_err);
+    EXPECT_EQ(EINVAL, tmp_err->code);
+    g_clear_error(&tmp_err);
+
+    gfal2_close(c, fd, &tmp_err);
+    gfal2_context_free(c);
+
+    // Native vectored read
+    c = gfal2_context_new(&tmp_err);
+    test_plugin.vector_readG = test_plugin_vector_read;
+    ret = gfal2_register_plugin(c, &test_plugin, &tmp_err);
+    ASSERT_EQ(0, ret);
+
+    fd = gfal2_open(c, "test://file", O_RDONLY, &tmp_err);
+    ASSERT_GT(fd, 0);
+    r = gfal2_vector_read(c, fd, chunks, 3, &tmp_err);
+    EXPECT_EQ(115, r);
+    EXPECT_EQ(1, vector_read_calls);
+    EXPECT_EQ(10, b[0]);
+
+    gfal2_close(c, fd, &tmp_err);
+    gfal2_context_free(c);
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <utils/mds/gfal_mds_internal.h>
+#include <utils/mds/gfal_mds_ldap_internal_layer.h>
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+
+// Fake ldap layer, returning the same srm endpoint entries times, and counting the connections
+static int connects = 0;
+static int searches = 0;
+static int failing_searches = 0;
+static int entries = 1;
+static int entry_index = 0;
+
+static const char* attr_names[] = {"GlueServiceVersion", "GlueServiceEndpoint", "GlueServiceType"};
+static char attr_values[3][64] = {"2.2.0", "httpg://test.domain.com:8446/srm/managerv2", "srm"};
+static int attr_index = 0;
+
+static int fake_initialize(LDAP** ldp, const char*)
+{
+    ++connects;
+    *ldp = reinterpret_cast<LDAP*>(new int(0));
+    return LDAP_SUCCESS;
+}
+
+static int fake_sasl_bind_s(LDAP*, const char*, const char*, struct berval*, LDAPControl**, LDAPControl**,
+    struct berval**)
+{
+    return LDAP_SUCCESS;
+}
+
+static int fake_search_ext_s(LDAP* ld, const char*, int, const char*, char**, int, LDAPControl**, LDAPControl**,
+    struct timeval*, int, LDAPMessage** res)
+{
+    ++searches;
+    if (failing_searches > 0) {
+        --failing_searches;
+        return LDAP_SERVER_DOWN;
+    }
+    *res = reinterpret_cast<LDAPMessage*>(ld);
+    return LDAP_SUCCESS;
+}
+
+static int fake_unbind_ext_s(LDAP* ld, LDAPControl**, LDAPControl**)
+{
+    delete reinterpret_cast<int*>(ld);
+    return LDAP_SUCCESS;
+}
+
+static LDAPMessage* fake_first_entry(LDAP*, LDAPMessage* result)
+{
+    entry_index = 1;
+    return result;
+}
+
+static LDAPMessage* fake_next_entry(LDAP*, LDAPMessage* entry)
+{
+    if (++entry_index > entries)
+        return NULL;
+    return entry;
+}
+
+static int fake_count_entries(LDAP*, LDAPMessage*)
+{
+    return entries;
+}
+
+static char* fake_first_attribute(LDAP*, LDAPMessage*, BerElement** berptr)
+{
+    attr_index = 0;
+    *berptr = NULL;
+    return strdup(attr_names[attr_index]);
+}
+
+static char* fake_next_attribute(LDAP*, LDAPMessage*, BerElement*)
+{
+    if (++attr_index >= 3)
+        return NULL;
+    return strdup(attr_names[attr_index]);
+}
+
+static struct berval** fake_get_values_len(LDAP*, LDAPMessage*, const char*)
+{
+    static struct berval value;
+    static struct berval* values[] = {&value, NULL};
+    value.bv_val = attr_values[attr_index];
+    value.bv_len = strlen(attr_values[attr_index]);
+    return values;
+}
+
+static void fake_value_free_len(struct berval**)
+{
+}
+
+static int fake_msgfree(LDAPMessage*)
+{
+    return 0;
+}
+
+static void fake_ber_free(BerElement*, int)
+{
+}
+
+static int fake_set_option(LDAP*, int, const void*)
+{
+    return LDAP_OPT_SUCCESS;
+}
+
+
+class MdsBdiiTest : public ::testing::Test {
+protected:
+    gfal2_context_t context;
+    struct _gfal_mds_ldap original;
+
+public:
+    MdsBdiiTest() {
+        original = gfal_mds_ldap;
+        gfal_mds_ldap.ldap_initialize = fake_initialize;
+        gfal_mds_ldap.ldap_sasl_bind_s = fake_sasl_bind_s;
+        gfal_mds_ldap.ldap_search_ext_s = fake_search_ext_s;
+        gfal_mds_ldap.ldap_unbind_ext_s = fake_unbind_ext_s;
+        gfal_mds_ldap.ldap_first_entry = fake_first_entry;
+        gfal_mds_ldap.ldap_next_entry = fake_next_entry;
+        gfal_mds_ldap.ldap_count_entries = fake_count_entries;
+        gfal_mds_ldap.ldap_first_attribute = fake_first_attribute;
+        gfal_mds_ldap.ldap_next_attribute = fake_next_attribute;
+        gfal_mds_ldap.ldap_get_values_len = fake_get_values_len;
+        gfal_mds_ldap.ldap_value_free_len = fake_value_free_len;
+        gfal_mds_ldap.ldap_memfree = free;
+        gfal_mds_ldap.ldap_msgfree = fake_msgfree;
+        gfal_mds_ldap.ber_free = fake_ber_free;
+        gfal_mds_ldap.ldap_set_option = fake_set_option;
+
+        gfal_mds_bdii_cache_clear();
+        connects = searches = failing_searches = 0;
+        entries = 1;
+
+        g_unsetenv(bdii_env_var);
+        GError *error = NULL;
+        context = gfal2_context_new(&error);
+        assert(context != NULL);
+        gfal2_set_opt_string(context, "BDII", "LCG_GFAL_INFOSYS", "bdii.example.com:2170", NULL);
+    }
+
+    ~MdsBdiiTest() {
+        gfal_mds_bdii_cache_clear();
+        gfal_mds_ldap = original;
+        gfal2_context_free(context);
+    }
+};
+
+
+TEST_F(MdsBdiiTest, test_connection_reused)
+{
+    gfal2_set_opt_integer(context, "BDII", "CACHE_TTL", 0, NULL);
+
+    gfal_mds_endpoint endpoints[5];
+    GError* err = NULL;
+    for (int i = 0; i < 3; ++i) {
+        int ret = gfal_mds_bdii_get_srm_endpoint(context, "test.domain.com", endpoints, 5, &err);
+        ASSERT_EQ(err, (void*)NULL);
+        ASSERT_EQ(ret, 1);
+        ASSERT_EQ(endpoints[0].type, SRMv2);
+        ASSERT_STREQ(endpoints[0].url, "httpg://test.domain.com:8446/srm/managerv2");
+    }
+    ASSERT_EQ(connects, 1);
+    ASSERT_EQ(searches, 3);
+}
+
+
+TEST_F(MdsBdiiTest, test_result_cached)
+{
+    gfal_mds_endpoint endpoints[5];
+    GError* err = NULL;
+    for (int i = 0; i < 3; ++i) {
+        memset(endpoints, 0, sizeof(endpoints));
+        int ret = gfal_mds_bdii_get_srm_endpoint(context, "test.domain.com", endpoints, 5, &err);
+        ASSERT_EQ(err, (void*)NULL);
+        ASSERT_EQ(ret, 1);
+        ASSERT_STREQ(endpoints[0].url, "httpg://test.domain.com:8446/srm/managerv2");
+    }
+    ASSERT_EQ(searches, 1);
+
+    // A different host is a different lookup
+    int ret = gfal_mds_bdii_get_srm_endpoint(context, "other.domain.com", endpoints, 5, &err);
+    ASSERT_EQ(ret, 1);
+    ASSERT_EQ(searches, 2);
+    ASSERT_EQ(connects, 1);
+}
+
+
+TEST_F(MdsBdiiTest, test_negative_cached)
+{
+    entries = 0;
+
+    gfal_mds_endpoint endpoints[5];
+    for (int i = 0; i < 3; ++i) {
+        GError* err = NULL;
+        int ret = gfal_mds_bdii_get_srm_endpoint(context, "unknown.domain.com", endpoints, 5, &err);
+        ASSERT_EQ(ret, -1);
+        ASSERT_NE(err, (void*)NULL);
+        ASSERT_EQ(err->code, ENXIO);
+        g_error_free(err);
+    }
+    ASSERT_EQ(searches, 1);
+}
+
+
+TEST_F(MdsBdiiTest, test_transport_error_not_cached)
+{
+    failing_searches = 2;
+
+    gfal_mds_endpoint endpoints[5];
+    GError* err = NULL;
+    int ret = gfal_mds_bdii_get_srm_endpoint(context, "test.domain.com", endpoints, 5, &err);
+    ASSERT_EQ(ret, -1);
+    ASSERT_NE(err, (void*)NULL);
+    g_clear_error(&err);
+
+    ret = gfal_mds_bdii_get_srm_endpoint(context, "test.domain.com", endpoints, 5, &err);
+    ASSERT_EQ(ret, -1);
+    g_clear_error(&err);
+
+    ret = gfal_mds_bdii_get_srm_endpoint(context, "test.domain.com", endpoints, 5, &err);
+    ASSERT_EQ(err, (void*)NULL);
+    ASSERT_EQ(ret, 1);
+    ASSERT_EQ(searches, 3);
+}
+
+
+TEST_F(MdsBdiiTest, test_stale_connection_replaced)
+{
+    gfal2_set_opt_integer(context, "BDII", "CACHE_TTL", 0, NULL);
+
+    gfal_mds_endpoint endpoints[5];
+    GError* err = NULL;
+    int ret = gfal_mds_bdii_get_srm_endpoint(context, "test.domain.com", endpoints, 5, &err);
+    ASSERT_EQ(ret, 1);
+    ASSERT_EQ(connects, 1);
+
+    // The pooled connection fails, so a new one is opened
+    failing_searches = 1;
+    ret = gfal_mds_bdii_get_srm_endpoint(context, "test.domain.com", endpoints, 5, &err);
+    ASSERT_EQ(err, (void*)NULL);
+    ASSERT_EQ(ret, 1);
+    ASSERT_EQ(connects, 2);
+    ASSERT_EQ(searches, 3);
+}
+
+
+TEST_F(MdsBdiiTest, test_cached_list_not_truncated)
+{
+    entries = 3;
+
+    gfal_mds_endpoint endpoints[5];
+    GError* err = NULL;
+    int ret = gfal_mds_bdii_get_srm_endpoint(context, "test.domain.com", endpoints, 1, &err);
+    ASSERT_EQ(err, (void*)NULL);
+    ASSERT_EQ(ret, 1);
+
+    // Served from the cache, with all the endpoints the bdii returned
+    ret = gfal_mds_bdii_get_srm_endpoint(context, "test.domain.com", endpoints, 5, &err);
+    ASSERT_EQ(err, (void*)NULL);
+    ASSERT_EQ(ret, 3);
+    ASSERT_STREQ(endpoints[2].url, "httpg://test.domain.com:8446/srm/managerv2");
+    ASSERT_EQ(searches, 1);
+}
@@ -115,6 +115,82 @@ TEST(gfalTransfer, test_event_callbacks)
 }
 
 
+TEST(gfalTransfer, test_event_stream)
+{
+    gfalt_event_stream_t stream = gfalt_event_stream_new(4, 0, NULL);
+    gfalt_event_stream_t text_stream = gfalt_event_stream_new(4, GFALT_EVENT_STREAM_TEXT, NULL);
+
+    gfalt_params_t params = gfalt_params_handle_new(NULL);
+    gfalt_add_event_stream(params, stream, NULL);
+    gfalt_add_event_stream(params, stream, NULL);
+    gfalt_add_event_stream(params, text_stream, NULL);
+
+    const gint64 values[] = {42, 24};
+    plugin_trigger_event_values(params, domain, GFAL_EVENT_SOURCE, GFAL_EVENT_TRANSFER_EXIT,
+            values, 2, "%s %d", "TEST", 5);
+
+    gfalt_event_record_t record;
+    ASSERT_TRUE(gfalt_event_stream_pop(stream, &record));
+    EXPECT_EQ(domain, record.domain);
+    EXPECT_EQ(GFAL_EVENT_TRANSFER_EXIT, record.stage);
+    EXPECT_EQ(GFAL_EVENT_SOURCE, record.side);
+    EXPECT_EQ(2, record.n_values);
+    EXPECT_EQ(42, record.values[0]);
+    EXPECT_EQ(24, record.values[1]);
+    EXPECT_GT(record.monotonic, 0);
+    EXPECT_STREQ("", record.description);
+    // Attached only once
+    EXPECT_FALSE(gfalt_event_stream_pop(stream, &record));
+
+    ASSERT_TRUE(gfalt_event_stream_pop(text_stream, &record));
+    EXPECT_STREQ("TEST 5", record.description);
+
+    char buffer[128];
+    gfalt_event_record_to_string(&record, buffer, sizeof(buffer));
+    EXPECT_STREQ("SOURCE TEST TRANSFER:EXIT TEST 5", buffer);
+
+    gfalt_params_handle_delete(params, NULL);
+    gfalt_event_stream_free(stream);
+    gfalt_event_stream_free(text_stream);
+}
+
+
+TEST(gfalTransfer, test_event_stream_overflow)
+{
+    gfalt_event_stream_t stream = gfalt_event_stream_new(3, 0, NULL);
+
+    gfalt_params_t params = gfalt_params_handle_new(NULL);
+    gfalt_add_event_stream(params, stream, NULL);
+
+    // Capacity is rounded up to 4
+    for (int i = 0; i < 6; ++i) {
+        gint64 value = i;
+        plugin_trigger_event_values(params, domain, GFAL_EVENT_NONE, domain, &value, 1, NULL);
+    }
+    EXPECT_EQ(2, gfalt_event_stream_dropped(stream));
+
+    gfalt_event_record_t record;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(gfalt_event_stream_pop(stream, &record));
+        EXPECT_EQ(i, record.values[0]);
+    }
+    EXPECT_FALSE(gfalt_event_stream_pop(stream, &record));
+
+    // The copy keeps feeding the same stream
+    gfalt_params_t copy = gfalt_params_handle_copy(params, NULL);
+    gfalt_params_handle_delete(params, NULL);
+    plugin_trigger_event(copy, domain, GFAL_EVENT_NONE, domain, NULL);
+    EXPECT_TRUE(gfalt_event_stream_pop(stream, &record));
+
+    EXPECT_EQ(0, gfalt_remove_event_stream(copy, stream, NULL));
+    plugin_trigger_event(copy, domain, GFAL_EVENT_NONE, domain, NULL);
+    EXPECT_FALSE(gfalt_event_stream_pop(stream, &record));
+
+    gfalt_params_handle_delete(copy, NULL);
+    gfalt_event_stream_free(stream);
+}
+
+
 static const char* test_plugin_name()
 {
     return "TEST-PLUGIN";
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <errno.h>
+#include <string>
+#include <thread>
+#include <gfal_api.h>
+#include <common/gfal_mem_plugin.h>
+
+
+class LocalCopyTest: public testing::Test {
+public:
+    gfal_mem_plugin_t* mem;
+    gfal2_context_t context;
+
+    virtual void SetUp() {
+        mem = gfal_mem_plugin_new();
+        // A latency on each operation, so concurrent streams can be seen
+        gfal_mem_plugin_set_latency(mem, 5000);
+        context = NULL;
+        Register();
+    }
+
+    virtual void TearDown() {
+        gfal2_context_free(context);
+        gfal_mem_plugin_free(mem);
+    }
+
+    void Register() {
+        if (context)
+            gfal2_context_free(context);
+        context = gfal2_context_new(NULL);
+        ASSERT_NE((void*)NULL, context);
+        ASSERT_EQ(0, gfal_mem_plugin_register(context, mem, NULL));
+        gfal2_set_opt_integer(context, "CORE", "COPY_BUFFERSIZE", 65536, NULL);
+    }
+
+    void Fill(const char* url, size_t size) {
+        std::string content(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            content[i] = (char)(rand() % 256);
+        }
+        gfal_mem_plugin_put_data(mem, url, content.data(), content.size());
+    }
+
+    std::string Get(const char* url) {
+        size_t size = 0;
+        char* data = gfal_mem_plugin_get_data(mem, url, &size);
+        std::string content = data ? std::string(data, size) : std::string("<missing>");
+        g_free(data);
+        return content;
+    }
+
+    int Copy(guint nbstreams, GError** err) {
+        gfalt_params_t params = gfalt_params_handle_new(NULL);
+        gfalt_set_nbstreams(params, nbstreams, NULL);
+        gfalt_set_replace_existing_file(params, TRUE, NULL);
+        int ret = gfalt_copy_file(context, params, "mem://host/source", "mem://host/destination", err);
+        gfalt_params_handle_delete(params, NULL);
+        return ret;
+    }
+};
+
+
+TEST_F(LocalCopyTest, ParallelStreams)
+{
+    const guint nbstreams[] = {1, 2, 4, 7};
+    const size_t sizes[] = {0, 1, 65536, 65537, 1000000};
+
+    for (size_t s = 0; s < G_N_ELEMENTS(sizes); ++s) {
+        for (size_t n = 0; n < G_N_ELEMENTS(nbstreams); ++n) {
+            Fill("mem://host/source", sizes[s]);
+            gfal_mem_plugin_get_max_concurrent_reads(mem);
+
+            GError* err = NULL;
+            ASSERT_EQ(0, Copy(nbstreams[n], &err)) << err->message;
+            EXPECT_EQ(Get("mem://host/source"), Get("mem://host/destination"));
+
+            const guint max_active = gfal_mem_plugin_get_max_concurrent_reads(mem);
+            if (nbstreams[n] == 1 || sizes[s] <= 65536)
+                EXPECT_LE(max_active, 1u);
+            else
+                EXPECT_GT(max_active, 1u);
+        }
+    }
+}
+
+
+TEST_F(LocalCopyTest, ParallelStreamsNeedPositionalIO)
+{
+    // Without pread and pwrite, the copy must stay sequential
+    gfal_mem_plugin_set_positional_io(mem, FALSE);
+    Register();
+
+    Fill("mem://host/source", 500000);
+
+    GError* err = NULL;
+    ASSERT_EQ(0, Copy(4, &err)) << err->message;
+    EXPECT_EQ(Get("mem://host/source"), Get("mem://host/destination"));
+    EXPECT_LE(gfal_mem_plugin_get_max_concurrent_reads(mem), 1u);
+}
+
+
+TEST_F(LocalCopyTest, ParallelStreamsCanceled)
+{
+    // 400 blocks of 5 ms spread over 4 streams would take about half a second
+    Fill("mem://host/source", 400 * 65536);
+
+    std::thread canceler([this] {
+        g_usleep(50000);
+        gfal2_cancel(context);
+    });
+
+    GError* err = NULL;
+    const gint64 start = g_get_monotonic_time();
+    EXPECT_NE(0, Copy(4, &err));
+    const gint64 elapsed = g_get_monotonic_time() - start;
+    canceler.join();
+
+    ASSERT_NE((void*)NULL, err);
+    EXPECT_EQ(ECANCELED, err->code);
+    EXPECT_LT(elapsed, 300000);
+    g_clear_error(&err);
+}
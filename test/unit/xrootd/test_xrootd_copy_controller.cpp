@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) CERN 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "gfal_xrootd_plugin_copy_controller.h"
+
+static const uint64_t MB = 1 << 20;
+
+
+// Feed a wave where each of the parallel jobs moves jobRate bytes per second,
+// for one second, with the aggregate rate capped at linkRate
+static void run_wave(CopyController& controller, double& now, uint64_t jobRate, uint64_t linkRate)
+{
+    int parallel = controller.GetParallel();
+    uint64_t perJob = jobRate;
+    if (perJob * parallel > linkRate) {
+        perJob = linkRate / parallel;
+    }
+
+    controller.BeginWave(now);
+    for (int step = 0; step <= 10; ++step) {
+        for (int job = 1; job <= parallel; ++job) {
+            controller.JobProgress(job, perJob * step / 10, now + step / 10.0);
+        }
+    }
+    now += 1;
+    controller.EndWave(now);
+}
+
+
+TEST(XrootdCopyController, FixedParallelism)
+{
+    CopyController controller(20, 20, 20, 0);
+    ASSERT_FALSE(controller.IsAdaptive());
+
+    double now = 0;
+    for (int i = 0; i < 5; ++i) {
+        run_wave(controller, now, 10 * MB, 1000 * MB);
+        ASSERT_EQ(20, controller.GetParallel());
+    }
+    ASSERT_EQ(200 * MB, controller.GetRate());
+}
+
+
+TEST(XrootdCopyController, Limits)
+{
+    CopyController low(4, 16, 1, 0);
+    ASSERT_EQ(4, low.GetParallel());
+
+    CopyController high(4, 16, 100, 0);
+    ASSERT_EQ(16, high.GetParallel());
+
+    CopyController inverted(10, 2, 5, 0);
+    ASSERT_FALSE(inverted.IsAdaptive());
+    ASSERT_EQ(10, inverted.GetParallel());
+}
+
+
+TEST(XrootdCopyController, WidensWhileItPays)
+{
+    CopyController controller(1, 64, 2, 0);
+    ASSERT_TRUE(controller.IsAdaptive());
+
+    // Each job is slow, the link is not the bottleneck
+    double now = 0;
+    int previous = controller.GetParallel();
+    for (int i = 0; i < 4; ++i) {
+        run_wave(controller, now, 1 * MB, 1000 * MB);
+        ASSERT_GT(controller.GetParallel(), previous);
+        previous = controller.GetParallel();
+    }
+
+    // Never goes over the limit
+    for (int i = 0; i < 20; ++i) {
+        run_wave(controller, now, 1 * MB, 1000 * MB);
+        ASSERT_LE(controller.GetParallel(), 64);
+    }
+    ASSERT_EQ(64, controller.GetParallel());
+}
+
+
+TEST(XrootdCopyController, HoldsOnSaturatedLink)
+{
+    CopyController controller(1, 64, 4, 0);
+
+    // The link saturates at 8 jobs
+    double now = 0;
+    for (int i = 0; i < 20; ++i) {
+        run_wave(controller, now, 10 * MB, 80 * MB);
+    }
+    ASSERT_NEAR(80 * MB, controller.GetRate(), MB);
+    ASSERT_LT(controller.GetParallel(), 64);
+}
+
+
+TEST(XrootdCopyController, BacksOffWhenWorse)
+{
+    CopyController controller(1, 64, 8, 0);
+
+    double now = 0;
+    run_wave(controller, now, 10 * MB, 1000 * MB);
+    int widened = controller.GetParallel();
+    ASSERT_GT(widened, 8);
+
+    // The server gets overloaded by the wider wave
+    run_wave(controller, now, 1 * MB, 1000 * MB);
+    ASSERT_LT(controller.GetParallel(), widened);
+}
+
+
+TEST(XrootdCopyController, TargetRate)
+{
+    CopyController controller(1, 64, 32, 100 * MB);
+
+    // Well over the target, narrow down
+    double now = 0;
+    run_wave(controller, now, 10 * MB, 1000 * MB);
+    ASSERT_LT(controller.GetParallel(), 32);
+
+    // Once around the target, stay
+    for (int i = 0; i < 10; ++i) {
+        run_wave(controller, now, 10 * MB, 1000 * MB);
+    }
+    int settled = controller.GetParallel();
+    run_wave(controller, now, 10 * MB, 1000 * MB);
+    ASSERT_EQ(settled, controller.GetParallel());
+    ASSERT_GE(controller.GetRate(), 100 * MB);
+}
+
+
+TEST(XrootdCopyController, ChunkSize)
+{
+    CopyController controller(4, 4, 4, 0);
+    ASSERT_EQ(CopyController::DEFAULT_CHUNK_SIZE, controller.GetChunkSize());
+
+    double now = 0;
+    run_wave(controller, now, 1 * MB, 1000 * MB);
+    ASSERT_EQ(CopyController::MIN_CHUNK_SIZE, controller.GetChunkSize());
+
+    run_wave(controller, now, 64 * MB, 1000 * MB);
+    ASSERT_EQ(16 * MB, controller.GetChunkSize());
+
+    run_wave(controller, now, 1000 * MB, 100000 * MB);
+    ASSERT_EQ(CopyController::MAX_CHUNK_SIZE, controller.GetChunkSize());
+}
+
+
+TEST(XrootdCopyController, EmptyWave)
+{
+    CopyController controller(1, 64, 8, 0);
+
+    // Nothing transferred, nothing learned
+    controller.BeginWave(0);
+    controller.EndWave(1);
+    ASSERT_EQ(8, controller.GetParallel());
+    ASSERT_EQ(0u, controller.GetRate());
+}
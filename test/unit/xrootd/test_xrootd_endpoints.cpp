@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <mutex>
+#include <set>
+
+#include "gfal_xrootd_plugin_utils.h"
+
+
+class XrootdEndpointsTest: public testing::Test {
+public:
+    gfal2_context_t context;
+
+    virtual void SetUp() {
+        GError *error = NULL;
+        context = gfal2_context_new(&error);
+        ASSERT_NE((void*)NULL, context);
+    }
+
+    virtual void TearDown() {
+        gfal2_context_free(context);
+    }
+};
+
+
+TEST_F(XrootdEndpointsTest, GroupByEndpoint)
+{
+    const char *urls[] = {
+        "root://host1.cern.ch//path/a",
+        "root://host2.cern.ch:1095//path/b",
+        "root://host1.cern.ch//path/c",
+        "root://host2.cern.ch:1095//path/d",
+        "root://host3.cern.ch//path/e",
+    };
+
+    std::map<std::string, std::vector<int> > groups = group_by_endpoint(context, 5, urls);
+    ASSERT_EQ(3u, groups.size());
+
+    std::vector<int> host1 = {0, 2}, host2 = {1, 3}, host3 = {4};
+    EXPECT_EQ(host1, groups["host1.cern.ch:1094"]);
+    EXPECT_EQ(host2, groups["host2.cern.ch:1095"]);
+    EXPECT_EQ(host3, groups["host3.cern.ch:1094"]);
+}
+
+
+TEST_F(XrootdEndpointsTest, RunPerEndpoint)
+{
+    const char *urls[] = {
+        "root://host1.cern.ch//path/a",
+        "root://host2.cern.ch//path/b",
+        "root://host1.cern.ch//path/c",
+        "root://host2.cern.ch//path/d",
+    };
+    GError *errors[4] = {NULL};
+
+    // Fake endpoint call: host2 fails all its files
+    std::mutex mutex;
+    std::map<std::string, std::set<std::string> > seen;
+    std::map<std::string, int> results = run_per_endpoint(context, 4, urls, errors,
+        [&](const std::string& endpoint, int n, const char* const* group, GError** group_errors) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int i = 0; i < n; ++i) {
+                seen[endpoint].insert(group[i]);
+                if (endpoint == "host2.cern.ch:1094") {
+                    g_set_error(&group_errors[i], g_quark_from_static_string("test"), EIO, "%s", group[i]);
+                }
+            }
+            return endpoint == "host2.cern.ch:1094" ? -1 : 0;
+        });
+
+    ASSERT_EQ(2u, results.size());
+    EXPECT_EQ(0, results["host1.cern.ch:1094"]);
+    EXPECT_EQ(-1, results["host2.cern.ch:1094"]);
+
+    EXPECT_EQ(2u, seen["host1.cern.ch:1094"].size());
+    EXPECT_EQ(1u, seen["host1.cern.ch:1094"].count(urls[0]));
+    EXPECT_EQ(1u, seen["host1.cern.ch:1094"].count(urls[2]));
+
+    // Errors land on the right files
+    EXPECT_EQ(NULL, errors[0]);
+    EXPECT_EQ(NULL, errors[2]);
+    ASSERT_NE((void*)NULL, errors[1]);
+    EXPECT_STREQ(urls[1], errors[1]->message);
+    ASSERT_NE((void*)NULL, errors[3]);
+    EXPECT_STREQ(urls[3], errors[3]->message);
+
+    EXPECT_EQ(2, poll_result_from_errors(4, errors));
+    g_clear_error(&errors[1]);
+    g_clear_error(&errors[3]);
+}
+
+
+TEST_F(XrootdEndpointsTest, Tokens)
+{
+    std::map<std::string, std::string> single = {{"host1:1094", "abcd"}};
+    EXPECT_EQ("abcd", join_endpoint_tokens(single));
+    EXPECT_EQ("abcd", get_endpoint_token("abcd", "host1:1094"));
+    EXPECT_EQ("abcd", get_endpoint_token("abcd", "host2:1094"));
+
+    std::map<std::string, std::string> multiple = {{"host1:1094", "abcd"}, {"host2:1094", "efgh"}};
+    std::string joined = join_endpoint_tokens(multiple);
+    EXPECT_EQ("abcd", get_endpoint_token(joined, "host1:1094"));
+    EXPECT_EQ("efgh", get_endpoint_token(joined, "host2:1094"));
+    EXPECT_EQ("", get_endpoint_token(joined, "host3:1094"));
+}
+
+
+TEST_F(XrootdEndpointsTest, PollResult)
+{
+    GError *errors[2] = {NULL};
+    EXPECT_EQ(1, poll_result_from_errors(2, errors));
+
+    g_set_error(&errors[0], g_quark_from_static_string("test"), EAGAIN, "pending");
+    EXPECT_EQ(0, poll_result_from_errors(2, errors));
+
+    g_set_error(&errors[1], g_quark_from_static_string("test"), ENOENT, "missing");
+    EXPECT_EQ(0, poll_result_from_errors(2, errors));
+
+    g_clear_error(&errors[0]);
+    EXPECT_EQ(2, poll_result_from_errors(2, errors));
+
+    g_set_error(&errors[0], g_quark_from_static_string("test"), EIO, "failed");
+    EXPECT_EQ(-1, poll_result_from_errors(2, errors));
+
+    g_clear_error(&errors[0]);
+    g_clear_error(&errors[1]);
+}
+
+
+TEST_F(XrootdEndpointsTest, PartialFailurePoll)
+{
+    const char *urls[] = {
+        "root://host1.cern.ch//path/a",
+        "root://host2.cern.ch//path/b",
+        "root://host1.cern.ch//path/c",
+        "root://host2.cern.ch//path/d",
+    };
+    GError *errors[4] = {NULL};
+
+    // host2 refuses the staging request
+    std::string token = submit_per_endpoint(context, 4, urls, errors,
+        [&](const std::string& endpoint, int n, const char* const* group, GError** group_errors,
+            std::string& endpointToken) {
+            if (endpoint == "host2.cern.ch:1094") {
+                for (int i = 0; i < n; ++i) {
+                    g_set_error(&group_errors[i], g_quark_from_static_string("test"), ECOMM, "refused");
+                }
+                return -1;
+            }
+            endpointToken = "req1";
+            return 0;
+        });
+
+    ASSERT_FALSE(token.empty());
+    EXPECT_EQ("req1", get_endpoint_token(token, "host1.cern.ch:1094"));
+    EXPECT_EQ(NULL, errors[0]);
+    ASSERT_NE((void*)NULL, errors[1]);
+    EXPECT_EQ(ECOMM, errors[1]->code);
+    for (int i = 0; i < 4; ++i) {
+        g_clear_error(&errors[i]);
+    }
+
+    // Polling keeps the submission error, and only asks host1
+    std::set<std::string> polled;
+    std::mutex mutex;
+    std::map<std::string, int> results = run_per_endpoint_token(context, 4, urls, token, errors,
+        [&](const std::string& endpoint, int n, const char* const* group, GError** group_errors,
+            const std::string& endpointToken) {
+            std::lock_guard<std::mutex> lock(mutex);
+            polled.insert(endpoint);
+            EXPECT_EQ("req1", endpointToken);
+            return 1;
+        });
+
+    EXPECT_EQ(1u, polled.size());
+    EXPECT_EQ(1, results["host1.cern.ch:1094"]);
+    EXPECT_EQ(-1, results["host2.cern.ch:1094"]);
+    EXPECT_EQ(NULL, errors[0]);
+    EXPECT_EQ(NULL, errors[2]);
+    ASSERT_NE((void*)NULL, errors[1]);
+    EXPECT_EQ(ECOMM, errors[1]->code);
+    ASSERT_NE((void*)NULL, errors[3]);
+    EXPECT_EQ(ECOMM, errors[3]->code);
+    EXPECT_EQ(2, poll_result_from_errors(4, errors));
+    for (int i = 0; i < 4; ++i) {
+        g_clear_error(&errors[i]);
+    }
+
+    // Nothing accepted, no token
+    token = submit_per_endpoint(context, 4, urls, errors,
+        [&](const std::string& endpoint, int n, const char* const* group, GError** group_errors,
+            std::string& endpointToken) {
+            for (int i = 0; i < n; ++i) {
+                g_set_error(&group_errors[i], g_quark_from_static_string("test"), EIO, "down");
+            }
+            return -1;
+        });
+    EXPECT_TRUE(token.empty());
+    for (int i = 0; i < 4; ++i) {
+        g_clear_error(&errors[i]);
+    }
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) CERN 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gfal_xrootd_plugin_space.h"
+
+
+// Fake space source, counting the queries, and failing or blocking on demand
+class XrootdSpaceCacheTest: public testing::Test {
+public:
+    std::atomic<int> queries;
+    bool failing;
+    time_t now;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool blocked;
+
+    SpaceReportCache cache;
+
+    XrootdSpaceCacheTest(): queries(0), failing(false), now(1000), blocked(false),
+        cache(std::bind(&XrootdSpaceCacheTest::Query, this, std::placeholders::_1, std::placeholders::_2),
+              [this] { return now; })
+    {
+    }
+
+    XrdCl::XRootDStatus Query(const std::string& url, SpaceSample& sample)
+    {
+        ++queries;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return !blocked; });
+        }
+        if (failing) {
+            return XrdCl::XRootDStatus(XrdCl::stError, XrdCl::errErrorResponse, 0, "no space for you");
+        }
+        sample.used = url.size();
+        sample.free = 100 * queries;
+        sample.total = 1000;
+        sample.largestChunk = 10;
+        return XrdCl::XRootDStatus();
+    }
+
+    void Unblock()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        blocked = false;
+        cv.notify_all();
+    }
+};
+
+
+TEST_F(XrootdSpaceCacheTest, Cached)
+{
+    SpaceSample sample;
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(cache.Get("root://host//path", 60, sample).IsOK());
+        ASSERT_EQ(100u, sample.free);
+        ASSERT_EQ(1000u, sample.total);
+    }
+    ASSERT_EQ(1, queries);
+
+    // Other urls are queried on their own
+    ASSERT_TRUE(cache.Get("root://other//path", 60, sample).IsOK());
+    ASSERT_EQ(2, queries);
+}
+
+
+TEST_F(XrootdSpaceCacheTest, Expires)
+{
+    SpaceSample sample;
+    ASSERT_TRUE(cache.Get("root://host//path", 60, sample).IsOK());
+    now += 59;
+    ASSERT_TRUE(cache.Get("root://host//path", 60, sample).IsOK());
+    ASSERT_EQ(1, queries);
+
+    now += 1;
+    ASSERT_TRUE(cache.Get("root://host//path", 60, sample).IsOK());
+    ASSERT_EQ(2, queries);
+    ASSERT_EQ(200u, sample.free);
+
+    // A caller asking for fresher data gets it
+    now += 10;
+    ASSERT_TRUE(cache.Get("root://host//path", 5, sample).IsOK());
+    ASSERT_EQ(3, queries);
+
+    ASSERT_TRUE(cache.Get("root://host//path", 0, sample).IsOK());
+    ASSERT_EQ(4, queries);
+}
+
+
+TEST_F(XrootdSpaceCacheTest, ExpiredDropped)
+{
+    SpaceSample sample;
+    ASSERT_TRUE(cache.Get("root://host//path", 60, sample).IsOK());
+    ASSERT_EQ(1u, cache.Size());
+
+    // A failed refresh of an expired entry leaves nothing behind
+    now += 60;
+    failing = true;
+    ASSERT_FALSE(cache.Get("root://host//path", 60, sample).IsOK());
+    ASSERT_EQ(0u, cache.Size());
+}
+
+
+TEST_F(XrootdSpaceCacheTest, NoTtlNotStored)
+{
+    SpaceSample sample;
+    ASSERT_TRUE(cache.Get("root://host//path", 0, sample).IsOK());
+    ASSERT_TRUE(cache.Get("root://host//path", 0, sample).IsOK());
+    ASSERT_EQ(2, queries);
+    ASSERT_EQ(0u, cache.Size());
+
+    // But concurrent callers still share the query
+    blocked = true;
+    const int nthreads = 4;
+    std::vector<std::thread> threads;
+    std::atomic<int> succeeded(0);
+    for (int i = 0; i < nthreads; ++i) {
+        threads.push_back(std::thread([this, &succeeded] {
+            SpaceSample sample;
+            if (cache.Get("root://host//path", 0, sample).IsOK())
+                ++succeeded;
+        }));
+    }
+    while (queries == 2) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(1u, cache.Size());
+    Unblock();
+
+    for (int i = 0; i < nthreads; ++i) {
+        threads[i].join();
+    }
+    ASSERT_EQ(3, queries);
+    ASSERT_EQ(nthreads, succeeded);
+    ASSERT_EQ(0u, cache.Size());
+}
+
+
+TEST_F(XrootdSpaceCacheTest, FailuresNotCached)
+{
+    SpaceSample sample;
+    failing = true;
+    for (int i = 0; i < 3; ++i) {
+        XrdCl::XRootDStatus status = cache.Get("root://host//path", 60, sample);
+        ASSERT_FALSE(status.IsOK());
+        ASSERT_EQ("no space for you", status.GetErrorMessage());
+    }
+    ASSERT_EQ(3, queries);
+    ASSERT_EQ(0u, cache.Size());
+
+    failing = false;
+    ASSERT_TRUE(cache.Get("root://host//path", 60, sample).IsOK());
+    ASSERT_TRUE(cache.Get("root://host//path", 60, sample).IsOK());
+    ASSERT_EQ(4, queries);
+}
+
+
+TEST_F(XrootdSpaceCacheTest, Coalesced)
+{
+    blocked = true;
+
+    const int nthreads = 8;
+    std::vector<std::thread> threads;
+    std::vector<SpaceSample> samples(nthreads);
+    std::atomic<int> succeeded(0);
+    for (int i = 0; i < nthreads; ++i) {
+        threads.push_back(std::thread([this, i, &samples, &succeeded] {
+            if (cache.Get("root://host//path", 60, samples[i]).IsOK())
+                ++succeeded;
+        }));
+    }
+
+    // Let the callers pile up behind the first query
+    while (queries == 0) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    Unblock();
+
+    for (int i = 0; i < nthreads; ++i) {
+        threads[i].join();
+    }
+    ASSERT_EQ(1, queries);
+    ASSERT_EQ(nthreads, succeeded);
+    for (int i = 0; i < nthreads; ++i) {
+        ASSERT_EQ(100u, samples[i].free);
+    }
+}
+
+
+TEST_F(XrootdSpaceCacheTest, Clear)
+{
+    SpaceSample sample;
+    ASSERT_TRUE(cache.Get("root://host//path", 60, sample).IsOK());
+    cache.Clear();
+    ASSERT_TRUE(cache.Get("root://host//path", 60, sample).IsOK());
+    ASSERT_EQ(2, queries);
+}